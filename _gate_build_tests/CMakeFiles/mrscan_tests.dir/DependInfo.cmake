@@ -0,0 +1,24 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tests/main.cpp" "CMakeFiles/mrscan_tests.dir/main.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/main.cpp.o.d"
+  "/root/repo/fftshift.cpp" "CMakeFiles/mrscan_tests.dir/root/repo/fftshift.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/root/repo/fftshift.cpp.o.d"
+  "/root/repo/simdutils.cpp" "CMakeFiles/mrscan_tests.dir/root/repo/simdutils.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/root/repo/simdutils.cpp.o.d"
+  "/root/repo/tests/tst_builtinfft.cpp" "CMakeFiles/mrscan_tests.dir/tst_builtinfft.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/tst_builtinfft.cpp.o.d"
+  "/root/repo/tests/tst_fftshift.cpp" "CMakeFiles/mrscan_tests.dir/tst_fftshift.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/tst_fftshift.cpp.o.d"
+  "/root/repo/tests/tst_simdutils.cpp" "CMakeFiles/mrscan_tests.dir/tst_simdutils.cpp.o" "gcc" "CMakeFiles/mrscan_tests.dir/tst_simdutils.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
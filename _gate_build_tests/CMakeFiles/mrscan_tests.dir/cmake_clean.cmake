@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mrscan_tests.dir/main.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/main.cpp.o.d"
+  "CMakeFiles/mrscan_tests.dir/root/repo/fftshift.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/root/repo/fftshift.cpp.o.d"
+  "CMakeFiles/mrscan_tests.dir/root/repo/simdutils.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/root/repo/simdutils.cpp.o.d"
+  "CMakeFiles/mrscan_tests.dir/tst_builtinfft.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/tst_builtinfft.cpp.o.d"
+  "CMakeFiles/mrscan_tests.dir/tst_fftshift.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/tst_fftshift.cpp.o.d"
+  "CMakeFiles/mrscan_tests.dir/tst_simdutils.cpp.o"
+  "CMakeFiles/mrscan_tests.dir/tst_simdutils.cpp.o.d"
+  "mrscan_tests"
+  "mrscan_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/mrscan_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,232 @@
+#ifndef BUILTINFFT_H
+#define BUILTINFFT_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "parallelutils.h"
+
+/**
+ * @brief Header-only complex DFT used when FFTW is not available or not selected
+ * @details Radix-2 for powers of two and Bluestein's algorithm (through a power of two
+ * convolution) for every other length. Multi-dimensional transforms run the 1D transform
+ * along each axis, lines of one axis are distributed over parallel_utils workers.
+ * Same conventions as FFTW: unnormalized, sign -1 forward and +1 backward.
+ */
+namespace builtin_fft {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * @class Plan1d
+ * @brief Precomputed twiddles of one length and direction, immutable after construction
+ */
+template <typename Real>
+class Plan1d {
+public:
+    using Complex = std::complex<Real>;
+
+    Plan1d(size_t n, int sign) : m_n(n) {
+        if (isPowerOfTwo(n)) {
+            initRadix2(n, sign, m_twiddles, m_bitReverse);
+            return;
+        }
+
+        // X[k] = c[k] * sum_j (x[j] c[j]) conj(c[k - j]), c[j] = exp(sign i pi j^2 / n)
+        m_m = 1;
+        while (m_m < 2 * n - 1) {
+            m_m <<= 1;
+        }
+        initRadix2(m_m, -1, m_twiddles, m_bitReverse);
+        initRadix2(m_m, +1, m_inverseTwiddles, m_inverseBitReverse);
+
+        m_chirp.resize(n);
+        for (size_t j = 0; j < n; j++) {
+            // j^2 mod 2n keeps the angle exact for long transforms
+            auto jj = static_cast<double>((static_cast<unsigned long long>(j) * j) % (2 * n));
+            auto angle = sign * kPi * jj / static_cast<double>(n);
+            m_chirp[j] = Complex(static_cast<Real>(std::cos(angle)), static_cast<Real>(std::sin(angle)));
+        }
+
+        std::vector<Complex> kernel(m_m);
+        kernel[0] = std::conj(m_chirp[0]);
+        for (size_t j = 1; j < n; j++) {
+            kernel[j] = kernel[m_m - j] = std::conj(m_chirp[j]);
+        }
+        radix2(kernel.data(), m_m, m_twiddles, m_bitReverse);
+        // Fold the 1/m of the inverse convolution into the kernel
+        for (auto &value : kernel) {
+            value /= static_cast<Real>(m_m);
+        }
+        m_kernel = std::move(kernel);
+    }
+
+    size_t size() const { return m_n; }
+
+    /// Elements of scratch execute() needs, 0 for powers of two
+    size_t scratchSize() const { return m_m; }
+
+    /// Transform n contiguous elements in place
+    void execute(Complex *data, Complex *scratch) const {
+        if (m_m == 0) {
+            radix2(data, m_n, m_twiddles, m_bitReverse);
+            return;
+        }
+
+        for (size_t j = 0; j < m_n; j++) {
+            scratch[j] = data[j] * m_chirp[j];
+        }
+        std::fill(scratch + m_n, scratch + m_m, Complex(0, 0));
+        radix2(scratch, m_m, m_twiddles, m_bitReverse);
+        for (size_t k = 0; k < m_m; k++) {
+            scratch[k] *= m_kernel[k];
+        }
+        radix2(scratch, m_m, m_inverseTwiddles, m_inverseBitReverse);
+        for (size_t k = 0; k < m_n; k++) {
+            data[k] = scratch[k] * m_chirp[k];
+        }
+    }
+
+private:
+    static bool isPowerOfTwo(size_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+    static void initRadix2(size_t n, int sign, std::vector<Complex> &twiddles,
+                           std::vector<size_t> &bitReverse) {
+        twiddles.resize(n / 2);
+        for (size_t k = 0; k < n / 2; k++) {
+            auto angle = sign * 2 * kPi * static_cast<double>(k) / static_cast<double>(n);
+            twiddles[k] = Complex(static_cast<Real>(std::cos(angle)), static_cast<Real>(std::sin(angle)));
+        }
+
+        bitReverse.resize(n);
+        size_t bits = 0;
+        while ((size_t(1) << bits) < n) {
+            bits++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t r = 0;
+            for (size_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bitReverse[i] = r;
+        }
+    }
+
+    /// Iterative decimation in time, twiddles[k] = exp(sign 2 pi i k / n)
+    static void radix2(Complex *data, size_t n, const std::vector<Complex> &twiddles,
+                       const std::vector<size_t> &bitReverse) {
+        for (size_t i = 0; i < n; i++) {
+            if (i < bitReverse[i]) {
+                std::swap(data[i], data[bitReverse[i]]);
+            }
+        }
+        for (size_t half = 1; half < n; half <<= 1) {
+            const size_t step = n / (2 * half);
+            for (size_t start = 0; start < n; start += 2 * half) {
+                for (size_t k = 0; k < half; k++) {
+                    auto t = data[start + k + half] * twiddles[k * step];
+                    data[start + k + half] = data[start + k] - t;
+                    data[start + k] += t;
+                }
+            }
+        }
+    }
+
+    size_t m_n = 0;
+    /// Bluestein convolution length, 0 for powers of two
+    size_t m_m = 0;
+    std::vector<Complex> m_twiddles;
+    std::vector<size_t> m_bitReverse;
+    std::vector<Complex> m_inverseTwiddles;
+    std::vector<size_t> m_inverseBitReverse;
+    std::vector<Complex> m_chirp;
+    std::vector<Complex> m_kernel;
+};
+
+/// Shared plan of a length and direction, created on first use
+template <typename Real>
+std::shared_ptr<const Plan1d<Real>> plan(size_t n, int sign) {
+    static std::mutex s_mutex;
+    static std::map<std::pair<size_t, int>, std::shared_ptr<const Plan1d<Real>>> s_plans;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto &entry = s_plans[{n, sign}];
+    if (!entry) {
+        entry = std::make_shared<const Plan1d<Real>>(n, sign);
+    }
+    return entry;
+}
+
+/// Lines of a strided axis gathered together, adjacent lines share cache lines
+constexpr size_t kLinesPerTask = 16;
+/// Below this many elements a transform runs on the calling thread only
+constexpr size_t kParallelMin = size_t(1) << 16;
+
+/**
+ * @brief howmany contiguous transforms of shape n, in place
+ * @param workers Threads, <= 0 means parallel_utils::maxThreads()
+ */
+template <typename Real>
+void transform(std::complex<Real> *data, const std::vector<int> &n, int howmany, int sign,
+               int workers = 0) {
+    size_t dist = 1;
+    for (auto size : n) {
+        dist *= size;
+    }
+    const size_t total = dist * howmany;
+    if (total < kParallelMin) {
+        workers = 1;
+    }
+
+    size_t stride = dist;
+    for (size_t axis = 0; axis < n.size(); axis++) {
+        const size_t length = n[axis];
+        stride /= length;
+        if (length <= 1) {
+            continue;
+        }
+
+        // Lines of this axis: outer blocks of length * stride elements, stride lines each
+        const size_t outer = total / (length * stride);
+        const size_t groups = (stride + kLinesPerTask - 1) / kLinesPerTask;
+        auto p = plan<Real>(length, sign);
+        parallel_utils::parallelFor(0, static_cast<int>(outer * groups), [&](int task) {
+            thread_local std::vector<std::complex<Real>> lines;
+            thread_local std::vector<std::complex<Real>> scratch;
+            scratch.resize(p->scratchSize());
+
+            auto block = data + (task / groups) * length * stride;
+            auto first = (task % groups) * kLinesPerTask;
+            auto count = std::min(kLinesPerTask, stride - first);
+            if (stride == 1) {
+                p->execute(block, scratch.data());
+                return;
+            }
+
+            lines.resize(count * length);
+            for (size_t i = 0; i < length; i++) {
+                for (size_t l = 0; l < count; l++) {
+                    lines[l * length + i] = block[i * stride + first + l];
+                }
+            }
+            for (size_t l = 0; l < count; l++) {
+                p->execute(lines.data() + l * length, scratch.data());
+            }
+            for (size_t i = 0; i < length; i++) {
+                for (size_t l = 0; l < count; l++) {
+                    block[i * stride + first + l] = lines[l * length + i];
+                }
+            }
+        }, workers);
+    }
+}
+
+} // namespace builtin_fft
+
+#endif // BUILTINFFT_H
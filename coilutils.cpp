@@ -0,0 +1,224 @@
+#include "coilutils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallelutils.h"
+#include "simdutils.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// Pixels per task of the accumulation loops
+constexpr size_t kCombineChunk = size_t(1) << 16;
+/// Below this many pixels the loops run on the calling thread only
+constexpr size_t kCombineParallelMin = size_t(1) << 18;
+
+/// Call fn(begin, count) over [0, n) in chunks, in parallel for large n
+template <typename F>
+void forChunks(size_t n, F &&fn) {
+    const size_t chunks = (n + kCombineChunk - 1) / kCombineChunk;
+    const int workers = n < kCombineParallelMin ? 1 : 0;
+    parallel_utils::parallelFor(0, static_cast<int>(chunks), [&](int chunk) {
+        size_t begin = chunk * kCombineChunk;
+        fn(begin, std::min(kCombineChunk, n - begin));
+    }, workers);
+}
+
+/// Hann window of n points centred on centre, fraction * n points wide
+std::vector<double> hann(int n, int centre, double fraction) {
+    std::vector<double> window(n, 0.0);
+    if (n <= 1) {
+        std::fill(window.begin(), window.end(), 1.0);
+        return window;
+    }
+
+    const double half = std::max(1.0, fraction * n / 2);
+    for (int i = 0; i < n; i++) {
+        double distance = std::abs(i - centre);
+        if (distance < half) {
+            window[i] = 0.5 * (1 + std::cos(kPi * distance / half));
+        }
+    }
+    return window;
+}
+
+} // namespace
+
+namespace coil_utils {
+
+template <typename Real>
+mrd_utils::BasicMrd<Real> lowResolution(const mrd_utils::BasicMrd<Real> &kspace, double fraction) {
+    const size_t n = kspace.size();
+    if (!kspace.kdata || kspace.transformed || n == 0) {
+        return {};
+    }
+
+    // The k-space centre is where the signal peaks, every block shares the encoding
+    const auto src = kspace.volumes();
+    const int views = kspace.views;
+    const int views2 = kspace.views2;
+    const int samples = kspace.samples;
+    int peakView = 0;
+    int peakPartition = 0;
+    int peakSample = 0;
+    Real peakNorm = -1;
+    for (int y = 0; y < views; y++) {
+        for (int z = 0; z < views2; z++) {
+            auto row = &src(0, y, z, 0);
+            for (int x = 0; x < samples; x++) {
+                Real norm = row[x][0] * row[x][0] + row[x][1] * row[x][1];
+                if (norm > peakNorm) {
+                    peakNorm = norm;
+                    peakView = y;
+                    peakPartition = z;
+                    peakSample = x;
+                }
+            }
+        }
+    }
+    auto viewWindow = hann(views, peakView, fraction);
+    auto partitionWindow = hann(views2, peakPartition, fraction);
+    auto sampleWindow = hann(samples, peakSample, fraction);
+
+    // Rows of samples, (block, view, partition) row-major
+    auto filtered = fftw_utils::createArray<Real>(n);
+    const auto dst = mrd_utils::BasicMrd<Real>::MutableVolumes::wrap(filtered.get(), src.shape());
+    const int rows = static_cast<int>(n / samples);
+    const int workers = n < kCombineParallelMin ? 1 : 0;
+    parallel_utils::parallelFor(0, rows, [&](int row) {
+        const int block = row / (views * views2);
+        const int y = (row / views2) % views;
+        const int z = row % views2;
+        auto weight = viewWindow[y] * partitionWindow[z];
+        auto in = &src(block, y, z, 0);
+        auto out = &dst(block, y, z, 0);
+        for (int s = 0; s < samples; s++) {
+            auto w = static_cast<Real>(weight * sampleWindow[s]);
+            out[s][0] = in[s][0] * w;
+            out[s][1] = in[s][1] * w;
+        }
+    }, workers);
+
+    mrd_utils::BasicMrd<Real> result;
+    result.kdata = std::move(filtered);
+    result.experiments = kspace.experiments;
+    result.echoes = kspace.echoes;
+    result.slices = kspace.slices;
+    result.views = kspace.views;
+    result.views2 = kspace.views2;
+    result.samples = kspace.samples;
+    result.ppr = kspace.ppr;
+    result.centred = kspace.centred;
+    if (!result.transform()) {
+        return {};
+    }
+    return result;
+}
+
+template <typename Real>
+CoilCombiner<Real>::CoilCombiner(recon::CoilCombine mode) : m_mode(mode) {}
+
+template <typename Real>
+bool CoilCombiner<Real>::sameShape(const mrd_utils::BasicMrd<Real> &mrd) const {
+    return mrd.shape() == m_shape.shape();
+}
+
+template <typename Real>
+bool CoilCombiner<Real>::add(const mrd_utils::BasicMrd<Real> &coil,
+                             const mrd_utils::BasicMrd<Real> *lowRes) {
+    if (m_mode == recon::CoilCombine::None) {
+        return false;
+    }
+    if (!coil.kdata || !coil.transformed) {
+        LOG_ERROR("Coil combination needs transformed coil images");
+        return false;
+    }
+    if (needsSensitivity() && (!lowRes || !lowRes->kdata || !lowRes->transformed ||
+                               lowRes->shape() != coil.shape())) {
+        LOG_ERROR("Sensitivity weighted coil combination needs the low resolution coil images");
+        return false;
+    }
+
+    const size_t n = coil.size();
+    if (m_coils == 0) {
+        m_shape = mrd_utils::BasicMrd<Real>();
+        m_shape.experiments = coil.experiments;
+        m_shape.echoes = coil.echoes;
+        m_shape.slices = coil.slices;
+        m_shape.views = coil.views;
+        m_shape.views2 = coil.views2;
+        m_shape.samples = coil.samples;
+        m_shape.ppr = coil.ppr;
+        m_norms.assign(n, 0);
+        if (needsSensitivity()) {
+            m_products = fftw_utils::createArray<Real>(n);
+            std::fill_n(reinterpret_cast<Real *>(m_products.get()), 2 * n, Real(0));
+        }
+    } else if (!sameShape(coil)) {
+        LOG_ERROR("Coil shapes differ, the coil is not combined");
+        return false;
+    }
+
+    auto image = coil.kdata.get();
+    if (needsSensitivity()) {
+        auto sensitivity = lowRes->kdata.get();
+        forChunks(n, [&](size_t begin, size_t count) {
+            simd_utils::addConjugateProduct(sensitivity + begin, image + begin,
+                                            m_products.get() + begin, count);
+            simd_utils::addNorm(sensitivity + begin, m_norms.data() + begin, count);
+        });
+    } else {
+        forChunks(n, [&](size_t begin, size_t count) {
+            simd_utils::addNorm(image + begin, m_norms.data() + begin, count);
+        });
+    }
+    m_coils++;
+    return true;
+}
+
+template <typename Real>
+mrd_utils::BasicMrd<Real> CoilCombiner<Real>::take() {
+    if (m_coils == 0) {
+        return {};
+    }
+
+    const size_t n = m_norms.size();
+    fftw_utils::complex_ptr<Real> combined;
+    if (needsSensitivity()) {
+        combined = std::move(m_products);
+        auto out = combined.get();
+        forChunks(n, [&](size_t begin, size_t count) {
+            for (size_t i = begin; i < begin + count; i++) {
+                Real scale = m_norms[i] > 0 ? 1 / std::sqrt(m_norms[i]) : 0;
+                out[i][0] *= scale;
+                out[i][1] *= scale;
+            }
+        });
+    } else {
+        combined = fftw_utils::createArray<Real>(n);
+        auto out = combined.get();
+        forChunks(n, [&](size_t begin, size_t count) {
+            for (size_t i = begin; i < begin + count; i++) {
+                out[i][0] = std::sqrt(m_norms[i]);
+                out[i][1] = 0;
+            }
+        });
+    }
+
+    mrd_utils::BasicMrd<Real> result;
+    result.swap(m_shape);
+    result.kdata = std::move(combined);
+    result.transformed = true;
+    m_coils = 0;
+    std::vector<Real>().swap(m_norms);
+    return result;
+}
+
+template mrd_utils::BasicMrd<double> lowResolution(const mrd_utils::BasicMrd<double> &, double);
+template mrd_utils::BasicMrd<float> lowResolution(const mrd_utils::BasicMrd<float> &, double);
+template class CoilCombiner<double>;
+template class CoilCombiner<float>;
+
+} // namespace coil_utils
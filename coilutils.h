@@ -0,0 +1,73 @@
+#ifndef COILUTILS_H
+#define COILUTILS_H
+
+#include <vector>
+
+#include "mrdutils.h"
+#include "reconoptions.h"
+
+/**
+ * @brief Combination of the coil images of a multi-coil exam into a single image
+ * @details Coils are added one at a time, only the running sums and the current coil are
+ * in memory. Coil images must be transformed and centred (BasicMrd::transform).
+ */
+namespace coil_utils {
+
+/// Fraction of every encoded axis kept around the k-space centre for the sensitivity estimate
+constexpr double kCalibrationFraction = 1.0 / 8;
+
+/**
+ * @brief Low resolution complex images of a coil, its sensitivity up to a factor common to all coils
+ * @details The k-space is multiplied by a separable Hann window centred on the peak sample of
+ * the first block, then transformed like BasicMrd::transform
+ * @param kspace Coil that is not transformed yet
+ * @return An empty Mrd if kspace has no data or is already transformed
+ */
+template <typename Real>
+mrd_utils::BasicMrd<Real> lowResolution(const mrd_utils::BasicMrd<Real> &kspace,
+                                        double fraction = kCalibrationFraction);
+
+/**
+ * @class CoilCombiner
+ * @brief Running coil combination, vectorized and parallel across pixels
+ * @details CoilCombine::Rss gives sqrt(sum |x_c|^2). CoilCombine::Sensitivity gives
+ * sum conj(s_c) x_c / sqrt(sum |s_c|^2) with s_c = lowResolution(coil c), which weights
+ * each coil by its local signal and keeps the noise of the combination lower than RSS.
+ */
+template <typename Real>
+class CoilCombiner {
+public:
+    explicit CoilCombiner(recon::CoilCombine mode);
+
+    recon::CoilCombine mode() const { return m_mode; }
+    /// add() needs the lowResolution() of every coil
+    bool needsSensitivity() const { return m_mode == recon::CoilCombine::Sensitivity; }
+    int coils() const { return m_coils; }
+
+    /**
+     * @brief Accumulate one coil
+     * @param coil Transformed images of the coil
+     * @param lowRes lowResolution() of the same coil, only used by CoilCombine::Sensitivity
+     * @return false if an input is not transformed or its shape differs from the first coil
+     */
+    bool add(const mrd_utils::BasicMrd<Real> &coil, const mrd_utils::BasicMrd<Real> *lowRes = nullptr);
+
+    /// Combined images as a transformed Mrd, empty if no coil was added, the combiner is reset
+    mrd_utils::BasicMrd<Real> take();
+
+private:
+    bool sameShape(const mrd_utils::BasicMrd<Real> &mrd) const;
+
+    recon::CoilCombine m_mode;
+    int m_coils = 0;
+    /// Shape and PPR of the first coil, kdata is unused
+    mrd_utils::BasicMrd<Real> m_shape;
+    /// sum |x_c|^2 for Rss, sum |s_c|^2 for Sensitivity
+    std::vector<Real> m_norms;
+    /// sum conj(s_c) x_c, Sensitivity only
+    fftw_utils::complex_ptr<Real> m_products;
+};
+
+} // namespace coil_utils
+
+#endif // COILUTILS_H
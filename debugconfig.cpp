@@ -126,4 +126,167 @@ void Debug::setLogFilePath(const QString& path){
     emit instance()->logFilePathChanged(path);
 }
 
+// Performance settings implementation
+int Debug::workerThreads(){
+    auto cm = ConfigManager::instance();
+    auto count = cm->get(CONFIG_NAME, KEY_WORKER_THREADS);
+    if(count.isNull()){
+        cm->set(CONFIG_NAME, KEY_WORKER_THREADS, 0); // Auto
+        return 0;
+    }
+    return count.toInt();
+}
+
+int Debug::precision(){
+    auto cm = ConfigManager::instance();
+    auto precision = cm->get(CONFIG_NAME, KEY_PRECISION);
+    if(precision.isNull()){
+        cm->set(CONFIG_NAME, KEY_PRECISION, 0); // Double
+        return 0;
+    }
+    return precision.toInt();
+}
+
+bool Debug::shiftFree(){
+    auto cm = ConfigManager::instance();
+    auto enable = cm->get(CONFIG_NAME, KEY_SHIFT_FREE);
+    if(enable.isNull()){
+        cm->set(CONFIG_NAME, KEY_SHIFT_FREE, true);
+        return true;
+    }
+    return enable.toBool();
+}
+
+int Debug::coilCombine(){
+    auto cm = ConfigManager::instance();
+    auto combine = cm->get(CONFIG_NAME, KEY_COIL_COMBINE);
+    if(combine.isNull()){
+        cm->set(CONFIG_NAME, KEY_COIL_COMBINE, 0); // Root sum of squares
+        return 0;
+    }
+    return combine.toInt();
+}
+
+int Debug::partialFourier(){
+    auto cm = ConfigManager::instance();
+    auto method = cm->get(CONFIG_NAME, KEY_PARTIAL_FOURIER);
+    if(method.isNull()){
+        cm->set(CONFIG_NAME, KEY_PARTIAL_FOURIER, 1); // Homodyne
+        return 1;
+    }
+    return method.toInt();
+}
+
+bool Debug::compressResponses(){
+    auto cm = ConfigManager::instance();
+    auto enable = cm->get(CONFIG_NAME, KEY_COMPRESS_RESPONSES);
+    if(enable.isNull()){
+        cm->set(CONFIG_NAME, KEY_COMPRESS_RESPONSES, false);
+        return false;
+    }
+    return enable.toBool();
+}
+
+int Debug::fftBackend(){
+    auto cm = ConfigManager::instance();
+    auto backend = cm->get(CONFIG_NAME, KEY_FFT_BACKEND);
+    if(backend.isNull()){
+        cm->set(CONFIG_NAME, KEY_FFT_BACKEND, 0); // FFTW
+        return 0;
+    }
+    return backend.toInt();
+}
+
+int Debug::fftEffort(){
+    auto cm = ConfigManager::instance();
+    auto effort = cm->get(CONFIG_NAME, KEY_FFT_EFFORT);
+    if(effort.isNull()){
+        cm->set(CONFIG_NAME, KEY_FFT_EFFORT, 0); // Estimate
+        return 0;
+    }
+    return effort.toInt();
+}
+
+int Debug::fftThreads(){
+    auto cm = ConfigManager::instance();
+    auto threads = cm->get(CONFIG_NAME, KEY_FFT_THREADS);
+    if(threads.isNull()){
+        cm->set(CONFIG_NAME, KEY_FFT_THREADS, 0); // Auto
+        return 0;
+    }
+    return threads.toInt();
+}
+
+void Debug::setWorkerThreads(int count){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_WORKER_THREADS, count);
+
+    // Emit signal
+    emit instance()->workerThreadsChanged(count);
+}
+
+void Debug::setPrecision(int precision){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_PRECISION, precision);
+
+    // Emit signal
+    emit instance()->precisionChanged(precision);
+}
+
+void Debug::setShiftFree(bool enable){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_SHIFT_FREE, enable);
+
+    // Emit signal
+    emit instance()->shiftFreeChanged(enable);
+}
+
+void Debug::setCoilCombine(int combine){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_COIL_COMBINE, combine);
+
+    // Emit signal
+    emit instance()->coilCombineChanged(combine);
+}
+
+void Debug::setPartialFourier(int method){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_PARTIAL_FOURIER, method);
+
+    // Emit signal
+    emit instance()->partialFourierChanged(method);
+}
+
+void Debug::setCompressResponses(bool enable){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_COMPRESS_RESPONSES, enable);
+
+    // Emit signal
+    emit instance()->compressResponsesChanged(enable);
+}
+
+void Debug::setFftBackend(int backend){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_FFT_BACKEND, backend);
+
+    // Emit signal
+    emit instance()->fftBackendChanged(backend);
+}
+
+void Debug::setFftEffort(int effort){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_FFT_EFFORT, effort);
+
+    // Emit signal
+    emit instance()->fftEffortChanged(effort);
+}
+
+void Debug::setFftThreads(int threads){
+    auto cm = ConfigManager::instance();
+    cm->set(CONFIG_NAME, KEY_FFT_THREADS, threads);
+
+    // Emit signal
+    emit instance()->fftThreadsChanged(threads);
+}
+
 } // namespace config
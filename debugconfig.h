@@ -16,6 +16,15 @@ namespace config{
         static constexpr const char* KEY_LOG_LEVEL = "log_level";
         static constexpr const char* KEY_LOG_TO_FILE = "log_to_file";
         static constexpr const char* KEY_LOG_FILE_PATH = "log_file_path";
+        static constexpr const char* KEY_WORKER_THREADS = "worker_threads";
+        static constexpr const char* KEY_PRECISION = "precision";
+        static constexpr const char* KEY_SHIFT_FREE = "shift_free";
+        static constexpr const char* KEY_COIL_COMBINE = "coil_combine";
+        static constexpr const char* KEY_PARTIAL_FOURIER = "partial_fourier";
+        static constexpr const char* KEY_COMPRESS_RESPONSES = "compress_responses";
+        static constexpr const char* KEY_FFT_BACKEND = "fft_backend";
+        static constexpr const char* KEY_FFT_EFFORT = "fft_effort";
+        static constexpr const char* KEY_FFT_THREADS = "fft_threads";
 
         // 单例实例
         static Debug* instance();
@@ -37,6 +46,37 @@ namespace config{
         static void setLogLevel(int level);
         static void setLogToFile(bool enable);
         static void setLogFilePath(const QString& path);
+
+        // Performance settings
+        /// Worker threads of the parallel reconstruction loops, 0 means auto
+        static int workerThreads();
+
+        /// Reconstruction precision, 0 double (fftw), 1 single (fftwf)
+        static int precision();
+        /// Centre images by phase modulating k-space instead of a separate fftshift pass
+        static bool shiftFree();
+        /// Combined channel of multi-coil exams, 0 root sum of squares, 1 sensitivity weighted, 2 none
+        static int coilCombine();
+        /// Missing views of partial Fourier acquisitions, 0 zero fill, 1 homodyne, 2 POCS
+        static int partialFourier();
+        /// Store scan results as chunked zlib archives (.mrdz) instead of raw .mrd
+        static bool compressResponses();
+        /// FFT engine, 0 FFTW, 1 built-in
+        static int fftBackend();
+        /// fftw planner effort, 0 estimate, 1 measure, 2 patient
+        static int fftEffort();
+        /// Threads of one FFT, 0 means auto (physical cores)
+        static int fftThreads();
+
+        static void setWorkerThreads(int count);
+        static void setPrecision(int precision);
+        static void setShiftFree(bool enable);
+        static void setCoilCombine(int combine);
+        static void setPartialFourier(int method);
+        static void setCompressResponses(bool enable);
+        static void setFftBackend(int backend);
+        static void setFftEffort(int effort);
+        static void setFftThreads(int threads);
         
     signals:
         void mockFilePathChanged(const QString& path);
@@ -45,6 +85,15 @@ namespace config{
         void logLevelChanged(int level);
         void logToFileChanged(bool enable);
         void logFilePathChanged(const QString& path);
+        void workerThreadsChanged(int count);
+        void precisionChanged(int precision);
+        void shiftFreeChanged(bool enable);
+        void coilCombineChanged(int combine);
+        void partialFourierChanged(int method);
+        void compressResponsesChanged(bool enable);
+        void fftBackendChanged(int backend);
+        void fftEffortChanged(int effort);
+        void fftThreadsChanged(int threads);
         
     private:
         explicit Debug(QObject *parent = nullptr);
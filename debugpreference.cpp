@@ -1,6 +1,10 @@
 #include "debugpreference.h"
 #include "ui_debugpreference.h"
 #include "debugconfig.h"
+#include "fftbackend.h"
+#include "fftwplancache.h"
+#include "parallelutils.h"
+#include "reconoptions.h"
 #include "utils.h"
 
 #include <QFileDialog>
@@ -21,6 +25,15 @@ DebugPreference::DebugPreference(QWidget *parent)
     connect(ui->enableDelayCheckBox, &QCheckBox::toggled, this, &DebugPreference::onEnableDelayChanged);
     connect(ui->logLevelComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onLogLevelChanged);
     connect(ui->logToFileCheckBox, &QCheckBox::toggled, this, &DebugPreference::onLogToFileChanged);
+    connect(ui->workerThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &DebugPreference::onWorkerThreadsChanged);
+    connect(ui->precisionComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onPrecisionChanged);
+    connect(ui->shiftFreeCheckBox, &QCheckBox::toggled, this, &DebugPreference::onShiftFreeChanged);
+    connect(ui->coilCombineComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onCoilCombineChanged);
+    connect(ui->partialFourierComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onPartialFourierChanged);
+    connect(ui->compressResponsesCheckBox, &QCheckBox::toggled, this, &DebugPreference::onCompressResponsesChanged);
+    connect(ui->fftBackendComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onFftBackendChanged);
+    connect(ui->fftEffortComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DebugPreference::onFftEffortChanged);
+    connect(ui->fftThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &DebugPreference::onFftThreadsChanged);
 }
 
 DebugPreference::~DebugPreference()
@@ -38,6 +51,19 @@ void DebugPreference::load()
     ui->logLevelComboBox->setCurrentIndex(config::Debug::logLevel());
     ui->logToFileCheckBox->setChecked(config::Debug::logToFile());
     ui->logFilePathEdit->setText(config::Debug::logFilePath());
+
+    // Load performance settings
+    ui->workerThreadsSpinBox->setValue(config::Debug::workerThreads());
+    ui->precisionComboBox->setCurrentIndex(config::Debug::precision());
+    ui->shiftFreeCheckBox->setChecked(config::Debug::shiftFree());
+    ui->coilCombineComboBox->setCurrentIndex(config::Debug::coilCombine());
+    ui->partialFourierComboBox->setCurrentIndex(config::Debug::partialFourier());
+    ui->compressResponsesCheckBox->setChecked(config::Debug::compressResponses());
+    ui->fftBackendComboBox->setCurrentIndex(static_cast<int>(fftw_utils::fftBackend().kind()));
+    ui->fftEffortComboBox->setCurrentIndex(config::Debug::fftEffort());
+    ui->fftThreadsSpinBox->setValue(config::Debug::fftThreads());
+    ui->fftThreadsSpinBox->setSpecialValueText(tr("Auto (%1)").arg(fftw_utils::physicalCores()));
+    updatePlanCacheStats();
     
     LOG_INFO("Debug preferences loaded");
 }
@@ -53,6 +79,17 @@ void DebugPreference::save()
     config::Debug::setLogLevel(ui->logLevelComboBox->currentIndex());
     config::Debug::setLogToFile(ui->logToFileCheckBox->isChecked());
     config::Debug::setLogFilePath(ui->logFilePathEdit->text());
+
+    // Save performance settings
+    config::Debug::setWorkerThreads(ui->workerThreadsSpinBox->value());
+    config::Debug::setPrecision(ui->precisionComboBox->currentIndex());
+    config::Debug::setShiftFree(ui->shiftFreeCheckBox->isChecked());
+    config::Debug::setCoilCombine(ui->coilCombineComboBox->currentIndex());
+    config::Debug::setPartialFourier(ui->partialFourierComboBox->currentIndex());
+    config::Debug::setCompressResponses(ui->compressResponsesCheckBox->isChecked());
+    config::Debug::setFftBackend(ui->fftBackendComboBox->currentIndex());
+    config::Debug::setFftEffort(ui->fftEffortComboBox->currentIndex());
+    config::Debug::setFftThreads(ui->fftThreadsSpinBox->value());
     
     LOG_INFO("Debug preferences saved");
 }
@@ -139,4 +176,98 @@ void DebugPreference::onLogFilePathChanged()
     
     // 应用日志文件路径设置
     Logger::setLogToFile(config::Debug::logToFile(), ui->logFilePathEdit->text());
-}
\ No newline at end of file
+}
+
+void DebugPreference::onWorkerThreadsChanged()
+{
+    config::Debug::setWorkerThreads(ui->workerThreadsSpinBox->value());
+
+    // Apply worker thread setting
+    parallel_utils::setMaxThreads(ui->workerThreadsSpinBox->value());
+}
+
+void DebugPreference::onPrecisionChanged()
+{
+    config::Debug::setPrecision(ui->precisionComboBox->currentIndex());
+
+    // Apply reconstruction precision
+    auto options = recon::Options::defaults();
+    options.precision = static_cast<recon::Precision>(ui->precisionComboBox->currentIndex());
+    recon::Options::setDefaults(options);
+}
+
+void DebugPreference::onShiftFreeChanged()
+{
+    config::Debug::setShiftFree(ui->shiftFreeCheckBox->isChecked());
+
+    // Apply reconstruction centring
+    auto options = recon::Options::defaults();
+    options.shiftFree = ui->shiftFreeCheckBox->isChecked();
+    recon::Options::setDefaults(options);
+}
+
+void DebugPreference::onCoilCombineChanged()
+{
+    config::Debug::setCoilCombine(ui->coilCombineComboBox->currentIndex());
+
+    // Apply coil combination
+    auto options = recon::Options::defaults();
+    options.coilCombine = static_cast<recon::CoilCombine>(ui->coilCombineComboBox->currentIndex());
+    recon::Options::setDefaults(options);
+}
+
+void DebugPreference::onPartialFourierChanged()
+{
+    config::Debug::setPartialFourier(ui->partialFourierComboBox->currentIndex());
+
+    // Apply partial Fourier reconstruction
+    auto options = recon::Options::defaults();
+    options.partialFourier = static_cast<recon::PartialFourier>(ui->partialFourierComboBox->currentIndex());
+    recon::Options::setDefaults(options);
+}
+
+void DebugPreference::onCompressResponsesChanged()
+{
+    config::Debug::setCompressResponses(ui->compressResponsesCheckBox->isChecked());
+}
+
+void DebugPreference::onFftBackendChanged()
+{
+    auto kind = static_cast<fftw_utils::FftBackendKind>(ui->fftBackendComboBox->currentIndex());
+    if (!fftw_utils::setFftBackend(kind)) {
+        // Not built in, show the backend that is still in use
+        ui->fftBackendComboBox->setCurrentIndex(static_cast<int>(fftw_utils::fftBackend().kind()));
+        return;
+    }
+    config::Debug::setFftBackend(ui->fftBackendComboBox->currentIndex());
+}
+
+void DebugPreference::onFftEffortChanged()
+{
+    config::Debug::setFftEffort(ui->fftEffortComboBox->currentIndex());
+
+    // Apply fftw planner effort
+    fftw_utils::setPlanEffort(static_cast<fftw_utils::PlanEffort>(ui->fftEffortComboBox->currentIndex()));
+}
+
+void DebugPreference::onFftThreadsChanged()
+{
+    config::Debug::setFftThreads(ui->fftThreadsSpinBox->value());
+
+    // Apply fftw thread count, plans are cached per thread count
+    fftw_utils::setFftThreads(ui->fftThreadsSpinBox->value());
+}
+
+void DebugPreference::updatePlanCacheStats()
+{
+#ifndef MRSCAN_WITH_FFTW
+    ui->planCacheValueLabel->setText(tr("Built without FFTW"));
+#else
+    auto &cache = fftw_utils::PlanCache<double>::instance();
+    auto &cacheF = fftw_utils::PlanCache<float>::instance();
+    ui->planCacheValueLabel->setText(tr("%1 plans, %2 hits, %3 misses")
+                                         .arg(cache.size() + cacheF.size())
+                                         .arg(cache.hits() + cacheF.hits())
+                                         .arg(cache.misses() + cacheF.misses()));
+#endif
+}
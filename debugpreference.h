@@ -27,8 +27,19 @@ private slots:
     void onLogLevelChanged();
     void onLogToFileChanged();
     void onLogFilePathChanged();
+    void onWorkerThreadsChanged();
+    void onPrecisionChanged();
+    void onShiftFreeChanged();
+    void onCoilCombineChanged();
+    void onPartialFourierChanged();
+    void onCompressResponsesChanged();
+    void onFftBackendChanged();
+    void onFftEffortChanged();
+    void onFftThreadsChanged();
 
 private:
+    void updatePlanCacheStats();
+
     std::unique_ptr<Ui::DebugPreference> ui;
 };
 
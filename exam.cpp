@@ -144,7 +144,12 @@ void Exam::setStatus(Status other)
 
 QVector<QVector<QImage> > Exam::images() const
 {
-    return m_response->images();
+    return m_response->images(recon::Options::fromParams(m_request.params()));
+}
+
+std::shared_ptr<IImageSource> Exam::imageSource() const
+{
+    return m_response->imageSource(recon::Options::fromParams(m_request.params()));
 }
 
 ExamRequest::ExamRequest(QJsonObject data)
@@ -65,6 +65,8 @@ public:
     QString statusString()const;
 
     QVector<QVector<QImage>> images()const;
+    /// Images reconstructed on first request, see IExamResponse::imageSource
+    std::shared_ptr<IImageSource> imageSource() const;
 private:
     ExamRequest m_request;
     std::unique_ptr<IExamResponse> m_response;
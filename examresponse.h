@@ -3,13 +3,28 @@
 
 #include <QImage>
 #include <QVector>
+#include <memory>
+
+#include "imagesource.h"
+#include "reconoptions.h"
 
 class IExamResponse {
 public:
     virtual ~IExamResponse() = default;
     virtual IExamResponse *clone() const = 0;
 
-    virtual QVector<QVector<QImage>> images() const = 0;
+    virtual QVector<QVector<QImage>> images(const recon::Options &options) const = 0;
+    /// Reconstruct with recon::Options::defaults()
+    QVector<QVector<QImage>> images() const { return images(recon::Options::defaults()); }
+
+    /**
+     * @brief Images reconstructed on demand, indexed like images()
+     * @details The default reconstructs everything up front, responses that can
+     * reconstruct a part of the data override it
+     */
+    virtual std::shared_ptr<IImageSource> imageSource(const recon::Options &options) const {
+        return std::make_shared<StaticImageSource>(images(options));
+    }
 
     virtual QByteArray bytes() const = 0;
 protected:
@@ -0,0 +1,141 @@
+#include "fftbackend.h"
+
+#include <atomic>
+#include <complex>
+#include <cstring>
+
+#include "builtinfft.h"
+#include "fftwplancache.h"
+
+namespace {
+
+using fftw_utils::FftBackendKind;
+using fftw_utils::IFftBackend;
+
+size_t batchElements(const std::vector<int> &n, int howmany) {
+    size_t count = howmany;
+    for (auto size : n) {
+        count *= size;
+    }
+    return count;
+}
+
+#ifdef MRSCAN_WITH_FFTW
+/// Plans come from PlanCache and run with the new-array interface
+class FftwBackend : public IFftBackend {
+public:
+    FftBackendKind kind() const override { return FftBackendKind::Fftw; }
+    const char *name() const override { return "FFTW"; }
+
+    bool transform(const std::vector<int> &n, int howmany, int sign, const fftw_complex *in,
+                   fftw_complex *out) override {
+        return run<double>(n, howmany, sign, in, out);
+    }
+
+    bool transform(const std::vector<int> &n, int howmany, int sign, const fftwf_complex *in,
+                   fftwf_complex *out) override {
+        return run<float>(n, howmany, sign, in, out);
+    }
+
+private:
+    template <typename Real>
+    static bool run(const std::vector<int> &n, int howmany, int sign, const Real (*in)[2],
+                    Real (*out)[2]) {
+        auto plan = fftw_utils::PlanCache<Real>::instance().get(n, sign, in, out, howmany);
+        if (!plan) {
+            return false;
+        }
+        // Out-of-place complex DFTs preserve their input, the cast only satisfies the fftw api
+        fftw_utils::Fftw<Real>::execute_dft(plan, const_cast<Real (*)[2]>(in), out);
+        return true;
+    }
+};
+#endif
+
+/// builtin_fft in place on out, lines are spread over parallel_utils workers
+class BuiltinBackend : public IFftBackend {
+public:
+    FftBackendKind kind() const override { return FftBackendKind::Builtin; }
+    const char *name() const override { return "Built-in"; }
+
+    bool transform(const std::vector<int> &n, int howmany, int sign, const fftw_complex *in,
+                   fftw_complex *out) override {
+        return run<double>(n, howmany, sign, in, out);
+    }
+
+    bool transform(const std::vector<int> &n, int howmany, int sign, const fftwf_complex *in,
+                   fftwf_complex *out) override {
+        return run<float>(n, howmany, sign, in, out);
+    }
+
+private:
+    template <typename Real>
+    static bool run(const std::vector<int> &n, int howmany, int sign, const Real (*in)[2],
+                    Real (*out)[2]) {
+        if (static_cast<const void *>(in) != static_cast<const void *>(out)) {
+            std::memcpy(out, in, batchElements(n, howmany) * sizeof(Real[2]));
+        }
+        // fftw_complex is layout compatible with std::complex
+        builtin_fft::transform(reinterpret_cast<std::complex<Real> *>(out), n, howmany, sign);
+        return true;
+    }
+};
+
+#ifdef MRSCAN_WITH_FFTW
+FftwBackend s_fftw;
+#endif
+BuiltinBackend s_builtin;
+
+IFftBackend *defaultBackend() {
+#ifdef MRSCAN_WITH_FFTW
+    return &s_fftw;
+#else
+    return &s_builtin;
+#endif
+}
+
+std::atomic<IFftBackend *> s_backend{defaultBackend()};
+
+} // namespace
+
+namespace fftw_utils {
+
+IFftBackend &fftBackend() { return *s_backend.load(); }
+
+bool setFftBackend(FftBackendKind kind) {
+    auto backend = fftBackend(kind);
+    if (!backend) {
+        LOG_WARNING(QString("FFT backend %1 is not built in, keeping %2")
+                        .arg(backendName(kind), fftBackend().name()));
+        return false;
+    }
+    s_backend = backend;
+    return true;
+}
+
+IFftBackend *fftBackend(FftBackendKind kind) {
+    switch (kind) {
+    case FftBackendKind::Fftw:
+#ifdef MRSCAN_WITH_FFTW
+        return &s_fftw;
+#else
+        return nullptr;
+#endif
+    case FftBackendKind::Builtin:
+        return &s_builtin;
+    default:
+        return nullptr;
+    }
+}
+
+const char *backendName(FftBackendKind kind) {
+    switch (kind) {
+    case FftBackendKind::Fftw:
+        return "FFTW";
+    case FftBackendKind::Builtin:
+    default:
+        return "Built-in";
+    }
+}
+
+} // namespace fftw_utils
@@ -0,0 +1,49 @@
+#ifndef FFTBACKEND_H
+#define FFTBACKEND_H
+
+#include <vector>
+
+#include "utils.h"
+
+namespace fftw_utils {
+
+/// FFT engines that can be built in, the values are stored in the Debug config
+enum class FftBackendKind { Fftw = 0, Builtin };
+
+/**
+ * @class IFftBackend
+ * @brief Engine behind exec_fft and exec_fft_inplace
+ * @details Transforms follow the FFTW conventions: unnormalized, FFTW_FORWARD (-1) or
+ * FFTW_BACKWARD (+1), howmany row-major transforms of shape n stored back to back.
+ */
+class IFftBackend {
+public:
+    virtual ~IFftBackend() = default;
+
+    virtual FftBackendKind kind() const = 0;
+    virtual const char *name() const = 0;
+
+    /**
+     * @param in,out May be the same array for an in-place transform, in is left untouched otherwise
+     * @return false if the transform could not be planned
+     */
+    virtual bool transform(const std::vector<int> &n, int howmany, int sign,
+                           const fftw_complex *in, fftw_complex *out) = 0;
+    virtual bool transform(const std::vector<int> &n, int howmany, int sign,
+                           const fftwf_complex *in, fftwf_complex *out) = 0;
+};
+
+/// Backend used by exec_fft, FFTW when it is built in, the built-in engine otherwise
+IFftBackend &fftBackend();
+
+/// @return false if kind is not built in, the current backend is kept then
+bool setFftBackend(FftBackendKind kind);
+
+/// Backend of a kind, nullptr if it is not built in
+IFftBackend *fftBackend(FftBackendKind kind);
+
+const char *backendName(FftBackendKind kind);
+
+} // namespace fftw_utils
+
+#endif // FFTBACKEND_H
@@ -0,0 +1,170 @@
+#include "fftshift.h"
+
+#include <algorithm>
+#include <complex>
+#include <numeric>
+
+#include "parallelutils.h"
+
+namespace fftw_utils {
+
+namespace {
+
+/// Elements per tile of the row swaps, 32 KiB of fftw_complex
+constexpr size_t kShiftTile = 2048;
+/// Below this many elements a shift runs on the calling thread only
+constexpr size_t kShiftParallelMin = size_t(1) << 20;
+
+/**
+ * @brief Rotate rows [0, n) of block by shift rows, row i moves to (i + shift) % n
+ * @details Only columns [begin, begin + len) of each row are moved, tmp holds len elements
+ */
+template <typename T>
+void rotateRows(T *block, size_t n, size_t rowLength, size_t shift, size_t begin, size_t len,
+                T *tmp) {
+    auto row = [&](size_t i) { return block + i * rowLength + begin; };
+
+    if (2 * shift == n) {
+        // Even length, swap the two halves
+        for (size_t i = 0; i < shift; i++) {
+            std::swap_ranges(row(i), row(i) + len, row(i + shift));
+        }
+        return;
+    }
+
+    // Odd length, follow the cycles of the permutation, gcd(n, shift) of them
+    auto cycles = std::gcd(n, shift);
+    for (size_t start = 0; start < cycles; start++) {
+        std::copy_n(row(start), len, tmp);
+        auto dst = start;
+        auto src = (dst + n - shift) % n;
+        while (src != start) {
+            std::copy_n(row(src), len, row(dst));
+            dst = src;
+            src = (dst + n - shift) % n;
+        }
+        std::copy_n(tmp, len, row(dst));
+    }
+}
+
+/// Rotate a contiguous row so that element i moves to (i + shift) % n
+template <typename T>
+void rotateRow(T *first, size_t n, size_t shift) {
+    if (2 * shift == n) {
+        std::swap_ranges(first, first + shift, first + shift);
+    } else {
+        std::rotate(first, first + (n - shift), first + n);
+    }
+}
+
+/// Rotate every selected axis by half its length, see fftshift
+template <typename T>
+bool shiftAxes(T *data, const std::vector<int> &shape, const std::vector<int> &axes, bool inverse,
+               int workers) {
+    const auto rank = static_cast<int>(shape.size());
+    std::vector<bool> selected(rank, axes.empty());
+    for (auto axis : axes) {
+        if (axis < 0 || axis >= rank) {
+            return false;
+        }
+        selected[axis] = true;
+    }
+
+    size_t total = 1;
+    for (auto n : shape) {
+        if (n <= 0) {
+            return true;
+        }
+        total *= n;
+    }
+    auto shiftOf = [&](int axis) -> size_t {
+        size_t n = shape[axis];
+        return inverse ? n - n / 2 : n / 2;
+    };
+    if (total < kShiftParallelMin) {
+        workers = 1;
+    }
+
+    for (int axis = 0; axis < rank; axis++) {
+        const size_t n = shape[axis];
+        const size_t shift = shiftOf(axis);
+        if (!selected[axis] || shift == 0 || shift == n) {
+            continue;
+        }
+
+        // The axis splits the array into [outer][n][rowLength]
+        size_t rowLength = 1;
+        for (int d = axis + 1; d < rank; d++) {
+            rowLength *= shape[d];
+        }
+        const size_t outer = total / (n * rowLength);
+
+        if (rowLength == 1) {
+            // Last axis, rotate whole contiguous rows, several per task
+            const size_t rowsPerTask = std::max<size_t>(1, kShiftTile / n);
+            const auto tasks = static_cast<int>((outer + rowsPerTask - 1) / rowsPerTask);
+            parallel_utils::parallelFor(0, tasks, [&](int task) {
+                auto last = std::min(outer, (task + 1) * rowsPerTask);
+                for (size_t o = task * rowsPerTask; o < last; o++) {
+                    rotateRow(data + o * n, n, shift);
+                }
+            }, workers);
+            continue;
+        }
+
+        // The rows of the second to last axis fit in one tile, shift the last axis of the
+        // block while it is still in cache instead of in another pass
+        const size_t lastShift = shiftOf(rank - 1);
+        const bool fuseLast = axis == rank - 2 && selected[rank - 1] && rowLength <= kShiftTile &&
+                              lastShift != 0 && lastShift != rowLength;
+        if (fuseLast) {
+            selected[rank - 1] = false;
+        }
+
+        // Tasks are (outer block, column tile) pairs, each moves n tiles
+        const size_t tiles = (rowLength + kShiftTile - 1) / kShiftTile;
+        const auto tasks = static_cast<int>(outer * tiles);
+        parallel_utils::parallelFor(0, tasks, [&](int task) {
+            thread_local std::vector<T> tmp;
+            tmp.resize(kShiftTile);
+            auto o = task / tiles;
+            auto begin = (task % tiles) * kShiftTile;
+            auto len = std::min(kShiftTile, rowLength - begin);
+            auto block = data + o * n * rowLength;
+            rotateRows(block, n, rowLength, shift, begin, len, tmp.data());
+            if (fuseLast) {
+                for (size_t i = 0; i < n; i++) {
+                    rotateRow(block + i * rowLength, rowLength, lastShift);
+                }
+            }
+        }, workers);
+    }
+    return true;
+}
+
+
+} // namespace
+
+template <typename Real>
+bool fftshift(Real (*data)[2], const std::vector<int> &shape, const std::vector<int> &axes,
+              int workers) {
+    // fftw_complex is layout compatible with std::complex, which the std algorithms can move
+    return shiftAxes(reinterpret_cast<std::complex<Real> *>(data), shape, axes, false, workers);
+}
+
+template <typename Real>
+bool ifftshift(Real (*data)[2], const std::vector<int> &shape, const std::vector<int> &axes,
+               int workers) {
+    return shiftAxes(reinterpret_cast<std::complex<Real> *>(data), shape, axes, true, workers);
+}
+
+template bool fftshift(double (*data)[2], const std::vector<int> &shape,
+                       const std::vector<int> &axes, int workers);
+template bool fftshift(float (*data)[2], const std::vector<int> &shape,
+                       const std::vector<int> &axes, int workers);
+template bool ifftshift(double (*data)[2], const std::vector<int> &shape,
+                        const std::vector<int> &axes, int workers);
+template bool ifftshift(float (*data)[2], const std::vector<int> &shape,
+                        const std::vector<int> &axes, int workers);
+
+} // namespace fftw_utils
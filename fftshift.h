@@ -0,0 +1,32 @@
+#ifndef FFTSHIFT_H
+#define FFTSHIFT_H
+
+#include <vector>
+
+/**
+ * @brief In-place fftshift/ifftshift of row-major complex arrays
+ * @details Free of Qt like simd_utils, utils.h includes it with the rest of fftw_utils
+ */
+namespace fftw_utils {
+
+/**
+ * @brief Move the zero frequency to the centre, in place, like numpy.fft.fftshift
+ * @param shape Row-major shape of data, any rank
+ * @param axes Axes to shift, all axes if empty
+ * @param workers Threads, <= 0 means parallel_utils::maxThreads(), small arrays use one
+ * @details Each axis is rotated by blocked row swaps (cycles for odd lengths), the only
+ * temporary is one tile per thread
+ * @return false if an axis is out of range, data is then left untouched
+ */
+template <typename Real>
+bool fftshift(Real (*data)[2], const std::vector<int> &shape, const std::vector<int> &axes = {},
+              int workers = 0);
+
+/// Inverse of fftshift, differs from it only for odd lengths
+template <typename Real>
+bool ifftshift(Real (*data)[2], const std::vector<int> &shape, const std::vector<int> &axes = {},
+               int workers = 0);
+
+} // namespace fftw_utils
+
+#endif // FFTSHIFT_H
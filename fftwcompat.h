@@ -0,0 +1,43 @@
+#ifndef FFTWCOMPAT_H
+#define FFTWCOMPAT_H
+
+/**
+ * @brief fftw3.h, or the parts of it the rest of the code uses when FFTW is not built in
+ * @details Without MRSCAN_WITH_FFTW the transforms run on the built-in backend
+ * (builtinfft.h), fftw_complex and its allocator keep their layout and alignment so the
+ * k-space buffers stay the same.
+ */
+#ifdef MRSCAN_WITH_FFTW
+#include <fftw3.h>
+#else
+#include <cstddef>
+#include <new>
+
+typedef double fftw_complex[2];
+typedef float fftwf_complex[2];
+
+#define FFTW_FORWARD (-1)
+#define FFTW_BACKWARD (+1)
+
+namespace fftw_compat {
+/// Same alignment as nd_utils::kAlignment, enough for the SIMD kernels
+constexpr std::size_t kAlignment = 64;
+
+inline void *malloc(std::size_t size) {
+    return ::operator new(size, std::align_val_t{kAlignment}, std::nothrow);
+}
+
+inline void free(void *ptr) { ::operator delete(ptr, std::align_val_t{kAlignment}); }
+} // namespace fftw_compat
+
+inline void fftw_free(void *ptr) { fftw_compat::free(ptr); }
+inline void fftwf_free(void *ptr) { fftw_compat::free(ptr); }
+inline fftw_complex *fftw_alloc_complex(std::size_t n) {
+    return static_cast<fftw_complex *>(fftw_compat::malloc(n * sizeof(fftw_complex)));
+}
+inline fftwf_complex *fftwf_alloc_complex(std::size_t n) {
+    return static_cast<fftwf_complex *>(fftw_compat::malloc(n * sizeof(fftwf_complex)));
+}
+#endif
+
+#endif // FFTWCOMPAT_H
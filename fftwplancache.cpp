@@ -0,0 +1,289 @@
+#include "fftwplancache.h"
+
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+std::atomic<int> s_planEffort{static_cast<int>(fftw_utils::PlanEffort::Estimate)};
+std::atomic<bool> s_threadsEnabled{false};
+/// Requested thread count, <= 0 means physical cores
+std::atomic<int> s_fftThreads{0};
+
+std::mutex s_wisdomMutex;
+QString s_wisdomDir;
+
+#ifdef MRSCAN_WITH_FFTW
+template <typename Real>
+const char *wisdomFileName();
+
+template <>
+const char *wisdomFileName<double>() {
+    return "fftw_wisdom.txt";
+}
+
+template <>
+const char *wisdomFileName<float>() {
+    return "fftwf_wisdom.txt";
+}
+
+/// 0 for arrays with the alignment fftw_malloc gives, the planner treats others as UNALIGNED
+template <typename Real>
+int alignmentOf(const Real (*p)[2]) {
+    return fftw_utils::Fftw<Real>::alignment_of(const_cast<Real *>(&p[0][0]));
+}
+
+template <typename Real>
+QString wisdomPath(const QString &dir) {
+    return QDir(dir).filePath(wisdomFileName<Real>());
+}
+
+QByteArray nativePath(const QString &path) {
+    return QDir::toNativeSeparators(path).toLocal8Bit();
+}
+#endif // MRSCAN_WITH_FFTW
+
+} // namespace
+
+namespace fftw_utils {
+
+PlanEffort planEffort() { return static_cast<PlanEffort>(s_planEffort.load()); }
+
+void setPlanEffort(PlanEffort effort) { s_planEffort = static_cast<int>(effort); }
+
+bool initThreads() {
+#ifdef MRSCAN_FFTW_THREADS
+    if (s_threadsEnabled) {
+        return true;
+    }
+    if (!Fftw<double>::init_threads() || !Fftw<float>::init_threads()) {
+        LOG_WARNING("Failed to initialize fftw threads, FFTs run single threaded");
+        return false;
+    }
+    s_threadsEnabled = true;
+    return true;
+#else
+    LOG_INFO("Built without MRSCAN_FFTW_THREADS, FFTs run single threaded");
+    return false;
+#endif
+}
+
+int fftThreads() {
+    if (!s_threadsEnabled) {
+        return 1;
+    }
+    auto threads = s_fftThreads.load();
+    return threads > 0 ? threads : physicalCores();
+}
+
+void setFftThreads(int threads) { s_fftThreads = threads; }
+
+int physicalCores() {
+    static const int s_cores = []() {
+        int cores = 0;
+#ifdef Q_OS_WIN
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+        std::vector<char> buffer(length);
+        auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+        if (length > 0 && GetLogicalProcessorInformationEx(RelationProcessorCore, info, &length)) {
+            for (DWORD offset = 0; offset < length;) {
+                auto entry = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+                cores++;
+                offset += entry->Size;
+            }
+        }
+#elif defined(Q_OS_LINUX)
+        // Logical CPUs of one core share a thread_siblings_list
+        std::set<QByteArray> siblings;
+        for (int cpu = 0;; cpu++) {
+            QFile file(QString("/sys/devices/system/cpu/cpu%1/topology/thread_siblings_list").arg(cpu));
+            if (!file.open(QIODevice::ReadOnly)) {
+                break;
+            }
+            siblings.insert(file.readAll().trimmed());
+        }
+        cores = static_cast<int>(siblings.size());
+#endif
+        if (cores <= 0) {
+            cores = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        return std::max(cores, 1);
+    }();
+    return s_cores;
+}
+
+#ifdef MRSCAN_WITH_FFTW
+unsigned plannerFlags(PlanEffort effort) {
+    switch (effort) {
+    case PlanEffort::Measure:
+        return FFTW_MEASURE;
+    case PlanEffort::Patient:
+        return FFTW_PATIENT;
+    case PlanEffort::Estimate:
+    default:
+        return FFTW_ESTIMATE;
+    }
+}
+
+template <typename Real>
+bool PlanCache<Real>::Key::operator<(const Key &other) const {
+    return std::tie(n, howmany, sign, inPlace, inAlignment, outAlignment, flags, threads) <
+           std::tie(other.n, other.howmany, other.sign, other.inPlace, other.inAlignment,
+                    other.outAlignment, other.flags, other.threads);
+}
+
+template <typename Real>
+PlanCache<Real> &PlanCache<Real>::instance() {
+    static PlanCache s_instance;
+    return s_instance;
+}
+
+template <typename Real>
+PlanCache<Real>::~PlanCache() {
+    clear();
+}
+
+template <typename Real>
+typename PlanCache<Real>::Plan PlanCache<Real>::get(const std::vector<int> &n, int sign,
+                                                    const Real (*in)[2], Real (*out)[2],
+                                                    int howmany) {
+    auto effort = planEffort();
+
+    Key key;
+    key.n = n;
+    key.howmany = howmany;
+    key.sign = sign;
+    key.inPlace = static_cast<const void *>(in) == static_cast<const void *>(out);
+    key.inAlignment = alignmentOf(in);
+    key.outAlignment = alignmentOf<Real>(out);
+    key.flags = plannerFlags(effort);
+    if (key.inAlignment != 0 || key.outAlignment != 0) {
+        key.flags |= FFTW_UNALIGNED;
+    }
+    key.threads = fftThreads();
+
+    // The fftw planner is not thread-safe, planning and cache lookups share the lock
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_plans.find(key);
+    if (it != m_plans.end()) {
+        m_hits++;
+        return it->second;
+    }
+    m_misses++;
+
+    size_t dist = 1;
+    for (auto size : n) {
+        dist *= size;
+    }
+    // MEASURE and PATIENT overwrite the arrays while planning
+    auto scratchIn = createArray<Real>(dist * howmany);
+    complex_ptr<Real> scratchOut;
+    if (!key.inPlace) {
+        scratchOut = createArray<Real>(dist * howmany);
+    }
+    auto scratchOutPtr = key.inPlace ? scratchIn.get() : scratchOut.get();
+
+#ifdef MRSCAN_FFTW_THREADS
+    if (s_threadsEnabled) {
+        Fftw<Real>::plan_with_nthreads(key.threads);
+    }
+#endif
+    auto plan = Fftw<Real>::plan_many_dft(static_cast<int>(n.size()), n.data(), howmany,
+                                          scratchIn.get(), 1, static_cast<int>(dist),
+                                          scratchOutPtr, 1, static_cast<int>(dist), sign,
+                                          key.flags);
+    if (!plan) {
+        LOG_ERROR("Failed to create FFT plan");
+        return nullptr;
+    }
+    m_plans.emplace(std::move(key), plan);
+
+    // Keep the tuning result even if the application does not exit cleanly
+    auto dir = wisdomDir();
+    if (effort != PlanEffort::Estimate && !dir.isEmpty()) {
+        exportWisdomLocked(wisdomPath<Real>(dir));
+    }
+    return plan;
+}
+
+template <typename Real>
+void PlanCache<Real>::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &[key, plan] : m_plans) {
+        Fftw<Real>::destroy_plan(plan);
+    }
+    m_plans.clear();
+}
+
+template <typename Real>
+size_t PlanCache<Real>::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_plans.size();
+}
+
+template <typename Real>
+void PlanCache<Real>::importWisdom(const QString &path) {
+    if (!QFile::exists(path)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!Fftw<Real>::import_wisdom_from_filename(nativePath(path).constData())) {
+        LOG_WARNING(QString("Failed to import fftw wisdom from %1").arg(path));
+    }
+}
+
+template <typename Real>
+void PlanCache<Real>::exportWisdom(const QString &path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    exportWisdomLocked(path);
+}
+
+template <typename Real>
+void PlanCache<Real>::exportWisdomLocked(const QString &path) {
+    if (!Fftw<Real>::export_wisdom_to_filename(nativePath(path).constData())) {
+        LOG_WARNING(QString("Failed to export fftw wisdom to %1").arg(path));
+    }
+}
+
+template class PlanCache<double>;
+template class PlanCache<float>;
+#endif // MRSCAN_WITH_FFTW
+
+void importWisdom(const QString &dir) {
+    {
+        std::lock_guard<std::mutex> lock(s_wisdomMutex);
+        s_wisdomDir = dir;
+    }
+
+#ifdef MRSCAN_WITH_FFTW
+    PlanCache<double>::instance().importWisdom(wisdomPath<double>(dir));
+    PlanCache<float>::instance().importWisdom(wisdomPath<float>(dir));
+#endif
+}
+
+void exportWisdom(const QString &dir) {
+#ifdef MRSCAN_WITH_FFTW
+    PlanCache<double>::instance().exportWisdom(wisdomPath<double>(dir));
+    PlanCache<float>::instance().exportWisdom(wisdomPath<float>(dir));
+#else
+    Q_UNUSED(dir);
+#endif
+}
+
+QString wisdomDir() {
+    std::lock_guard<std::mutex> lock(s_wisdomMutex);
+    return s_wisdomDir;
+}
+
+} // namespace fftw_utils
@@ -0,0 +1,113 @@
+#ifndef FFTWPLANCACHE_H
+#define FFTWPLANCACHE_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "utils.h"
+
+namespace fftw_utils {
+
+/// How long the fftw planner may search for a fast plan
+enum class PlanEffort { Estimate = 0, Measure, Patient };
+
+PlanEffort planEffort();
+/// Used by plans created from now on, cached plans of another effort stay valid
+void setPlanEffort(PlanEffort effort);
+
+/**
+ * @brief Start the fftw threads backend, must be called once before any plan is made
+ * @return false if fftw was built without threads, every plan then runs on one thread
+ */
+bool initThreads();
+/// Threads used by plans created from now on
+int fftThreads();
+/// @param threads <= 0 means physicalCores()
+void setFftThreads(int threads);
+/// Physical cores of the machine, hyper-threads share the FFT units so they are not counted
+int physicalCores();
+
+#ifdef MRSCAN_WITH_FFTW
+unsigned plannerFlags(PlanEffort effort);
+
+/**
+ * @class PlanCache
+ * @brief Thread-safe cache of fftw plans, a plan is created once per layout and reused
+ * @details Plans are executed with the new-array interface, so a plan only depends on the
+ * transform size, batch layout, direction, in-place-ness and SIMD alignment of the
+ * arrays, not on their addresses. Planning happens on scratch arrays, MEASURE and
+ * PATIENT never overwrite the caller's data.
+ */
+template <typename Real>
+class PlanCache {
+public:
+    using Plan = typename Fftw<Real>::plan;
+
+    static PlanCache &instance();
+
+    /**
+     * @brief Plan of howmany contiguous transforms of shape n, dist apart
+     * @param in,out Only their alignment and whether they are the same array matter
+     * @return nullptr if fftw failed to plan
+     */
+    Plan get(const std::vector<int> &n, int sign, const Real (*in)[2], Real (*out)[2],
+             int howmany = 1);
+
+    /// Destroy every cached plan
+    void clear();
+
+    /// Wisdom calls go through the cache because they must not run concurrently with the planner
+    void importWisdom(const QString &path);
+    void exportWisdom(const QString &path);
+
+    std::uint64_t hits() const { return m_hits; }
+    std::uint64_t misses() const { return m_misses; }
+    size_t size() const;
+
+private:
+    PlanCache() = default;
+    ~PlanCache();
+
+    void exportWisdomLocked(const QString &path);
+
+    struct Key {
+        std::vector<int> n;
+        int howmany = 1;
+        int sign = 0;
+        bool inPlace = false;
+        int inAlignment = 0;
+        int outAlignment = 0;
+        unsigned flags = 0;
+        int threads = 1;
+
+        bool operator<(const Key &other) const;
+    };
+
+    /// Serializes every planner call of this precision
+    mutable std::mutex m_mutex;
+    std::map<Key, Plan> m_plans;
+    std::atomic<std::uint64_t> m_hits{0};
+    std::atomic<std::uint64_t> m_misses{0};
+};
+
+extern template class PlanCache<double>;
+extern template class PlanCache<float>;
+#endif // MRSCAN_WITH_FFTW
+
+/**
+ * @brief Load accumulated planner knowledge of both precisions, nothing without FFTW
+ * @param dir Directory holding fftw_wisdom.txt and fftwf_wisdom.txt
+ */
+void importWisdom(const QString &dir);
+/// Save the planner knowledge, called after every MEASURE/PATIENT plan
+void exportWisdom(const QString &dir);
+/// Directory given to importWisdom, wisdom is exported there
+QString wisdomDir();
+
+} // namespace fftw_utils
+
+#endif // FFTWPLANCACHE_H
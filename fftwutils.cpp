@@ -1,19 +1,23 @@
 #include "utils.h"
 
+#include "fftbackend.h"
+
 namespace fftw_utils{
-fftw_complex_ptr createArray(size_t size){
-    auto ptr = static_cast<fftw_complex*>(fftw_alloc_complex(size));
+template <typename Real>
+complex_ptr<Real> createArray(size_t size){
+    auto ptr = Fftw<Real>::alloc(size);
     if(!ptr){
         auto msg = QString("Failed to create fftw_complex array of size %1").arg(size);
         LOG_ERROR(msg);
         throw std::runtime_error(msg.toStdString());
     }
-    return fftw_complex_ptr(ptr);
+    return complex_ptr<Real>(ptr);
 }
 
-std::vector<double> abs(fftw_complex* array, size_t len){
-    auto magnitude = std::vector<double>(len);
-    for(int i=0;i<len;i++){
+template <typename Real>
+std::vector<Real> abs(Real (*array)[2], size_t len){
+    auto magnitude = std::vector<Real>(len);
+    for(size_t i=0;i<len;i++){
         auto real = array[i][0];
         auto imag = array[i][1];
         magnitude[i] = sqrt(real*real + imag*imag);
@@ -21,64 +25,61 @@ std::vector<double> abs(fftw_complex* array, size_t len){
     return magnitude;
 }
 
-fftw_complex_ptr exec_fft_3d(fftw_complex* in, std::vector<int> n){
-    size_t noPixels = 1;
-    for(int i=0;i<3;i++){
-        noPixels *= n[i];
+namespace {
+
+/// Elements of howmany transforms of shape n, 0 if any size is not positive
+size_t batchSize(const std::vector<int>& n, int howmany){
+    if(n.empty() || howmany <= 0){
+        return 0;
+    }
+    size_t noPixels = howmany;
+    for(auto size : n){
+        if(size <= 0){
+            return 0;
+        }
+        noPixels *= size;
     }
+    return noPixels;
+}
+
+} // namespace
+
+template <typename Real>
+complex_ptr<Real> exec_fft(const Real (*in)[2], const std::vector<int>& n, int howmany){
+    auto noPixels = batchSize(n, howmany);
     if(noPixels == 0){
         LOG_ERROR("exec fft error: 0 in n");
         return {};
     }
 
-    auto out = fftw_utils::createArray(noPixels);
-    fftw_plan plan = fftw_plan_dft(3, n.data(), in, out.get(), FFTW_FORWARD, FFTW_ESTIMATE);
-    if (!plan) {
-        LOG_ERROR("Failed to create FFT plan");
-        fftw_free(out.release()); // If plan creation fails, need to free out memory, as smart pointer won't auto-release at this point
+    auto out = fftw_utils::createArray<Real>(noPixels);
+    if (!fftBackend().transform(n, howmany, FFTW_FORWARD, in, out.get())) {
         return {};
     }
-
-    fftw_execute(plan);
-    fftw_destroy_plan(plan);
     return out;
 }
 
-void fftshift3d(fftw_complex* data, std::vector<int> shape) {
-    const size_t nx = shape[0];
-    const size_t ny = shape[1];
-    const size_t nz = shape[2];
-
-    const size_t sx = nx / 2;
-    const size_t sy = ny / 2;
-    const size_t sz = nz / 2;
-
-    auto temp = fftw_utils::createArray(nx * ny * nz);
-
-    // Iterate through each element and rearrange
-    for (size_t x = 0; x < nx; ++x) {
-        for (size_t y = 0; y < ny; ++y) {
-            for (size_t z = 0; z < nz; ++z) {
-                // Calculate new coordinates (circular shift)
-                const size_t new_x = (x + sx) % nx;
-                const size_t new_y = (y + sy) % ny;
-                const size_t new_z = (z + sz) % nz;
-
-                // Calculate new and old linear indices
-                const size_t old_idx = x * ny * nz + y * nz + z;
-                const size_t new_idx = new_x * ny * nz + new_y * nz + new_z;
-
-                // Copy data to temporary array
-                temp[new_idx][0] = data[old_idx][0];
-                temp[new_idx][1] = data[old_idx][1];
-            }
-        }
+template <typename Real>
+bool exec_fft_inplace(Real (*data)[2], const std::vector<int>& n, int howmany){
+    if(batchSize(n, howmany) == 0){
+        LOG_ERROR("exec fft error: 0 in n");
+        return false;
     }
 
-    std::memcpy(data, temp.get(), sizeof(fftw_complex) * nx * ny * nz);
+    return fftBackend().transform(n, howmany, FFTW_FORWARD, data, data);
 }
 
-int getIndex(std::vector<int> shape, std::vector<int> indices){
+template <typename Real>
+bool exec_ifft_inplace(Real (*data)[2], const std::vector<int>& n, int howmany){
+    if(batchSize(n, howmany) == 0){
+        LOG_ERROR("exec ifft error: 0 in n");
+        return false;
+    }
+
+    return fftBackend().transform(n, howmany, FFTW_BACKWARD, data, data);
+}
+
+int getIndex(const std::vector<int>& shape, const std::vector<int>& indices){
     if(shape.size() != indices.size()){
         throw std::runtime_error("Shape and indices size mismatch.");
     }
@@ -92,4 +93,15 @@ int getIndex(std::vector<int> shape, std::vector<int> indices){
     return index;
 }
 
+template complex_ptr<double> createArray<double>(size_t size);
+template complex_ptr<float> createArray<float>(size_t size);
+template std::vector<double> abs(double (*array)[2], size_t len);
+template std::vector<float> abs(float (*array)[2], size_t len);
+template complex_ptr<double> exec_fft(const double (*in)[2], const std::vector<int>& n, int howmany);
+template complex_ptr<float> exec_fft(const float (*in)[2], const std::vector<int>& n, int howmany);
+template bool exec_fft_inplace(double (*data)[2], const std::vector<int>& n, int howmany);
+template bool exec_fft_inplace(float (*data)[2], const std::vector<int>& n, int howmany);
+template bool exec_ifft_inplace(double (*data)[2], const std::vector<int>& n, int howmany);
+template bool exec_ifft_inplace(float (*data)[2], const std::vector<int>& n, int howmany);
+
 } // namespace FFTW
@@ -3,6 +3,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
+#include <QSaveFile>
 
 namespace file_utils{
 
@@ -17,15 +18,20 @@ QByteArray read(const QString& fpath){
     return data;
 }
 
-void save(const QString& fpath, QByteArray content){
-    QFile file(fpath);
+bool save(const QString& fpath, QByteArray content){
+    // Written to a temporary file renamed over fpath on commit, a failed write keeps the old file
+    QSaveFile file(fpath);
 
     if(!file.open(QIODevice::WriteOnly)){
         LOG_ERROR(QString("Failed to open file:%1 Error: %2").arg(fpath, file.errorString()));
-        return;
+        return false;
     }
 
-    file.write(content);
+    if(file.write(content) != content.size() || !file.commit()){
+        LOG_ERROR(QString("Failed to write file:%1 Error: %2").arg(fpath, file.errorString()));
+        return false;
+    }
+    return true;
 }
 
 } // namespace file_utils
@@ -0,0 +1,319 @@
+#include "grappa.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+#include "parallelutils.h"
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/// First source view of a kernel relative to the acquired view below the gap, in units of acceleration
+constexpr int kFirstSource = 1 - grappa::kKernelViews / 2;
+constexpr int kHalfSamples = grappa::kKernelSamples / 2;
+
+/// [blocks][views][views2][samples] of every coil
+template <typename Real>
+using Volumes = std::vector<typename mrd_utils::BasicMrd<Real>::Volumes>;
+
+/**
+ * @brief Weights of one block, (acceleration - 1) targets of coils values from sources() values
+ * @details weights[(source * gaps + gap) * coils + coil], a target is the sum of source * weight
+ */
+struct Kernel {
+    std::vector<Complex> weights;
+};
+
+/// Sources of the kernel: coils * kKernelViews * kKernelSamples
+int sources(int coils) { return coils * grappa::kKernelViews * grappa::kKernelSamples; }
+
+/**
+ * @brief Gather the sources of the gap above view base, views outside the acquired range are zero
+ * @return false if none of the source views was acquired
+ */
+template <typename Real>
+bool gather(const Volumes<Real> &data, const grappa::Sampling &sampling, int block, int base,
+            int partition, int sample, Complex *out) {
+    const int views = static_cast<int>(data.front().shape(1));
+    const int samples = static_cast<int>(data.front().shape(3));
+    bool any = false;
+    for (size_t c = 0; c < data.size(); c++) {
+        for (int j = 0; j < grappa::kKernelViews; j++) {
+            const int view = base + (kFirstSource + j) * sampling.acceleration;
+            const bool acquired = view >= 0 && view < views && sampling.isAcquired(view);
+            any = any || acquired;
+            for (int dx = -kHalfSamples; dx <= kHalfSamples; dx++) {
+                const int x = sample + dx;
+                if (!acquired || x < 0 || x >= samples) {
+                    *out++ = 0;
+                    continue;
+                }
+                const auto &value = data[c](block, view, partition, x);
+                *out++ = Complex(value[0], value[1]);
+            }
+        }
+    }
+    return any;
+}
+
+/// Solve (A) X = B in place for Hermitian positive definite A, n x n, B n x m, by Cholesky
+bool solveCholesky(std::vector<Complex> &a, std::vector<Complex> &b, int n, int m) {
+    // Lower triangle of a becomes L with A = L L^H
+    for (int j = 0; j < n; j++) {
+        double diagonal = a[j * n + j].real();
+        for (int k = 0; k < j; k++) {
+            diagonal -= std::norm(a[j * n + k]);
+        }
+        if (diagonal <= 0) {
+            return false;
+        }
+        diagonal = std::sqrt(diagonal);
+        a[j * n + j] = diagonal;
+        for (int i = j + 1; i < n; i++) {
+            // A is stored upper, its lower entry (i, j) is conj(a[j][i])
+            Complex sum = std::conj(a[j * n + i]);
+            for (int k = 0; k < j; k++) {
+                sum -= a[i * n + k] * std::conj(a[j * n + k]);
+            }
+            a[i * n + j] = sum / diagonal;
+        }
+    }
+
+    for (int col = 0; col < m; col++) {
+        // L y = b
+        for (int i = 0; i < n; i++) {
+            Complex sum = b[i * m + col];
+            for (int k = 0; k < i; k++) {
+                sum -= a[i * n + k] * b[k * m + col];
+            }
+            b[i * m + col] = sum / a[i * n + i].real();
+        }
+        // L^H x = y
+        for (int i = n - 1; i >= 0; i--) {
+            Complex sum = b[i * m + col];
+            for (int k = i + 1; k < n; k++) {
+                sum -= std::conj(a[k * n + i]) * b[k * m + col];
+            }
+            b[i * m + col] = sum / a[i * n + i].real();
+        }
+    }
+    return true;
+}
+
+/// Least squares fit of one block on the ACS band, empty weights if it failed or was cancelled
+template <typename Real>
+Kernel calibrate(const Volumes<Real> &data, const grappa::Sampling &sampling, int block,
+                 const std::atomic<bool> *cancelled) {
+    const int coils = static_cast<int>(data.size());
+    const int views2 = static_cast<int>(data.front().shape(2));
+    const int samples = static_cast<int>(data.front().shape(3));
+    const int n = sources(coils);
+    const int gaps = sampling.acceleration - 1;
+    const int m = gaps * coils;
+    const int R = sampling.acceleration;
+
+    // Every source and target of the kernel lies in the fully sampled band
+    const int firstBase = sampling.acsBegin() - kFirstSource * R;
+    const int lastBase = sampling.acsEnd() - 1 - (kFirstSource + grappa::kKernelViews - 1) * R;
+
+    // Normal equations, upper triangle of A = S^H S and B = S^H T
+    std::vector<Complex> a(static_cast<size_t>(n) * n);
+    std::vector<Complex> b(static_cast<size_t>(n) * m);
+    std::vector<Complex> source(n);
+    size_t fits = 0;
+    for (int base = firstBase; base <= lastBase; base++) {
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+            return {};
+        }
+        for (int z = 0; z < views2; z++) {
+            for (int x = kHalfSamples; x < samples - kHalfSamples; x++) {
+                gather<Real>(data, sampling, block, base, z, x, source.data());
+                for (int i = 0; i < n; i++) {
+                    auto conjugate = std::conj(source[i]);
+                    auto row = a.data() + static_cast<size_t>(i) * n;
+                    for (int j = i; j < n; j++) {
+                        row[j] += conjugate * source[j];
+                    }
+                    auto targets = b.data() + static_cast<size_t>(i) * m;
+                    for (int gap = 0; gap < gaps; gap++) {
+                        for (int c = 0; c < coils; c++) {
+                            const auto &value = data[c](block, base + gap + 1, z, x);
+                            targets[gap * coils + c] += conjugate * Complex(value[0], value[1]);
+                        }
+                    }
+                }
+                fits++;
+            }
+        }
+    }
+    if (fits == 0) {
+        return {};
+    }
+
+    double trace = 0;
+    for (int i = 0; i < n; i++) {
+        trace += a[static_cast<size_t>(i) * n + i].real();
+    }
+    const double lambda = grappa::kRegularization * trace / n;
+    for (int i = 0; i < n; i++) {
+        a[static_cast<size_t>(i) * n + i] += lambda;
+    }
+
+    if (!solveCholesky(a, b, n, m)) {
+        return {};
+    }
+    return {std::move(b)};
+}
+
+} // namespace
+
+namespace grappa {
+
+Sampling::Sampling(int views, int acceleration, int acsLines)
+    : views(views), acceleration(std::max(acceleration, 1)),
+      acsLines(std::clamp(acsLines, 0, views)), first(0), last(views) {}
+
+int Sampling::acsBegin() const { return centre() - acsLines / 2; }
+
+int Sampling::acsEnd() const { return acsBegin() + acsLines; }
+
+bool Sampling::isPattern(int view) const {
+    auto distance = view - centre();
+    return distance % acceleration == 0;
+}
+
+bool Sampling::isAcquired(int view) const {
+    if (view < first || view >= last) {
+        return false;
+    }
+    return isPattern(view) || (view >= acsBegin() && view < acsEnd());
+}
+
+template <typename Real>
+bool reconstruct(QVector<mrd_utils::BasicMrd<Real>> &coils, const Sampling &sampling,
+                 const std::atomic<bool> *cancelled) {
+    auto isCancelled = [cancelled] { return cancelled && cancelled->load(std::memory_order_relaxed); };
+    if (!sampling.isUndersampled() || coils.isEmpty()) {
+        return false;
+    }
+    const auto &first = coils.front();
+    const auto shape = first.shape();
+    for (const auto &coil : coils) {
+        if (!coil.kdata || coil.transformed || coil.shape() != shape) {
+            LOG_ERROR("GRAPPA needs untransformed coils of the same shape");
+            return false;
+        }
+    }
+    if (first.views != sampling.views) {
+        LOG_ERROR(QString("GRAPPA sampling has %1 views, the data %2")
+                      .arg(sampling.views)
+                      .arg(first.views));
+        return false;
+    }
+    // The kernel spans kKernelViews acquired views, the band must hold at least one fit
+    if (sampling.acsLines < (kKernelViews - 1) * sampling.acceleration + 1) {
+        LOG_ERROR(QString("%1 ACS views are too few for acceleration %2")
+                      .arg(sampling.acsLines)
+                      .arg(sampling.acceleration));
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int blocks = first.experiments * first.echoes * first.slices;
+    const int coilCount = static_cast<int>(coils.size());
+    Volumes<Real> sourcesOf;
+    for (const auto &coil : coils) {
+        sourcesOf.push_back(coil.volumes());
+    }
+
+    // Blocks are calibrated independently, each keeps its own normal equations
+    std::vector<Kernel> kernels(blocks);
+    parallel_utils::parallelFor(0, blocks, [&](int block) {
+        kernels[block] = calibrate<Real>(sourcesOf, sampling, block, cancelled);
+    });
+    if (isCancelled()) {
+        return false;
+    }
+    for (const auto &kernel : kernels) {
+        if (kernel.weights.empty()) {
+            LOG_ERROR("GRAPPA calibration failed, the ACS views are singular");
+            return false;
+        }
+    }
+    const auto calibration = timer.restart();
+
+    // Writes go to skipped views only, sources are acquired views, so tasks never overlap.
+    // The read views are dropped first, they share the buffers and would make detach copy them
+    sourcesOf.clear();
+    std::vector<typename mrd_utils::BasicMrd<Real>::MutableVolumes> targets;
+    for (auto &coil : coils) {
+        targets.push_back(coil.detachVolumes());
+    }
+    for (const auto &target : targets) {
+        sourcesOf.push_back(mrd_utils::BasicMrd<Real>::Volumes::wrap(target.data(), target.shape()));
+    }
+    const int views2 = first.views2;
+    const int samples = first.samples;
+    const int n = sources(coilCount);
+    const int gaps = sampling.acceleration - 1;
+    const int tasks = blocks * views2 * coilCount;
+    parallel_utils::parallelFor(0, tasks, [&](int task) {
+        if (isCancelled()) {
+            return;
+        }
+        const int coil = task % coilCount;
+        const int z = (task / coilCount) % views2;
+        const int block = task / (coilCount * views2);
+        const auto &weights = kernels[block].weights;
+        std::vector<Complex> source(n);
+        for (int view = sampling.first; view < sampling.last; view++) {
+            if (sampling.isAcquired(view)) {
+                continue;
+            }
+            // Acquired pattern view below the gap, floor division around the centre
+            const int offset = view - sampling.centre();
+            const int below = offset - ((offset % sampling.acceleration) + sampling.acceleration) %
+                                           sampling.acceleration;
+            const int gap = offset - below - 1;
+            const int base = sampling.centre() + below;
+            for (int x = 0; x < samples; x++) {
+                Complex value = 0;
+                if (gather<Real>(sourcesOf, sampling, block, base, z, x, source.data())) {
+                    for (int i = 0; i < n; i++) {
+                        value += source[i] * weights[(static_cast<size_t>(i) * gaps + gap) * coilCount + coil];
+                    }
+                }
+                auto &out = targets[coil](block, view, z, x);
+                out[0] = static_cast<Real>(value.real());
+                out[1] = static_cast<Real>(value.imag());
+            }
+        }
+    });
+
+    if (isCancelled()) {
+        return false;
+    }
+
+    LOG_DEBUG(QString("GRAPPA R=%1 with %2 ACS views, %3 coils, %4 blocks: calibration %5 ms, "
+                      "application %6 ms")
+                  .arg(sampling.acceleration)
+                  .arg(sampling.acsLines)
+                  .arg(coilCount)
+                  .arg(blocks)
+                  .arg(calibration)
+                  .arg(timer.elapsed()));
+    return true;
+}
+
+template bool reconstruct(QVector<mrd_utils::BasicMrd<double>> &, const Sampling &,
+                          const std::atomic<bool> *);
+template bool reconstruct(QVector<mrd_utils::BasicMrd<float>> &, const Sampling &,
+                          const std::atomic<bool> *);
+
+} // namespace grappa
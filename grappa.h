@@ -0,0 +1,66 @@
+#ifndef GRAPPA_H
+#define GRAPPA_H
+
+#include <QVector>
+
+#include <atomic>
+
+#include "mrdutils.h"
+#include "reconoptions.h"
+
+/**
+ * @brief GRAPPA reconstruction of k-space undersampled along the views
+ * @details Every acceleration-th view is acquired, plus a fully sampled band of
+ * autocalibration (ACS) views around the centre. Each skipped view is a linear combination
+ * of the neighbouring acquired views of all coils, the weights are fitted by regularized
+ * least squares on the ACS band, one set per (experiment, echo, slice) block.
+ */
+namespace grappa {
+
+/// Acquired views on each side of a gap used as sources
+constexpr int kKernelViews = 2;
+/// Samples along the readout used as sources, centred on the target
+constexpr int kKernelSamples = 5;
+/// Tikhonov weight relative to the mean diagonal of the normal equations
+constexpr double kRegularization = 1e-4;
+
+/**
+ * @brief Views of an undersampled acquisition
+ */
+struct Sampling {
+    int views = 0;
+    int acceleration = 1;
+    int acsLines = 0;
+    /// Acquired range, views outside it are never estimated, e.g. skipped by partial Fourier
+    int first = 0;
+    int last = 0;
+
+    Sampling() = default;
+    Sampling(int views, int acceleration, int acsLines);
+
+    int centre() const { return views / 2; }
+    bool isUndersampled() const { return acceleration > 1 && last > first; }
+    /// The ACS band, [acsBegin(), acsEnd())
+    int acsBegin() const;
+    int acsEnd() const;
+    /// Views acquired in the pattern, every acceleration-th one through the centre
+    bool isPattern(int view) const;
+    bool isAcquired(int view) const;
+};
+
+/**
+ * @brief Fill the skipped views of every coil in place, copy on write
+ * @details Calibration runs in parallel over the blocks, the application over
+ * (block, partition, coil) tasks. Every coil must have the same shape and untransformed data.
+ * @param cancelled Checked between blocks and tasks, once set the fit stops and false is
+ * returned, the coils may then be partially filled and should be dropped
+ * @return false if the coils do not match, the ACS band is too narrow for the kernel or
+ * the normal equations are singular, the coils are left untouched then
+ */
+template <typename Real>
+bool reconstruct(QVector<mrd_utils::BasicMrd<Real>> &coils, const Sampling &sampling,
+                 const std::atomic<bool> *cancelled = nullptr);
+
+} // namespace grappa
+
+#endif // GRAPPA_H
@@ -2,6 +2,8 @@
 #include "ui_historytab.h"
 #include "appearanceconfig.h"
 
+#include <algorithm>
+
 #include "store.h"
 #include "utils.h"
 
@@ -43,7 +45,7 @@ void HistoryTab::addExamToView(const Exam &exam)
     }
     m_model->addExam(exam.id(), exam.patient()->id(), exam.startTime());
     // Add to cache as well, so if it's immediately selected, it's available
-    m_cache[std::pair(exam.patient()->id(), exam.id())] = exam;
+    addToCache(std::pair(exam.patient()->id(), exam.id()), exam);
 }
 
 void HistoryTab::loadHistoryList() { m_model->loadHistoryList(); }
@@ -53,9 +55,25 @@ void HistoryTab::onCurrentRowChanged()
     auto row = ui->tableView->currentIndex().row();
     auto eid = this->m_model->data(this->m_model->index(row, 0)).toString();
     auto pid = m_model->data(m_model->index(row, 1)).toString();
-    auto key = std::pair(pid, eid);
-    if (!m_cache.contains(key)) {
-        m_cache[key] = store::loadExam(pid, eid);
+    emit currentItemChanged(cachedExam(std::pair(pid, eid)));
+}
+
+const Exam &HistoryTab::cachedExam(const ExamKey &key) {
+    auto it = std::find_if(m_cache.begin(), m_cache.end(),
+                           [&](const auto &entry) { return entry.first == key; });
+    if (it == m_cache.end()) {
+        addToCache(key, store::loadExam(key.first, key.second));
+    } else {
+        m_cache.splice(m_cache.begin(), m_cache, it);
+    }
+    return m_cache.front().second;
+}
+
+void HistoryTab::addToCache(const ExamKey &key, const Exam &exam) {
+    m_cache.remove_if([&](const auto &entry) { return entry.first == key; });
+    m_cache.emplace_front(key, exam);
+    // Dropping an exam releases its response and with it the mapped result files
+    while (m_cache.size() > kCachedExams) {
+        m_cache.pop_back();
     }
-    emit currentItemChanged(m_cache[key]);
 }
@@ -2,6 +2,7 @@
 #define HISTORYTAB_H
 
 #include <QWidget>
+#include <list>
 
 #include "exam.h"
 #include "historymodel.h"
@@ -29,10 +30,19 @@ private slots:
 private:
     Ui::HistoryTab *ui;
 
+    using ExamKey = std::pair<QString, QString>;
+
+    /// Loaded exams kept for quick reselection, each one keeps its result files mapped
+    static constexpr size_t kCachedExams = 4;
+
     HistoryModel *m_model;
-    std::map<std::pair<QString, QString>, Exam> m_cache;
+    /// (patient id, exam id) and exam, most recently shown first
+    std::list<std::pair<ExamKey, Exam>> m_cache;
     
     void setupConnections(); // 设置信号连接
+    /// Move the exam of key to the front of the cache, loading it if needed, drops the oldest
+    const Exam &cachedExam(const ExamKey &key);
+    void addToCache(const ExamKey &key, const Exam &exam);
 };
 
 #endif // HISTORYTAB_H
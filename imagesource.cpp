@@ -0,0 +1,270 @@
+#include "imagesource.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+
+#include "utils.h"
+
+StaticImageSource::StaticImageSource(QVector<QVector<QImage>> images)
+    : m_images(std::move(images)) {}
+
+int StaticImageSource::channels() const { return static_cast<int>(m_images.size()); }
+
+int StaticImageSource::count() const {
+    return m_images.isEmpty() ? 0 : static_cast<int>(m_images.front().size());
+}
+
+QImage StaticImageSource::image(int channel, int index) {
+    if (channel < 0 || channel >= m_images.size()) {
+        return QImage();
+    }
+    return m_images[channel].value(index);
+}
+
+CachedImageSource::CachedImageSource(int channels, int blocks, int imagesPerBlock, Loader loader,
+                                     qint64 capacity, int prefetchRadius)
+    : CachedImageSource(channels, blocks, imagesPerBlock, std::move(loader), BlockLoader(),
+                        capacity, prefetchRadius) {}
+
+CachedImageSource::CachedImageSource(int channels, int blocks, int imagesPerBlock,
+                                     BlockLoader loader, qint64 capacity, int prefetchRadius)
+    : CachedImageSource(channels, blocks, imagesPerBlock, Loader(), std::move(loader), capacity,
+                        prefetchRadius) {}
+
+CachedImageSource::CachedImageSource(int channels, int blocks, int imagesPerBlock, Loader loader,
+                                     BlockLoader blockLoader, qint64 capacity, int prefetchRadius)
+    : m_channels(channels), m_blocks(blocks), m_imagesPerBlock(std::max(imagesPerBlock, 1)),
+      m_loader(std::move(loader)), m_blockLoader(std::move(blockLoader)), m_capacity(capacity),
+      m_prefetchRadius(prefetchRadius) {
+    if (m_prefetchRadius > 0) {
+        m_worker = std::thread(&CachedImageSource::run, this);
+    }
+}
+
+CachedImageSource::~CachedImageSource() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_queue.clear();
+        m_wanted.clear();
+        // The worker may be in the middle of a long fit, let it return instead of finishing
+        m_cancelPrefetch = true;
+    }
+    m_wake.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+int CachedImageSource::channels() const { return m_channels; }
+
+int CachedImageSource::count() const { return m_blocks * m_imagesPerBlock; }
+
+QImage CachedImageSource::image(int channel, int index) {
+    if (channel < 0 || channel >= m_channels || index < 0 || index >= count()) {
+        return QImage();
+    }
+
+    static const std::atomic<bool> s_notCancelled(false);
+    Key key(channel, index / m_imagesPerBlock);
+    cancelStalePrefetch(key);
+    auto images = block(key, s_notCancelled);
+    queueNeighbours(key);
+    return images.value(index % m_imagesPerBlock);
+}
+
+void CachedImageSource::prefetch(int channel, int index) {
+    if (m_prefetchRadius <= 0 || channel < 0 || channel >= m_channels || index < 0 ||
+        index >= count()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.emplace_back(channel, index / m_imagesPerBlock);
+    }
+    m_wake.notify_one();
+}
+
+QImage CachedImageSource::cachedImage(int channel, int index) {
+    if (m_prefetchRadius <= 0) {
+        return image(channel, index);
+    }
+    if (channel < 0 || channel >= m_channels || index < 0 || index >= count()) {
+        return QImage();
+    }
+
+    Key key(channel, index / m_imagesPerBlock);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_cache.find(key);
+        if (it != m_cache.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+            auto image = it->second.images.value(index % m_imagesPerBlock);
+            lock.unlock();
+            queueNeighbours(key);
+            return image;
+        }
+        m_wanted.push_back(key);
+    }
+    m_wake.notify_one();
+    return QImage();
+}
+
+void CachedImageSource::setReadyHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready = std::move(handler);
+}
+
+qint64 CachedImageSource::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+CachedImageSource::Key CachedImageSource::loadUnit(const Key &key) const {
+    return m_blockLoader ? Key(kAllChannels, key.second) : key;
+}
+
+QVector<QImage> CachedImageSource::block(const Key &key, const std::atomic<bool> &cancelled) {
+    const auto unit = loadUnit(key);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        auto it = m_cache.find(key);
+        if (it != m_cache.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+            return it->second.images;
+        }
+        if (!m_loading.count(unit)) {
+            break;
+        }
+        // Another thread is loading it, if that fails this one tries again
+        m_loaded.wait(lock);
+    }
+    m_loading.insert(unit);
+    lock.unlock();
+
+    // (key, images) of every channel the loader produced
+    std::vector<std::pair<Key, QVector<QImage>>> loaded;
+    try {
+        if (m_blockLoader) {
+            auto channels = m_blockLoader(key.second, cancelled);
+            for (int c = 0; c < std::min(m_channels, static_cast<int>(channels.size())); c++) {
+                loaded.emplace_back(Key(c, key.second), std::move(channels[c]));
+            }
+        } else {
+            loaded.emplace_back(key, m_loader(key.first, key.second, cancelled));
+        }
+    } catch (const std::exception &e) {
+        LOG_ERROR(QString("Loading block %1 of channel %2 failed: %3")
+                      .arg(key.second)
+                      .arg(key.first)
+                      .arg(e.what()));
+        loaded.clear();
+    }
+    if (cancelled) {
+        loaded.clear();
+    }
+
+    lock.lock();
+    m_loading.erase(unit);
+    QVector<QImage> images;
+    for (auto &[loadedKey, loadedImages] : loaded) {
+        if (loadedKey == key) {
+            images = loadedImages;
+        } else if (!loadedImages.isEmpty() && !m_cache.count(loadedKey)) {
+            insert(loadedKey, std::move(loadedImages));
+        }
+    }
+    // Inserted last so it is the most recently used
+    if (!images.isEmpty()) {
+        insert(key, images);
+    }
+    m_loaded.notify_all();
+    return images;
+}
+
+void CachedImageSource::insert(const Key &key, QVector<QImage> images) {
+    Entry entry;
+    for (const auto &image : images) {
+        entry.bytes += image.sizeInBytes();
+    }
+    entry.images = std::move(images);
+    m_lru.push_front(key);
+    entry.position = m_lru.begin();
+    m_bytes += entry.bytes;
+    m_cache[key] = std::move(entry);
+
+    while (m_bytes > m_capacity && m_lru.size() > 1) {
+        auto it = m_cache.find(m_lru.back());
+        m_bytes -= it->second.bytes;
+        m_cache.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+void CachedImageSource::cancelStalePrefetch(const Key &key) {
+    if (m_prefetchRadius <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_prefetching) {
+        return;
+    }
+    const auto loading = loadUnit(*m_prefetching);
+    const auto wanted = loadUnit(key);
+    const bool neighbour = loading.first == wanted.first &&
+                           std::abs(loading.second - wanted.second) <= m_prefetchRadius;
+    if (!neighbour) {
+        m_cancelPrefetch = true;
+    }
+}
+
+void CachedImageSource::queueNeighbours(const Key &key) {
+    if (m_prefetchRadius <= 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Hints of an earlier position are stale once the user moved on
+        m_queue.clear();
+        for (int distance = 1; distance <= m_prefetchRadius; distance++) {
+            if (key.second + distance < m_blocks) {
+                m_queue.emplace_back(key.first, key.second + distance);
+            }
+            if (key.second - distance >= 0) {
+                m_queue.emplace_back(key.first, key.second - distance);
+            }
+        }
+    }
+    m_wake.notify_one();
+}
+
+void CachedImageSource::run() {
+    for (;;) {
+        Key key;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_wanted.empty() || !m_queue.empty(); });
+            if (m_stop) {
+                return;
+            }
+            auto &queue = m_wanted.empty() ? m_queue : m_wanted;
+            key = queue.front();
+            queue.pop_front();
+            if (m_cache.count(key) || m_loading.count(loadUnit(key))) {
+                continue;
+            }
+            m_prefetching = key;
+            m_cancelPrefetch = false;
+        }
+        auto images = block(key, m_cancelPrefetch);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_prefetching.reset();
+        if (!images.isEmpty() && m_ready) {
+            m_ready();
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#ifndef IMAGESOURCE_H
+#define IMAGESOURCE_H
+
+#include <QImage>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <utility>
+
+/**
+ * @class IImageSource
+ * @brief Images of an exam, channel by channel, obtained one at a time
+ * @details Indexes follow IExamResponse::images(): image index of channel c is
+ * images(c)[index]. Implementations are thread-safe.
+ */
+class IImageSource {
+public:
+    virtual ~IImageSource() = default;
+
+    virtual int channels() const = 0;
+    /// Number of images of every channel
+    virtual int count() const = 0;
+    /// Blocks until the image is available, a null QImage if it is out of range or failed
+    virtual QImage image(int channel, int index) = 0;
+    /// Hint that image(channel, index) will be requested soon
+    virtual void prefetch(int channel, int index) {
+        Q_UNUSED(channel);
+        Q_UNUSED(index);
+    }
+    /**
+     * @brief The image if it is available without waiting, for callers on the GUI thread
+     * @details Otherwise a null QImage is returned, the image is loaded in the background
+     * and the ready handler is called once it is. Sources that cannot load in the
+     * background return image().
+     */
+    virtual QImage cachedImage(int channel, int index) { return image(channel, index); }
+    /**
+     * @brief Called from a background thread whenever images were loaded for cachedImage()
+     * @details Once this returns the previous handler is no longer called
+     */
+    virtual void setReadyHandler(std::function<void()> handler) { Q_UNUSED(handler); }
+
+    /// Display name of a channel, its index unless setChannelNames() named it
+    QString channelName(int channel) const {
+        return m_channelNames.value(channel, QString::number(channel));
+    }
+    /// Channel shown first, e.g. the coil combination of a multi-coil exam
+    int defaultChannel() const { return m_defaultChannel; }
+
+    /// Set before the source is shared, names are not guarded
+    void setChannelNames(const QStringList &names, int defaultChannel = 0) {
+        m_channelNames = names;
+        m_defaultChannel = defaultChannel;
+    }
+
+protected:
+    IImageSource() = default;
+
+private:
+    QStringList m_channelNames;
+    int m_defaultChannel = 0;
+};
+
+/**
+ * @class StaticImageSource
+ * @brief Images reconstructed up front, for responses without lazy reconstruction
+ */
+class StaticImageSource : public IImageSource {
+public:
+    explicit StaticImageSource(QVector<QVector<QImage>> images);
+
+    int channels() const override;
+    int count() const override;
+    QImage image(int channel, int index) override;
+
+private:
+    QVector<QVector<QImage>> m_images;
+};
+
+/**
+ * @class CachedImageSource
+ * @brief Reconstructs blocks of images on first request and keeps them in a bounded LRU
+ * @details A block is the unit the loader produces, e.g. all partitions of one 3D volume
+ * or a single 2D slice. Every image() request replaces the pending hints with the
+ * neighbouring blocks of the same channel, a background thread loads them so stepping
+ * through slices rarely waits. A background load the user moved away from is cancelled.
+ */
+class CachedImageSource : public IImageSource {
+public:
+    /**
+     * @brief Images of one block of one channel, imagesPerBlock of them, empty on failure
+     * @param cancelled Set once the images are no longer wanted, the loader should then
+     * return as soon as it can, its result is dropped
+     */
+    using Loader = std::function<QVector<QImage>(int channel, int block,
+                                                 const std::atomic<bool> &cancelled)>;
+    /**
+     * @brief Images of one block of every channel, for channels only reconstructed together
+     * @details e.g. GRAPPA fits the skipped views of all coils of a block at once
+     */
+    using BlockLoader = std::function<QVector<QVector<QImage>>(int block,
+                                                               const std::atomic<bool> &cancelled)>;
+
+    static constexpr qint64 kDefaultCapacity = qint64(256) << 20;
+    static constexpr int kDefaultPrefetchRadius = 2;
+
+    /**
+     * @param capacity Bytes of images kept, the most recently used block is always kept
+     * @param prefetchRadius Blocks on each side of a requested one loaded in the background,
+     * 0 disables the background thread
+     */
+    CachedImageSource(int channels, int blocks, int imagesPerBlock, Loader loader,
+                      qint64 capacity = kDefaultCapacity,
+                      int prefetchRadius = kDefaultPrefetchRadius);
+    /// Every channel of a block is loaded by one call of loader and cached at once
+    CachedImageSource(int channels, int blocks, int imagesPerBlock, BlockLoader loader,
+                      qint64 capacity = kDefaultCapacity,
+                      int prefetchRadius = kDefaultPrefetchRadius);
+    ~CachedImageSource() override;
+
+    CachedImageSource(const CachedImageSource &) = delete;
+    CachedImageSource &operator=(const CachedImageSource &) = delete;
+
+    int channels() const override;
+    int count() const override;
+    QImage image(int channel, int index) override;
+    void prefetch(int channel, int index) override;
+    /// Loads a missing block on the background thread before any hint, a hit hints its neighbours
+    QImage cachedImage(int channel, int index) override;
+    void setReadyHandler(std::function<void()> handler) override;
+
+    /// Bytes of the images currently cached
+    qint64 cachedBytes() const;
+
+private:
+    /// (channel, block)
+    using Key = std::pair<int, int>;
+
+    struct Entry {
+        QVector<QImage> images;
+        qint64 bytes = 0;
+        std::list<Key>::iterator position;
+    };
+
+    /// Channel of the load units of a BlockLoader, which cover every channel
+    static constexpr int kAllChannels = -1;
+
+    CachedImageSource(int channels, int blocks, int imagesPerBlock, Loader loader,
+                      BlockLoader blockLoader, qint64 capacity, int prefetchRadius);
+
+    /// What one loader call produces, the key itself or its whole block
+    Key loadUnit(const Key &key) const;
+    /// Cached images of the block, loading them on this thread if needed
+    QVector<QImage> block(const Key &key, const std::atomic<bool> &cancelled);
+    /// Caller holds m_mutex
+    void insert(const Key &key, QVector<QImage> images);
+    /// Cancel the background load unless it is key or one of its neighbours
+    void cancelStalePrefetch(const Key &key);
+    void queueNeighbours(const Key &key);
+    void run();
+
+    const int m_channels;
+    const int m_blocks;
+    const int m_imagesPerBlock;
+    const Loader m_loader;
+    const BlockLoader m_blockLoader;
+    const qint64 m_capacity;
+    const int m_prefetchRadius;
+
+    mutable std::mutex m_mutex;
+    /// Most recently used first
+    std::list<Key> m_lru;
+    std::map<Key, Entry> m_cache;
+    qint64 m_bytes = 0;
+    /// Blocks being loaded, a second request waits on m_loaded instead of loading again
+    std::set<Key> m_loading;
+    std::condition_variable m_loaded;
+
+    /// Hints, replaced by every image() request
+    std::deque<Key> m_queue;
+    /// Blocks cachedImage() missed, loaded before the hints
+    std::deque<Key> m_wanted;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    /// Key the background thread is loading and the flag its loader watches
+    std::optional<Key> m_prefetching;
+    std::atomic<bool> m_cancelPrefetch{false};
+    /// Called with m_mutex held, so it is not called anymore once replaced
+    std::function<void()> m_ready;
+    std::thread m_worker;
+};
+
+#endif // IMAGESOURCE_H
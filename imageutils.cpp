@@ -0,0 +1,140 @@
+#include "imageutils.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "parallelutils.h"
+
+namespace {
+
+const QString KEY_WINDOW_LEVEL = "WindowLevel";
+const QString KEY_WINDOW_WIDTH = "WindowWidth";
+
+/// Smallest bin whose cumulative count exceeds fraction of the total
+int percentileBin(const image_utils::Histogram &histogram, quint64 total, double fraction) {
+    auto target = static_cast<quint64>(fraction * static_cast<double>(total));
+    quint64 count = 0;
+    for (int bin = 0; bin < image_utils::kHistogramBins; bin++) {
+        count += histogram[bin];
+        if (count > target) {
+            return bin;
+        }
+    }
+    return image_utils::kHistogramBins - 1;
+}
+
+} // namespace
+
+namespace image_utils {
+
+Histogram emptyHistogram() { return Histogram(kHistogramBins, 0); }
+
+void accumulate(Histogram &histogram, const quint16 *values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        histogram[values[i] >> kHistogramShift]++;
+    }
+}
+
+void merge(Histogram &histogram, const Histogram &other) {
+    for (int bin = 0; bin < kHistogramBins; bin++) {
+        histogram[bin] += other[bin];
+    }
+}
+
+Window Window::fromRange(int lower, int upper) {
+    Window window;
+    window.width = std::max(upper - lower, 1);
+    window.level = lower + window.width / 2;
+    return window;
+}
+
+Window autoWindow(const Histogram &histogram, double low, double high) {
+    quint64 total = 0;
+    for (auto count : histogram) {
+        total += count;
+    }
+    if (total == 0) {
+        return Window();
+    }
+
+    auto lower = percentileBin(histogram, total, low) << kHistogramShift;
+    auto upper = (percentileBin(histogram, total, high) + 1) << kHistogramShift;
+    return Window::fromRange(lower, upper);
+}
+
+void setWindow(QImage &image, const Window &window) {
+    image.setText(KEY_WINDOW_LEVEL, QString::number(window.level));
+    image.setText(KEY_WINDOW_WIDTH, QString::number(window.width));
+}
+
+Window window(const QImage &image) {
+    bool levelOk = false;
+    bool widthOk = false;
+    Window result;
+    result.level = image.text(KEY_WINDOW_LEVEL).toInt(&levelOk);
+    result.width = image.text(KEY_WINDOW_WIDTH).toInt(&widthOk);
+    if (!levelOk || !widthOk || result.width <= 0) {
+        return Window();
+    }
+    return result;
+}
+
+WindowLut::WindowLut(const Window &window) : m_window(window), m_table(65536) {
+    const int lower = window.lower();
+    const int width = std::max(window.width, 1);
+    for (int value = 0; value < 65536; value++) {
+        auto grey = static_cast<qint64>(value - lower) * 255 / width;
+        m_table[value] = static_cast<uchar>(std::clamp<qint64>(grey, 0, 255));
+    }
+}
+
+QImage WindowLut::apply(const QImage &image) const {
+    if (image.format() != QImage::Format_Grayscale16) {
+        return image;
+    }
+
+    QImage frame(image.width(), image.height(), QImage::Format_Grayscale8);
+    for (int y = 0; y < image.height(); y++) {
+        auto src = reinterpret_cast<const quint16 *>(image.constScanLine(y));
+        auto dst = frame.scanLine(y);
+        for (int x = 0; x < image.width(); x++) {
+            dst[x] = m_table[src[x]];
+        }
+    }
+    return frame;
+}
+
+QList<QImage> toDisplay(const QList<QImage> &images, const Window *override, int workers) {
+    // Images of one reconstruction share their window, build each table once
+    std::map<std::pair<int, int>, std::shared_ptr<const WindowLut>> tables;
+    std::vector<const WindowLut *> lut(images.size(), nullptr);
+    for (qsizetype i = 0; i < images.size(); i++) {
+        if (images[i].format() != QImage::Format_Grayscale16) {
+            continue;
+        }
+        auto w = override ? *override : window(images[i]);
+        auto &table = tables[{w.level, w.width}];
+        if (!table) {
+            table = std::make_shared<const WindowLut>(w);
+        }
+        lut[i] = table.get();
+    }
+
+    QList<QImage> frames(images.size());
+    auto out = frames.data();
+    parallel_utils::parallelFor(0, static_cast<int>(images.size()), [&](int i) {
+        out[i] = lut[i] ? lut[i]->apply(images[i]) : images[i];
+    }, workers);
+    return frames;
+}
+
+QImage toDisplay(const QImage &image) {
+    if (image.format() != QImage::Format_Grayscale16) {
+        return image;
+    }
+    return WindowLut(window(image)).apply(image);
+}
+
+} // namespace image_utils
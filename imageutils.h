@@ -0,0 +1,97 @@
+#ifndef IMAGEUTILS_H
+#define IMAGEUTILS_H
+
+#include <QImage>
+#include <QList>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Window/level of the 16-bit magnitude images and their conversion to 8-bit frames
+ * @details Reconstruction keeps QImage::Format_Grayscale16 magnitudes scaled to the peak of
+ * the volume and stores a percentile based default window in the image text. Display frames
+ * are derived from them through a 65536 entry lookup table, so changing the contrast never
+ * re-runs the FFT.
+ */
+namespace image_utils {
+
+/// Low bits of a 16-bit value dropped by the histogram
+constexpr int kHistogramShift = 4;
+constexpr int kHistogramBins = 65536 >> kHistogramShift;
+
+/// Counts of 16-bit values, kHistogramBins bins of 1 << kHistogramShift values each
+using Histogram = std::vector<quint64>;
+
+Histogram emptyHistogram();
+/// Add n values, histogram must have kHistogramBins bins
+void accumulate(Histogram &histogram, const quint16 *values, size_t n);
+void merge(Histogram &histogram, const Histogram &other);
+
+/// Default percentiles of the auto window, the bottom 1% and top 0.5% are saturated
+constexpr double kAutoWindowLow = 0.01;
+constexpr double kAutoWindowHigh = 0.995;
+
+/**
+ * @struct Window
+ * @brief Display window in 16-bit units, values below lower() are black, above upper() white
+ */
+struct Window {
+    int level = 32768;
+    int width = 65536;
+
+    int lower() const { return level - width / 2; }
+    int upper() const { return lower() + width; }
+
+    bool operator==(const Window &other) const {
+        return level == other.level && width == other.width;
+    }
+    bool operator!=(const Window &other) const { return !(*this == other); }
+
+    /// Window spanning [lower, upper), width is at least 1
+    static Window fromRange(int lower, int upper);
+};
+
+/**
+ * @brief Window between two percentiles of the histogram
+ * @return The full range for an empty histogram
+ */
+Window autoWindow(const Histogram &histogram, double low = kAutoWindowLow,
+                  double high = kAutoWindowHigh);
+
+/// Store the default window in the image text, copies of the image keep it
+void setWindow(QImage &image, const Window &window);
+/// Window stored by setWindow, the full range if there is none
+Window window(const QImage &image);
+
+/**
+ * @class WindowLut
+ * @brief 16-bit value to 8-bit grey level of one window
+ */
+class WindowLut {
+public:
+    explicit WindowLut(const Window &window);
+
+    const Window &window() const { return m_window; }
+    uchar operator[](quint16 value) const { return m_table[value]; }
+
+    /// Grayscale16 to Grayscale8, other formats are returned unchanged
+    QImage apply(const QImage &image) const;
+
+private:
+    Window m_window;
+    std::vector<uchar> m_table;
+};
+
+/**
+ * @brief 8-bit display frames of the images
+ * @param override Window used for every image, nullptr uses the window stored in each image
+ * @param workers Threads, <= 0 means parallel_utils::maxThreads()
+ * @details One table is built per distinct window, images are converted in parallel
+ */
+QList<QImage> toDisplay(const QList<QImage> &images, const Window *override = nullptr,
+                        int workers = 0);
+QImage toDisplay(const QImage &image);
+
+} // namespace image_utils
+
+#endif // IMAGEUTILS_H
@@ -1,6 +1,12 @@
 #include "mainwindow.h"
 #include "appearanceconfig.h"
+#include "configmanager.h"
 #include "debugconfig.h"
+#include "fftbackend.h"
+#include "fftwplancache.h"
+#include "parallelutils.h"
+#include "reconoptions.h"
+#include "simdutils.h"
 #include "utils.h"
 
 #include <QApplication>
@@ -16,6 +22,30 @@ int main(int argc, char *argv[])
     Logger::setLogToFile(config::Debug::logToFile(), config::Debug::logFilePath());
     Logger::setMinLogLevel(static_cast<LogLevel>(config::Debug::logLevel()));
     LOG_INFO("Application started");
+    LOG_INFO(QString("K-space conversion kernels: %1")
+                 .arg(simd_utils::isaName(simd_utils::activeIsa())));
+
+    // Initialize reconstruction worker threads
+    parallel_utils::setMaxThreads(config::Debug::workerThreads());
+
+    // Initialize reconstruction precision
+    recon::Options reconOptions;
+    reconOptions.precision = static_cast<recon::Precision>(config::Debug::precision());
+    reconOptions.shiftFree = config::Debug::shiftFree();
+    reconOptions.coilCombine = static_cast<recon::CoilCombine>(config::Debug::coilCombine());
+    reconOptions.partialFourier = static_cast<recon::PartialFourier>(config::Debug::partialFourier());
+    recon::Options::setDefaults(reconOptions);
+
+    // Initialize FFT engine, FFTW unless the built-in one is selected or FFTW is not built in
+    fftw_utils::setFftBackend(static_cast<fftw_utils::FftBackendKind>(config::Debug::fftBackend()));
+    LOG_INFO(QString("FFT backend: %1").arg(fftw_utils::fftBackend().name()));
+
+    // Initialize fftw planner, wisdom of earlier runs makes MEASURE/PATIENT plans cheap
+    fftw_utils::setPlanEffort(static_cast<fftw_utils::PlanEffort>(config::Debug::fftEffort()));
+    fftw_utils::initThreads();
+    fftw_utils::setFftThreads(config::Debug::fftThreads());
+    LOG_INFO(QString("FFT threads: %1").arg(fftw_utils::fftThreads()));
+    fftw_utils::importWisdom(ConfigManager::kConfigDir);
 
     // Initialize translation system
     QTranslator translator;
@@ -60,6 +90,7 @@ int main(int argc, char *argv[])
     LOG_INFO("Main window displayed");
 
     int result = a.exec();
+    fftw_utils::exportWisdom(ConfigManager::kConfigDir);
     LOG_INFO(QString("Application exited with code: %1").arg(result));
     return result;
 }
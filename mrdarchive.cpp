@@ -0,0 +1,249 @@
+#include "mrdarchive.h"
+
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+
+#include "parallelutils.h"
+#include "utils.h"
+
+namespace {
+
+constexpr qint64 kPreambleSize = 4 + 4 + 4 + 4 + 8;
+constexpr qint64 kTableEntrySize = 8 + 8;
+
+template <typename T>
+void appendLE(QByteArray &bytes, T value) {
+    char buffer[sizeof(T)];
+    qToLittleEndian(value, buffer);
+    bytes.append(buffer, sizeof(T));
+}
+
+template <typename T>
+T readLE(const char *data) {
+    return qFromLittleEndian<T>(data);
+}
+
+} // namespace
+
+namespace mrd_utils {
+
+MrdArchive::~MrdArchive() {}
+
+QByteArray MrdArchive::compress(const MrdView &view, int level, int workers) {
+    const auto &header = view.header();
+    const int chunksPerChannel = header.experiments * header.echoes * header.slices;
+    const qint64 chunkBytes = header.channelBytes() / chunksPerChannel;
+    const int chunkCount = view.channels() * chunksPerChannel;
+
+    // Chunks are independent, each worker compresses whole slices
+    const char *kspace = view.data() + kHeaderSize;
+    std::vector<QByteArray> chunks(chunkCount);
+    parallel_utils::parallelFor(
+        0, chunkCount,
+        [&](int i) {
+            chunks[i] = qCompress(reinterpret_cast<const uchar *>(kspace + i * chunkBytes),
+                                  chunkBytes, level);
+        },
+        workers);
+
+    const qint64 kspaceEnd = kHeaderSize + view.channels() * header.channelBytes();
+    const qint64 tailSize = view.size() - kspaceEnd;
+
+    QByteArray archive;
+    archive.append(kMagic, 4);
+    appendLE<quint32>(archive, kVersion);
+    appendLE<quint32>(archive, view.channels());
+    appendLE<quint32>(archive, chunksPerChannel);
+    appendLE<quint64>(archive, tailSize);
+    archive.append(view.data(), kHeaderSize);
+    archive.append(view.data() + kspaceEnd, tailSize);
+
+    quint64 offset = archive.size() + chunkCount * kTableEntrySize;
+    for (const auto &chunk : chunks) {
+        appendLE<quint64>(archive, offset);
+        appendLE<quint64>(archive, chunk.size());
+        offset += chunk.size();
+    }
+    for (const auto &chunk : chunks) {
+        archive.append(chunk);
+    }
+
+    return archive;
+}
+
+std::shared_ptr<MrdArchive> MrdArchive::open(const QString &path) {
+    std::shared_ptr<MrdArchive> archive(new MrdArchive);
+
+    auto &file = archive->m_file;
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR(QString("Failed to open file:%1 Error: %2").arg(path, file.errorString()));
+        return nullptr;
+    }
+
+    archive->m_size = file.size();
+    if (archive->m_size > 0) {
+        // The mapping stays valid as long as m_file is alive
+        archive->m_data = reinterpret_cast<const char *>(file.map(0, archive->m_size));
+        if (!archive->m_data) {
+            LOG_ERROR(QString("Failed to map file:%1 Error: %2").arg(path, file.errorString()));
+            return nullptr;
+        }
+    }
+
+    if (!archive->parse()) {
+        LOG_ERROR(QString("Invalid MRD archive: %1").arg(path));
+        return nullptr;
+    }
+    return archive;
+}
+
+bool MrdArchive::isArchive(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return file.read(4) == QByteArray(kMagic, 4);
+}
+
+bool MrdArchive::parse() {
+    if (m_size < kPreambleSize + kHeaderSize || std::memcmp(m_data, kMagic, 4) != 0) {
+        LOG_ERROR("MRD archive magic number mismatch");
+        return false;
+    }
+
+    auto version = readLE<quint32>(m_data + 4);
+    if (version != kVersion) {
+        LOG_ERROR(QString("Unsupported MRD archive version: %1").arg(version));
+        return false;
+    }
+    m_channels = static_cast<int>(readLE<quint32>(m_data + 8));
+    m_chunksPerChannel = static_cast<int>(readLE<quint32>(m_data + 12));
+    m_tailSize = static_cast<qint64>(readLE<quint64>(m_data + 16));
+
+    m_rawHeader = m_data + kPreambleSize;
+    m_header = MrdHeader::parse(m_rawHeader);
+    if (m_header.sampleSize() == 0) {
+        LOG_ERROR(QString("Unknown datatype: %1").arg(m_header.datatype));
+        return false;
+    }
+    if (m_header.channelBytes() == 0) {
+        LOG_ERROR("MRD file data error: kdataSize is zero");
+        return false;
+    }
+    if (m_chunksPerChannel != m_header.experiments * m_header.echoes * m_header.slices) {
+        LOG_ERROR("MRD archive chunk count does not match the header");
+        return false;
+    }
+
+    qint64 tableStart = kPreambleSize + kHeaderSize + m_tailSize;
+    qint64 chunkCount = static_cast<qint64>(m_channels) * m_chunksPerChannel;
+    if (m_tailSize < 0 || tableStart + chunkCount * kTableEntrySize > m_size) {
+        LOG_ERROR("MRD archive is truncated");
+        return false;
+    }
+    m_tail = m_data + kPreambleSize + kHeaderSize;
+
+    m_chunks.resize(chunkCount);
+    for (qint64 i = 0; i < chunkCount; i++) {
+        auto entry = m_data + tableStart + i * kTableEntrySize;
+        m_chunks[i].offset = readLE<quint64>(entry);
+        m_chunks[i].size = readLE<quint64>(entry + 8);
+        if (m_chunks[i].offset + m_chunks[i].size > static_cast<quint64>(m_size)) {
+            LOG_ERROR(QString("MRD archive chunk %1 is out of range").arg(i));
+            return false;
+        }
+    }
+
+    // The PPR text follows the last '\0' of the tail
+    auto posPPR = findFooter(m_tail, m_tailSize);
+    if (posPPR >= 0) {
+        m_ppr = Ppr::parse(QByteArray(m_tail + posPPR + 1, m_tailSize - posPPR - 1));
+    }
+    return true;
+}
+
+qint64 MrdArchive::chunkBytes() const {
+    if (m_chunksPerChannel == 0) {
+        return 0;
+    }
+    return m_header.channelBytes() / m_chunksPerChannel;
+}
+
+bool MrdArchive::readChunks(int first, int count, char *dst, int workers) const {
+    const auto bytes = chunkBytes();
+
+    std::atomic<bool> ok{true};
+    parallel_utils::parallelFor(
+        0, count,
+        [&](int i) {
+            const auto &chunk = m_chunks[first + i];
+            auto raw = qUncompress(reinterpret_cast<const uchar *>(m_data + chunk.offset),
+                                   static_cast<qsizetype>(chunk.size));
+            if (raw.size() != bytes) {
+                LOG_ERROR(QString("MRD archive chunk %1 is corrupted").arg(first + i));
+                ok = false;
+                return;
+            }
+            std::memcpy(dst + i * bytes, raw.constData(), bytes);
+        },
+        workers);
+    return ok;
+}
+
+QByteArray MrdArchive::readSlice(int channel, int slice, int echo, int experiment) const {
+    if (channel < 0 || channel >= m_channels || slice < 0 || slice >= m_header.slices ||
+        echo < 0 || echo >= m_header.echoes || experiment < 0 ||
+        experiment >= m_header.experiments) {
+        LOG_ERROR(QString("Slice index out of range, channel: %1, slice: %2, echo: %3, experiment: %4")
+                      .arg(channel).arg(slice).arg(echo).arg(experiment));
+        return {};
+    }
+
+    int index = channel * m_chunksPerChannel +
+                (experiment * m_header.echoes + echo) * m_header.slices + slice;
+    QByteArray raw(chunkBytes(), Qt::Uninitialized);
+    if (!readChunks(index, 1, raw.data(), 1)) {
+        return {};
+    }
+    return raw;
+}
+
+QByteArray MrdArchive::readChannel(int channel, int workers) const {
+    if (channel < 0 || channel >= m_channels) {
+        LOG_ERROR(QString("Channel index %1 out of range, channels: %2").arg(channel).arg(m_channels));
+        return {};
+    }
+
+    QByteArray raw(m_header.channelBytes(), Qt::Uninitialized);
+    if (!readChunks(channel * m_chunksPerChannel, m_chunksPerChannel, raw.data(), workers)) {
+        return {};
+    }
+    return raw;
+}
+
+QByteArray MrdArchive::readAll(int workers) const {
+    const qint64 kspaceSize = m_channels * m_header.channelBytes();
+
+    QByteArray bytes(kHeaderSize + kspaceSize + m_tailSize, Qt::Uninitialized);
+    std::memcpy(bytes.data(), m_rawHeader, kHeaderSize);
+    if (!readChunks(0, static_cast<int>(m_chunks.size()), bytes.data() + kHeaderSize, workers)) {
+        return {};
+    }
+    std::memcpy(bytes.data() + kHeaderSize + kspaceSize, m_tail, m_tailSize);
+    return bytes;
+}
+
+MrdInfo MrdArchive::info() const {
+    MrdInfo info;
+    info.valid = true;
+    info.header = m_header;
+    info.fileSize = m_size;
+    info.payloadSize = m_channels * m_header.channelBytes();
+    info.channels = m_channels;
+    info.ppr = m_ppr;
+    return info;
+}
+
+} // namespace mrd_utils
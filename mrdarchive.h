@@ -0,0 +1,94 @@
+#ifndef MRDARCHIVE_H
+#define MRDARCHIVE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <memory>
+#include <vector>
+
+#include "mrdutils.h"
+
+namespace mrd_utils {
+
+/**
+ * @brief 压缩存档格式(.mrdz)，k空间按层分块独立压缩，可只读取需要的层
+ * @details Layout, integers little endian:
+ *   - "MRDZ", quint32 version, quint32 channels, quint32 chunksPerChannel, quint64 tailSize
+ *   - The original 512 byte MRD header
+ *   - The original tail after k-space (footer block and PPR text), uncompressed
+ *   - Chunk table, per chunk quint64 offset from the start of the file and quint64 compressed size
+ *   - Chunks, each the qCompress (zlib) output of one slice of one channel
+ *
+ * A chunk holds views * views2 * samples samples. Chunks are ordered like the MRD
+ * k-space: [channel][experiment][echo][slice].
+ */
+class MrdArchive {
+public:
+    static constexpr const char *kMagic = "MRDZ";
+    static constexpr quint32 kVersion = 1;
+    static constexpr const char *kSuffix = "mrdz";
+
+    ~MrdArchive();
+    MrdArchive(const MrdArchive &) = delete;
+    MrdArchive &operator=(const MrdArchive &) = delete;
+
+    /**
+     * @brief Compress an MRD file, chunks are compressed in parallel
+     * @param level zlib level 0-9, -1 is the zlib default
+     * @param workers Number of threads, <= 0 means parallel_utils::maxThreads()
+     */
+    static QByteArray compress(const MrdView &view, int level = -1, int workers = 0);
+
+    /// Map an archive, returns nullptr if the file can not be mapped or is invalid
+    static std::shared_ptr<MrdArchive> open(const QString &path);
+    /// Check the magic number only
+    static bool isArchive(const QString &path);
+
+    const MrdHeader &header() const { return m_header; }
+    const Ppr &ppr() const { return m_ppr; }
+    int channels() const { return m_channels; }
+    /// experiments * echoes * slices
+    int chunksPerChannel() const { return m_chunksPerChannel; }
+    qint64 chunkBytes() const;
+    /// Size of the archive file
+    qint64 size() const { return m_size; }
+
+    /// Uncompressed k-space of one slice, empty on error
+    QByteArray readSlice(int channel, int slice, int echo = 0, int experiment = 0) const;
+    /// Uncompressed k-space of one channel, empty on error
+    QByteArray readChannel(int channel, int workers = 0) const;
+    /// The original MRD file, chunks are decompressed in parallel
+    QByteArray readAll(int workers = 0) const;
+
+    /// Same metadata as probe() gives for the original file
+    MrdInfo info() const;
+
+private:
+    MrdArchive() = default;
+    bool parse();
+    /// Decompress chunks [first, first + count) into dst
+    bool readChunks(int first, int count, char *dst, int workers) const;
+
+    struct Chunk {
+        quint64 offset = 0;
+        quint64 size = 0;
+    };
+
+    QFile m_file;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+
+    MrdHeader m_header;
+    Ppr m_ppr;
+    int m_channels = 0;
+    int m_chunksPerChannel = 0;
+    const char *m_rawHeader = nullptr;
+    const char *m_tail = nullptr;
+    qint64 m_tailSize = 0;
+    std::vector<Chunk> m_chunks;
+};
+
+} // namespace mrd_utils
+
+#endif // MRDARCHIVE_H
@@ -0,0 +1,276 @@
+#include "mrdfileset.h"
+
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <algorithm>
+#include <atomic>
+
+#include "mrdarchive.h"
+#include "parallelutils.h"
+#include "utils.h"
+
+namespace mrd_utils {
+
+template <typename Real>
+QVector<BasicMrd<Real>> CoilTensor<Real>::takeCoils() {
+    QVector<BasicMrd<Real>> mrds;
+    if (!kdata) {
+        return mrds;
+    }
+    for (int i = 0; i < coils; i++) {
+        BasicMrd<Real> m;
+        // The deleter keeps the tensor buffer alive, every coil gets its own use count
+        m.kdata = typename BasicMrd<Real>::Buffer(coil(i), [buffer = kdata](const auto *) {});
+        m.samples = header.samples;
+        m.views = header.views;
+        m.views2 = header.views2;
+        m.slices = header.slices;
+        m.echoes = header.echoes;
+        m.experiments = header.experiments;
+        m.ppr = ppr;
+        m.centred = centred;
+        mrds.push_back(std::move(m));
+    }
+    kdata.reset();
+    coils = 0;
+    return mrds;
+}
+
+std::shared_ptr<MrdFileSet> MrdFileSet::fromView(std::shared_ptr<const MrdView> view) {
+    if (!view) {
+        return nullptr;
+    }
+
+    std::shared_ptr<MrdFileSet> set(new MrdFileSet());
+    set->m_views.push_back(std::move(view));
+    if (!set->init()) {
+        return nullptr;
+    }
+    return set;
+}
+
+std::shared_ptr<MrdFileSet> MrdFileSet::fromViews(QVector<std::shared_ptr<const MrdView>> views) {
+    if (views.isEmpty() || std::find(views.begin(), views.end(), nullptr) != views.end()) {
+        LOG_ERROR("MRD file set needs a valid view of every file");
+        return nullptr;
+    }
+
+    std::shared_ptr<MrdFileSet> set(new MrdFileSet());
+    set->m_views = std::move(views);
+    if (!set->init()) {
+        return nullptr;
+    }
+    return set;
+}
+
+std::shared_ptr<MrdFileSet> MrdFileSet::open(const QStringList &paths, int workers) {
+    if (paths.isEmpty()) {
+        LOG_ERROR("No MRD file to open");
+        return nullptr;
+    }
+
+    // Mapping validates each file, which touches its tail, so files are opened in parallel too
+    std::vector<std::shared_ptr<MrdView>> views(paths.size());
+    parallel_utils::parallelFor(
+        0, static_cast<int>(paths.size()),
+        [&](int i) { views[i] = MrdView::open(paths[i]); }, workers);
+
+    std::shared_ptr<MrdFileSet> set(new MrdFileSet());
+    for (int i = 0; i < paths.size(); i++) {
+        if (!views[i]) {
+            LOG_ERROR(QString("Failed to open channel file %1").arg(paths[i]));
+            return nullptr;
+        }
+        set->m_views.push_back(std::move(views[i]));
+    }
+
+    if (!set->init()) {
+        return nullptr;
+    }
+    return set;
+}
+
+std::shared_ptr<MrdFileSet> MrdFileSet::openSiblings(const QString &path, int workers) {
+    auto files = getAllChannelsFile(path);
+    if (files.isEmpty()) {
+        // Not a prefix#N file, open it alone
+        files = QStringList{path};
+    }
+    return open(sortChannelFiles(files), workers);
+}
+
+std::shared_ptr<MrdFileSet> MrdFileSet::fromArchive(std::shared_ptr<const MrdArchive> archive) {
+    if (!archive) {
+        return nullptr;
+    }
+
+    std::shared_ptr<MrdFileSet> set(new MrdFileSet());
+    set->m_header = archive->header();
+    set->m_ppr = archive->ppr();
+    for (int c = 0; c < archive->channels(); c++) {
+        set->m_coils.push_back({0, c});
+    }
+    set->m_archive = std::move(archive);
+    if (set->m_coils.isEmpty()) {
+        LOG_ERROR("MRD archive has no channel");
+        return nullptr;
+    }
+    return set;
+}
+
+bool MrdFileSet::init() {
+    m_header = m_views.front()->header();
+    m_ppr = m_views.front()->ppr();
+
+    for (int v = 0; v < m_views.size(); v++) {
+        const auto &header = m_views[v]->header();
+        if (!(header == m_header)) {
+            LOG_ERROR(QString("MRD header of file %1 differs from the first file: "
+                              "%2x%3x%4x%5x%6x%7 datatype %8, expected %9x%10x%11x%12x%13x%14 datatype %15")
+                          .arg(v)
+                          .arg(header.experiments).arg(header.echoes).arg(header.slices)
+                          .arg(header.views).arg(header.views2).arg(header.samples)
+                          .arg(header.datatype)
+                          .arg(m_header.experiments).arg(m_header.echoes).arg(m_header.slices)
+                          .arg(m_header.views).arg(m_header.views2).arg(m_header.samples)
+                          .arg(m_header.datatype));
+            return false;
+        }
+
+        for (int c = 0; c < m_views[v]->channels(); c++) {
+            m_coils.push_back({v, c});
+        }
+    }
+
+    if (m_coils.isEmpty()) {
+        LOG_ERROR("MRD file set has no channel");
+        return false;
+    }
+    return true;
+}
+
+CoilKspace MrdFileSet::read(int coil, int block) const {
+    if (coil < 0 || coil >= m_coils.size()) {
+        LOG_ERROR(QString("Coil index %1 out of range, coils: %2").arg(coil).arg(m_coils.size()));
+        return {};
+    }
+    if (block >= blocks()) {
+        LOG_ERROR(QString("Block index %1 out of range, blocks: %2").arg(block).arg(blocks()));
+        return {};
+    }
+
+    // Blocks are contiguous, views * views2 * samples samples each
+    const auto blockElements = static_cast<size_t>(m_header.views) * m_header.views2 * m_header.samples;
+    const auto &ref = m_coils[coil];
+    CoilKspace kspace;
+    if (m_archive) {
+        if (block < 0) {
+            kspace.storage = m_archive->readChannel(ref.channel);
+        } else {
+            // Chunks are ordered [experiment][echo][slice] like the blocks
+            const int slice = block % m_header.slices;
+            const int echo = block / m_header.slices % m_header.echoes;
+            const int experiment = block / (m_header.slices * m_header.echoes);
+            kspace.storage = m_archive->readSlice(ref.channel, slice, echo, experiment);
+        }
+        if (kspace.storage.isEmpty()) {
+            return {};
+        }
+        kspace.view = m_header.channel(kspace.storage.constData(), 0);
+    } else {
+        kspace.view = m_views[ref.view]->channel(ref.channel);
+        if (block >= 0) {
+            kspace.view.data += static_cast<qint64>(block) * blockElements * kspace.view.stride();
+        }
+    }
+
+    if (block >= 0) {
+        kspace.view.elements = blockElements;
+    }
+    return kspace;
+}
+
+template <typename Real>
+CoilTensor<Real> MrdFileSet::load(int block, bool centre, int workers) const {
+    CoilTensor<Real> tensor;
+    tensor.header = m_header;
+    tensor.ppr = m_ppr;
+    if (block >= 0) {
+        tensor.header.experiments = 1;
+        tensor.header.echoes = 1;
+        tensor.header.slices = 1;
+    }
+
+    // One allocation for all coils, each worker decodes whole coils into their slice
+    const auto coilElements = tensor.coilElements();
+    std::shared_ptr<fftw_utils::Complex<Real>[]> kdata(
+        fftw_utils::createArray<Real>(coilElements * m_coils.size()));
+    std::atomic<bool> ok{true};
+    std::atomic<int> centred{0};
+    parallel_utils::parallelFor(
+        0, coils(),
+        [&](int i) {
+            // Archives decompress the block into kspace.storage, it lives until it is decoded
+            auto kspace = read(i, block);
+            bool coilCentred = false;
+            if (!kspace.view.data ||
+                !decodeKspaceInto<Real>(tensor.header, kspace.view, m_ppr, centre,
+                                        kdata.get() + i * coilElements, &coilCentred)) {
+                ok = false;
+            }
+            centred += coilCentred ? 1 : 0;
+        },
+        workers);
+
+    // Every coil has the same shape, so either all or none of them were centred
+    if (!ok || (centred != 0 && centred != coils())) {
+        LOG_ERROR("Failed to decode the coils of the MRD file set");
+        return tensor;
+    }
+    tensor.kdata = std::move(kdata);
+    tensor.coils = coils();
+    tensor.centred = centred == coils();
+    return tensor;
+}
+
+QByteArray MrdFileSet::bytes() const {
+    if (m_archive) {
+        return m_archive->readAll();
+    }
+    if (m_views.size() == 1) {
+        return m_views.front()->bytes();
+    }
+
+    // The k-space section of a file is the concatenation of its channels
+    const auto &first = m_views.front();
+    qint64 footerStart = kHeaderSize + first->channels() * m_header.channelBytes();
+
+    QByteArray merged;
+    merged.reserve(first->size() + (coils() - first->channels()) * m_header.channelBytes());
+    merged.append(first->data(), footerStart);
+    for (int v = 1; v < m_views.size(); v++) {
+        merged.append(m_views[v]->data() + kHeaderSize, m_views[v]->channels() * m_header.channelBytes());
+    }
+    merged.append(first->data() + footerStart, first->size() - footerStart);
+    return merged;
+}
+
+QStringList sortChannelFiles(QStringList paths) {
+    static QRegularExpression numberPattern("#(\\d+)\\.\\w+$");
+    auto channelNumber = [](const QString &path) {
+        auto match = numberPattern.match(QFileInfo(path).fileName());
+        return match.hasMatch() ? match.captured(1).toLongLong() : -1;
+    };
+
+    std::stable_sort(paths.begin(), paths.end(), [&](const QString &lhs, const QString &rhs) {
+        return channelNumber(lhs) < channelNumber(rhs);
+    });
+    return paths;
+}
+
+template struct CoilTensor<double>;
+template struct CoilTensor<float>;
+template CoilTensor<double> MrdFileSet::load<double>(int block, bool centre, int workers) const;
+template CoilTensor<float> MrdFileSet::load<float>(int block, bool centre, int workers) const;
+
+} // namespace mrd_utils
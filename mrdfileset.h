@@ -0,0 +1,151 @@
+#ifndef MRDFILESET_H
+#define MRDFILESET_H
+
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+#include "mrdutils.h"
+
+namespace mrd_utils {
+
+class MrdArchive;
+
+/**
+ * @brief Raw samples of a coil or of one block of it
+ * @details view refers to the mapped file, or to storage when the samples were
+ * decompressed from an archive. Copies share storage, view stays valid in every copy.
+ */
+struct CoilKspace {
+    KspaceView view;
+    /// Decompressed samples, empty for mapped files
+    QByteArray storage;
+};
+
+/**
+ * @brief 所有线圈的k空间，连续存放在一块内存中
+ * @details Layout is coil-major: [coils][experiments][echoes][slices][views][views2][samples],
+ * header describes one coil, a single block if the tensor holds one block of every coil
+ */
+template <typename Real = double>
+struct CoilTensor {
+    std::shared_ptr<fftw_utils::Complex<Real>[]> kdata = nullptr;
+    MrdHeader header;
+    int coils = 0;
+    Ppr ppr;
+    /// Decoded with decodeCentredInto, see BasicMrd::centred
+    bool centred = false;
+
+    /// Number of samples of one coil
+    size_t coilElements() const { return header.elements(); }
+    fftw_utils::Complex<Real> *coil(int index) const {
+        return kdata.get() + index * coilElements();
+    }
+
+    /// [coils][experiments][echoes][slices][views][views2][samples], valid until kdata is reset
+    nd_utils::NdArray<fftw_utils::Complex<Real>, 7> view() const {
+        return nd_utils::NdArray<fftw_utils::Complex<Real>, 7>::wrap(
+            kdata.get(), {static_cast<size_t>(coils), static_cast<size_t>(header.experiments),
+                          static_cast<size_t>(header.echoes), static_cast<size_t>(header.slices),
+                          static_cast<size_t>(header.views), static_cast<size_t>(header.views2),
+                          static_cast<size_t>(header.samples)});
+    }
+
+    /**
+     * @brief Hand every coil out as a single channel Mrd without copying
+     * @details Each Mrd is the only owner of its part of the buffer, so a stage writing it
+     * does not copy it on detach(). The buffer is freed with the last coil, the tensor is
+     * empty afterwards.
+     */
+    QVector<BasicMrd<Real>> takeCoils();
+};
+
+/**
+ * @class MrdFileSet
+ * @brief Channel files of one acquisition (prefix#1.mrd, prefix#2.mrd ...) seen as one multi-coil scan
+ * @details Every file is memory mapped, the headers must be identical. Coils are numbered
+ * file by file in ascending #N order, a file may itself contain several channels.
+ * A set can also wrap a compressed archive, its blocks are then decompressed on read.
+ */
+class MrdFileSet {
+public:
+    /// Wrap a single file, its channels become the coils
+    static std::shared_ptr<MrdFileSet> fromView(std::shared_ptr<const MrdView> view);
+
+    /**
+     * @brief Files already parsed, e.g. received from the scanner, in coil order
+     * @return nullptr if a view is null or the headers differ
+     */
+    static std::shared_ptr<MrdFileSet> fromViews(QVector<std::shared_ptr<const MrdView>> views);
+
+    /**
+     * @brief Map the files in parallel and validate their headers
+     * @return nullptr if a file is invalid or the headers differ
+     */
+    static std::shared_ptr<MrdFileSet> open(const QStringList &paths, int workers = 0);
+
+    /// open() on path and all its #N siblings found by getAllChannelsFile()
+    static std::shared_ptr<MrdFileSet> openSiblings(const QString &path, int workers = 0);
+
+    /// Wrap an archive, its channels become the coils, nothing is decompressed up front
+    static std::shared_ptr<MrdFileSet> fromArchive(std::shared_ptr<const MrdArchive> archive);
+
+    const MrdHeader &header() const { return m_header; }
+    /// PPR of the first file
+    const Ppr &ppr() const { return m_ppr; }
+    int coils() const { return static_cast<int>(m_coils.size()); }
+    /// experiments * echoes * slices
+    int blocks() const { return m_header.experiments * m_header.echoes * m_header.slices; }
+
+    /**
+     * @brief Raw k-space of a coil
+     * @param block Only this (experiment, echo, slice) block, the whole coil if negative
+     * @details Mapped files are read in place, archives decompress only the chunks asked for
+     * @return Empty view on error
+     */
+    CoilKspace read(int coil, int block = -1) const;
+
+    /**
+     * @brief Decode every coil into one contiguous tensor, coils are decoded in parallel
+     * @param block Only this (experiment, echo, slice) block of every coil, all blocks if negative
+     * @param centre See BasicMrd::fromKspace
+     * @param workers Number of decode threads, <= 0 means parallel_utils::maxThreads()
+     * @return kdata is null on failure
+     */
+    template <typename Real = double>
+    CoilTensor<Real> load(int block = -1, bool centre = false, int workers = 0) const;
+
+    /**
+     * @brief Contents of a single MRD file holding all coils as channels
+     * @details Header and footer of the first file with the k-space of every file in between,
+     * a single file is returned without copy. An archive is decompressed entirely, which
+     * only export needs.
+     */
+    QByteArray bytes() const;
+
+private:
+    MrdFileSet() = default;
+    bool init();
+
+    struct CoilRef {
+        int view = 0;
+        int channel = 0;
+    };
+
+    QVector<std::shared_ptr<const MrdView>> m_views;
+    /// Set instead of m_views for an archive
+    std::shared_ptr<const MrdArchive> m_archive;
+    QVector<CoilRef> m_coils;
+    MrdHeader m_header;
+    Ppr m_ppr;
+};
+
+/**
+ * @brief 按#后的序号排序通道文件
+ * @details getAllChannelsFile() returns directory order, where #10 sorts before #2
+ */
+QStringList sortChannelFiles(QStringList paths);
+
+} // namespace mrd_utils
+
+#endif // MRDFILESET_H
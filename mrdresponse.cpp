@@ -1,25 +1,654 @@
 #include "mrdresponse.h"
 
+#include "coilutils.h"
+#include "grappa.h"
 #include "mrdutils.h"
+#include "partialfourier.h"
+#include "sense.h"
 
-MrdResponse::MrdResponse() {}
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace {
+
+/// Accelerated exams unfolded by SENSE instead of GRAPPA
+bool usesSense(const recon::Options &options) {
+    return options.acceleration > 1 && options.parallelImaging == recon::ParallelImaging::Sense;
+}
+
+/// Multi-coil exams get an extra channel combining every coil, after the coils
+bool hasCombinedChannel(const mrd_utils::MrdFileSet &files, const recon::Options &options) {
+    // The SENSE coil channels stay folded, the unfolded image is the combined channel
+    return files.coils() > 1 && (options.coilCombine != recon::CoilCombine::None || usesSense(options));
+}
+
+/// Decoded k-space of one coil, zero filled if it is a partial Fourier acquisition
+template <typename Real>
+struct Coil {
+    mrd_utils::BasicMrd<Real> mrd;
+    partial_fourier::Coverage coverage;
+};
+
+/// Whether to centre while decoding, see BasicMrd::fromKspace
+bool centreOf(const mrd_utils::MrdHeader &header, const recon::Options &options) {
+    // Modulating the acquired views centres the zero filled k-space only if it can be centred too
+    bool centre = options.shiftFree;
+    if (options.fullViews > header.views) {
+        centre = centre && mrd_utils::canCentre(mrd_utils::volumeShape(
+                               options.fullViews, header.views2, header.samples));
+    }
+    return centre;
+}
+
+/// Zero fill a decoded coil if it is a partial Fourier acquisition
+template <typename Real>
+Coil<Real> coilOf(const mrd_utils::BasicMrd<Real> &mrd, const recon::Options &options) {
+    auto coverage = partial_fourier::locate(mrd, options.fullViews);
+    return {partial_fourier::zeroFill(mrd, coverage), coverage};
+}
+
+/**
+ * @brief Decode one coil
+ * @param block Only this (experiment, echo, slice) block, every block if negative
+ */
+template <typename Real>
+Coil<Real> loadCoil(const mrd_utils::MrdFileSet &files, int coil, int block,
+                    const recon::Options &options) {
+    auto header = files.header();
+    // Archives decompress the block into kspace.storage, it lives until the block is decoded
+    auto kspace = files.read(coil, block);
+    if (block >= 0) {
+        header.experiments = 1;
+        header.echoes = 1;
+        header.slices = 1;
+    }
+    auto mrd = mrd_utils::BasicMrd<Real>::fromKspace(header, kspace.view, files.ppr(),
+                                                     centreOf(header, options));
+    return coilOf(mrd, options);
+}
+
+/**
+ * @brief Decode every coil at once, for the stages that need all of them
+ * @details The coils are decoded in parallel into one tensor and handed out without a copy
+ * @param block Only this (experiment, echo, slice) block, every block if negative
+ */
+template <typename Real>
+QVector<Coil<Real>> loadCoils(const mrd_utils::MrdFileSet &files, int block,
+                              const recon::Options &options) {
+    QVector<Coil<Real>> coils;
+    auto tensor = files.load<Real>(block, centreOf(files.header(), options));
+    for (const auto &mrd : tensor.takeCoils()) {
+        coils.push_back(coilOf(mrd, options));
+    }
+    return coils;
+}
+
+/// FFT of the coil in place, the views a partial Fourier acquisition skipped are estimated first
+template <typename Real>
+bool transformCoil(Coil<Real> &coil, const recon::Options &options) {
+    // combineCoil() already transformed it, partial_fourier::reconstruct rejects images
+    if (coil.mrd.transformed) {
+        return coil.mrd.kdata != nullptr;
+    }
+    if (coil.coverage.isPartial()) {
+        return partial_fourier::reconstruct(coil.mrd, coil.coverage, options.partialFourier);
+    }
+    return coil.mrd.transform();
+}
+
+/// Scale of a channel above the peak of its reference block, brighter blocks saturate later
+constexpr double kPeakHeadroom = 1.25;
+
+/**
+ * @struct ChannelScale
+ * @brief Peak and window shared by every block of a channel
+ * @details images() and imageSource() both take them from the reference block of the
+ * channel, so a channel looks the same whether it is reconstructed at once or block by block
+ */
+struct ChannelScale {
+    /// Magnitude mapped to 65535, 0 if the reference failed and blocks scale themselves
+    double peak = 0;
+    image_utils::Window window;
+};
+
+/// Block of a channel its scale is taken from, the middle one
+int referenceBlock(int blocks) { return blocks / 2; }
+
+/// Peak and auto window of the reference images of a channel
+template <typename Real>
+ChannelScale scaleOf(mrd_utils::BasicMrd<Real> images) {
+    ChannelScale result;
+    auto peak = images.peakMagnitude() * kPeakHeadroom;
+    auto imageList = images.takeImages(static_cast<Real>(peak));
+    if (!imageList.isEmpty()) {
+        result.peak = peak;
+        result.window = image_utils::window(imageList.front());
+    }
+    return result;
+}
+
+/// Images quantized on the scale of their channel, or on their own if it has none
+template <typename Real>
+QVector<QImage> scaledImages(mrd_utils::BasicMrd<Real> &mrd, const ChannelScale &scale) {
+    if (scale.peak <= 0) {
+        return mrd.takeImages();
+    }
+    return mrd.takeImages(static_cast<Real>(scale.peak), &scale.window);
+}
+
+/**
+ * @brief Images of every block of a channel on the scale of its reference block
+ * @details The reference block is shared with the transformed channel, not copied
+ */
+template <typename Real>
+QVector<QImage> takeScaledImages(mrd_utils::BasicMrd<Real> &mrd) {
+    if (!mrd.transform()) {
+        return {};
+    }
+    const size_t blockSize = static_cast<size_t>(mrd.views) * mrd.views2 * mrd.samples;
+    const size_t reference = referenceBlock(mrd.experiments * mrd.echoes * mrd.slices);
+    auto block = mrd;
+    block.kdata = typename mrd_utils::BasicMrd<Real>::Buffer(mrd.kdata,
+                                                            mrd.kdata.get() + reference * blockSize);
+    block.experiments = 1;
+    block.echoes = 1;
+    block.slices = 1;
+    const auto scale = scaleOf(std::move(block));
+    return scaledImages(mrd, scale);
+}
+
+template <typename Real>
+QVector<QImage> takeImages(Coil<Real> &coil, const recon::Options &options) {
+    if (!transformCoil(coil, options)) {
+        return {};
+    }
+    return takeScaledImages(coil.mrd);
+}
+
+/// Transform the coil and add it to the combination, the coil keeps its complex images
+template <typename Real>
+bool combineCoil(coil_utils::CoilCombiner<Real> &combiner, Coil<Real> &coil,
+                 const recon::Options &options) {
+    mrd_utils::BasicMrd<Real> lowRes;
+    if (combiner.needsSensitivity()) {
+        lowRes = coil_utils::lowResolution(coil.mrd);
+    }
+    return transformCoil(coil, options) && combiner.add(coil.mrd, &lowRes);
+}
+
+/// Views acquired by options.acceleration, the pattern runs through the centre of the zero filled k-space
+template <typename Real>
+grappa::Sampling samplingOf(const Coil<Real> &coil, const recon::Options &options) {
+    grappa::Sampling sampling(coil.mrd.views, options.acceleration, options.acsLines);
+    if (coil.coverage.isPartial()) {
+        sampling.first = coil.coverage.offset;
+        sampling.last = coil.coverage.offset + coil.coverage.acquired;
+    }
+    return sampling;
+}
+
+/**
+ * @brief Every coil of the exam or of one block, the views skipped by options.acceleration
+ * estimated by GRAPPA
+ * @details GRAPPA needs all coils at once, without acceleration the coils are streamed instead
+ * @param cancelled Stops the fit once set, nothing is returned then
+ */
+template <typename Real>
+QVector<Coil<Real>> loadAccelerated(const mrd_utils::MrdFileSet &files, int block,
+                                    const recon::Options &options,
+                                    const std::atomic<bool> *cancelled = nullptr) {
+    auto coils = loadCoils<Real>(files, block, options);
+    if (coils.isEmpty()) {
+        return coils;
+    }
+    const auto sampling = samplingOf(coils.front(), options);
+    QVector<mrd_utils::BasicMrd<Real>> kspaces;
+    for (auto &coil : coils) {
+        kspaces.push_back(std::move(coil.mrd));
+    }
+
+    if (!grappa::reconstruct(kspaces, sampling, cancelled)) {
+        if (cancelled && *cancelled) {
+            return {};
+        }
+        LOG_WARNING("GRAPPA failed, the skipped views stay zero");
+    }
+    for (int i = 0; i < coils.size(); i++) {
+        coils[i].mrd = std::move(kspaces[i]);
+    }
+    return coils;
+}
+
+/**
+ * @class SenseMaps
+ * @brief SENSE sensitivities of every block of an exam reconstructed block by block
+ * @details The images of a block may leave the image cache and be loaded again, and the
+ * middle block is also loaded as the reference of the channel scale. The maps of a block
+ * are estimated on its first load and kept for the exam, later loads only fold and unfold.
+ * A failed estimate is not kept, the next load of the block tries again.
+ */
+template <typename Real>
+class SenseMaps {
+public:
+    explicit SenseMaps(int blocks) : m_mutexes(blocks), m_maps(blocks) {}
+
+    /// Maps of the block, estimated by estimate() until it returns some
+    template <typename F>
+    QVector<mrd_utils::BasicMrd<Real>> of(int block, F &&estimate) {
+        std::lock_guard<std::mutex> lock(m_mutexes[block]);
+        if (m_maps[block].isEmpty()) {
+            m_maps[block] = estimate();
+        }
+        return m_maps[block];
+    }
+
+private:
+    std::vector<std::mutex> m_mutexes;
+    std::vector<QVector<mrd_utils::BasicMrd<Real>>> m_maps;
+};
+
+/**
+ * @brief Folded images of every coil of the exam or of one block
+ * @details Views skipped by partial Fourier stay zero, SENSE transforms the coils directly
+ * @param unfolded If set, receives the SENSE image of the coils, or their RSS if unfolding failed
+ * @param cache Maps of the blocks already unfolded, used if block is not negative
+ */
+template <typename Real>
+QVector<mrd_utils::BasicMrd<Real>> loadSense(const mrd_utils::MrdFileSet &files, int block,
+                                             const recon::Options &options,
+                                             mrd_utils::BasicMrd<Real> *unfolded = nullptr,
+                                             SenseMaps<Real> *cache = nullptr) {
+    QVector<mrd_utils::BasicMrd<Real>> coils;
+    grappa::Sampling sampling;
+    for (auto &coil : loadCoils<Real>(files, block, options)) {
+        sampling = samplingOf(coil, options);
+        coils.push_back(std::move(coil.mrd));
+    }
+    if (coils.isEmpty()) {
+        return coils;
+    }
+
+    // The maps come from the ACS views, which folding drops
+    QVector<mrd_utils::BasicMrd<Real>> maps;
+    if (unfolded) {
+        auto estimate = [&] { return sense::sensitivities(coils, sampling); };
+        maps = cache && block >= 0 ? cache->of(block, estimate) : estimate();
+    }
+    for (auto &coil : coils) {
+        // A pattern SENSE cannot unfold leaves the aliased images, unfold() rejects them too
+        if (!sense::fold(coil, sampling)) {
+            coil.transform();
+        }
+    }
+    if (!unfolded) {
+        return coils;
+    }
+
+    if (!maps.isEmpty()) {
+        *unfolded = sense::unfold(coils, maps, options.acceleration);
+    }
+    if (!unfolded->kdata) {
+        LOG_WARNING("SENSE failed, combining the folded coils instead");
+        coil_utils::CoilCombiner<Real> combiner(recon::CoilCombine::Rss);
+        for (const auto &coil : coils) {
+            combiner.add(coil);
+        }
+        *unfolded = combiner.take();
+    }
+    return coils;
+}
+
+template <typename Real>
+QVector<QVector<QImage>> reconstructSense(const mrd_utils::MrdFileSet &files,
+                                          const recon::Options &options) {
+    QVector<QVector<QImage>> imageList;
+    mrd_utils::BasicMrd<Real> unfolded;
+    const bool combine = hasCombinedChannel(files, options);
+    auto coils = loadSense<Real>(files, -1, options, combine ? &unfolded : nullptr);
+    for (auto &coil : coils) {
+        imageList.push_back(takeScaledImages(coil));
+    }
+    if (combine) {
+        imageList.push_back(takeScaledImages(unfolded));
+    }
+    return imageList;
+}
+
+template <typename Real>
+QVector<QVector<QImage>> reconstructAll(const mrd_utils::MrdFileSet &files,
+                                        const recon::Options &options) {
+    if (usesSense(options)) {
+        return reconstructSense<Real>(files, options);
+    }
+
+    // Decode one coil at a time so only a single fftw copy and the running combination are alive
+    QVector<QVector<QImage>> imageList;
+    coil_utils::CoilCombiner<Real> combiner(options.coilCombine);
+    const bool combine = hasCombinedChannel(files, options);
+    auto accelerated = options.acceleration > 1 ? loadAccelerated<Real>(files, -1, options)
+                                                : QVector<Coil<Real>>();
+    for (int i = 0; i < files.coils(); i++) {
+        auto coil = accelerated.isEmpty() ? loadCoil<Real>(files, i, -1, options)
+                                          : std::move(accelerated[i]);
+        if (combine) {
+            combineCoil(combiner, coil, options);
+        }
+        // The decoded k-space is a temporary, transform it in place
+        imageList.push_back(takeImages(coil, options));
+    }
+    if (combine) {
+        auto combined = combiner.take();
+        imageList.push_back(takeScaledImages(combined));
+    }
+    return imageList;
+}
+
+/**
+ * @brief Complex images of one block of a coil, or of the combination if coil is the extra channel
+ * @param maps SENSE maps of the exam, estimated here for the blocks that have none yet
+ */
+template <typename Real>
+mrd_utils::BasicMrd<Real> reconstructBlock(const mrd_utils::MrdFileSet &files, int coil, int block,
+                                           const recon::Options &options,
+                                           SenseMaps<Real> *maps = nullptr) {
+    if (usesSense(options)) {
+        // A coil channel only needs its own folded images
+        if (coil < files.coils()) {
+            auto decoded = loadCoil<Real>(files, coil, block, options);
+            if (!sense::fold(decoded.mrd, samplingOf(decoded, options))) {
+                decoded.mrd.transform();
+            }
+            return std::move(decoded.mrd);
+        }
+        mrd_utils::BasicMrd<Real> unfolded;
+        loadSense<Real>(files, block, options, &unfolded, maps);
+        return unfolded;
+    }
+
+    // Accelerated GRAPPA blocks go through reconstructAccelerated(), one fit for every channel
+    if (coil < files.coils()) {
+        auto decoded = loadCoil<Real>(files, coil, block, options);
+        if (!transformCoil(decoded, options)) {
+            return {};
+        }
+        return std::move(decoded.mrd);
+    }
 
-MrdResponse::MrdResponse(QByteArray data) : m_data(data) {}
+    coil_utils::CoilCombiner<Real> combiner(options.coilCombine);
+    for (int i = 0; i < files.coils(); i++) {
+        auto decoded = loadCoil<Real>(files, i, block, options);
+        combineCoil(combiner, decoded, options);
+    }
+    return combiner.take();
+}
+
+/**
+ * @brief Complex images of one block of every channel, from a single GRAPPA fit
+ * @return Empty if cancelled, a channel whose transform failed is left empty
+ */
+template <typename Real>
+QVector<mrd_utils::BasicMrd<Real>> reconstructAccelerated(const mrd_utils::MrdFileSet &files,
+                                                         int block, const recon::Options &options,
+                                                         const std::atomic<bool> &cancelled) {
+    auto accelerated = loadAccelerated<Real>(files, block, options, &cancelled);
+    if (accelerated.isEmpty()) {
+        return {};
+    }
+
+    QVector<mrd_utils::BasicMrd<Real>> channels;
+    coil_utils::CoilCombiner<Real> combiner(options.coilCombine);
+    const bool combine = hasCombinedChannel(files, options);
+    for (auto &coil : accelerated) {
+        mrd_utils::BasicMrd<Real> lowRes;
+        if (combine && combiner.needsSensitivity()) {
+            lowRes = coil_utils::lowResolution(coil.mrd);
+        }
+        if (!transformCoil(coil, options)) {
+            channels.push_back({});
+            continue;
+        }
+        if (combine) {
+            combiner.add(coil.mrd, &lowRes);
+        }
+        channels.push_back(std::move(coil.mrd));
+    }
+    if (combine) {
+        channels.push_back(combiner.take());
+    }
+    return channels;
+}
+
+/**
+ * @class ChannelScales
+ * @brief One ChannelScale per channel of an exam reconstructed block by block
+ * @details The first block loaded of a channel reconstructs the reference block too,
+ * unless it is the reference. Channels reconstructed together get their scales together
+ * by ofAll(), an exam uses either of() or ofAll().
+ */
+class ChannelScales {
+public:
+    explicit ChannelScales(int channels) : m_once(channels), m_scales(channels) {}
 
-IExamResponse *MrdResponse::clone() const { return new MrdResponse(m_data); }
+    /// Scale of the channel, computed by reference() on the first call
+    template <typename F>
+    const ChannelScale &of(int channel, F &&reference) {
+        std::call_once(m_once[channel], [&] { m_scales[channel] = reference(); });
+        return m_scales[channel];
+    }
+
+    /**
+     * @brief Scales of every channel, computed by references() on the first call
+     * @details references() returns none if it was cancelled, nullptr is returned then and
+     * the next call computes them again
+     */
+    template <typename F>
+    const std::vector<ChannelScale> *ofAll(F &&references) {
+        std::lock_guard<std::mutex> lock(m_allMutex);
+        if (!m_hasAll) {
+            std::optional<std::vector<ChannelScale>> scales = references();
+            if (!scales) {
+                return nullptr;
+            }
+            m_scales = std::move(*scales);
+            m_scales.resize(m_once.size());
+            m_hasAll = true;
+        }
+        return &m_scales;
+    }
+
+private:
+    std::vector<std::once_flag> m_once;
+    std::vector<ChannelScale> m_scales;
+    std::mutex m_allMutex;
+    bool m_hasAll = false;
+};
+
+/// Images of one block quantized on the scale of its channel
+template <typename Real>
+QVector<QImage> loadBlock(const mrd_utils::MrdFileSet &files, int channel, int block,
+                          const recon::Options &options, ChannelScales &scales,
+                          SenseMaps<Real> *maps = nullptr) {
+    auto mrd = reconstructBlock<Real>(files, channel, block, options, maps);
+    const auto &scale = scales.of(channel, [&] {
+        const int reference = referenceBlock(files.blocks());
+        // Copies share the images, the reference releases only its own reference to them
+        return scaleOf(block == reference
+                           ? mrd
+                           : reconstructBlock<Real>(files, channel, reference, options, maps));
+    });
+    return scaledImages(mrd, scale);
+}
+
+/// Images of one block of every channel, GRAPPA runs once for all of them
+template <typename Real>
+QVector<QVector<QImage>> loadAcceleratedBlock(const mrd_utils::MrdFileSet &files, int block,
+                                              const recon::Options &options, ChannelScales &scales,
+                                              const std::atomic<bool> &cancelled) {
+    auto channels = reconstructAccelerated<Real>(files, block, options, cancelled);
+    if (channels.isEmpty()) {
+        return {};
+    }
+
+    const auto *channelScales = scales.ofAll([&]() -> std::optional<std::vector<ChannelScale>> {
+        const int reference = referenceBlock(files.blocks());
+        auto images = block == reference ? channels
+                                         : reconstructAccelerated<Real>(files, reference, options, cancelled);
+        if (images.isEmpty()) {
+            return std::nullopt;
+        }
+        std::vector<ChannelScale> result;
+        for (const auto &channel : images) {
+            result.push_back(scaleOf(channel));
+        }
+        return result;
+    });
+    if (!channelScales) {
+        return {};
+    }
 
-QVector<QVector<QImage>> MrdResponse::images() const {
     QVector<QVector<QImage>> imageList;
+    for (int i = 0; i < channels.size(); i++) {
+        imageList.push_back(scaledImages(channels[i], (*channelScales)[i]));
+    }
+    return imageList;
+}
+
+/// Loader of one channel of a block, the blocks of a SENSE exam keep their maps across loads
+template <typename Real>
+CachedImageSource::Loader channelLoader(std::shared_ptr<const mrd_utils::MrdFileSet> files,
+                                        const recon::Options &options,
+                                        std::shared_ptr<ChannelScales> scales) {
+    std::shared_ptr<SenseMaps<Real>> maps;
+    if (usesSense(options)) {
+        maps = std::make_shared<SenseMaps<Real>>(files->blocks());
+    }
+    return [files, options, scales, maps](int channel, int block, const std::atomic<bool> &) {
+        return loadBlock<Real>(*files, channel, block, options, *scales, maps.get());
+    };
+}
+
+/**
+ * @brief The exam options with the values the sequence recorded in the PPR
+ * @details The PPR describes the data on disk, so its prescribed views and acceleration
+ * win over the exam parameters, a disagreement is logged. Missing views are only filled
+ * in by partial Fourier if the exam or the PPR says they were skipped on purpose.
+ */
+recon::Options acquisitionOptions(const mrd_utils::MrdFileSet &files, recon::Options options) {
+    const auto acquisition = mrd_utils::Acquisition::fromPpr(files.ppr());
+    auto apply = [](int &option, int recorded, const char *key) {
+        if (recorded <= 0 || recorded == option) {
+            return;
+        }
+        LOG_WARNING(QString("PPR %1 %2 replaces %3 of the exam").arg(key).arg(recorded).arg(option));
+        option = recorded;
+    };
+    apply(options.fullViews, acquisition.views, mrd_utils::Acquisition::KEY_VIEWS);
+    apply(options.acceleration, acquisition.acceleration, mrd_utils::Acquisition::KEY_ACCELERATION);
+    apply(options.acsLines, acquisition.acsLines, mrd_utils::Acquisition::KEY_ACS_LINES);
 
-    for(const auto& mrd:mrd_utils::Mrd::fromBytes(m_data)){
-        imageList.push_back(mrd.images());
+    options.partialFourierAcquired = options.partialFourierAcquired || acquisition.partialFourier;
+    const int views = files.header().views;
+    if (options.fullViews > views && !options.partialFourierAcquired) {
+        LOG_WARNING(QString("%1 of %2 views acquired without a partial Fourier flag, "
+                            "reconstructed as acquired")
+                        .arg(views)
+                        .arg(options.fullViews));
+        options.fullViews = 0;
     }
+    return options;
+}
+
+} // namespace
+
+MrdResponse::MrdResponse() {}
+
+MrdResponse::MrdResponse(QByteArray data)
+    : m_files(mrd_utils::MrdFileSet::fromView(mrd_utils::MrdView::fromBytes(data))) {}
+
+MrdResponse::MrdResponse(std::shared_ptr<const mrd_utils::MrdView> view)
+    : m_files(mrd_utils::MrdFileSet::fromView(view)) {}
+
+MrdResponse::MrdResponse(std::shared_ptr<const mrd_utils::MrdFileSet> files) : m_files(files) {}
+
+IExamResponse *MrdResponse::clone() const { return new MrdResponse(m_files); }
+
+QVector<QVector<QImage>> MrdResponse::images(const recon::Options &examOptions) const {
+    QVector<QVector<QImage>> imageList;
+    if (!m_files) {
+        return imageList;
+    }
+    const auto options = acquisitionOptions(*m_files, examOptions);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool single = options.precision == recon::Precision::Single;
+    const auto &header = m_files->header();
+    imageList = single ? reconstructAll<float>(*m_files, options)
+                       : reconstructAll<double>(*m_files, options);
+
+    auto complexSize = single ? sizeof(fftwf_complex) : sizeof(fftw_complex);
+    LOG_DEBUG(QString("Reconstructed %1 channels in %2 ms (%3 precision, %4 MiB k-space per channel)")
+                  .arg(imageList.size())
+                  .arg(timer.elapsed())
+                  .arg(recon::precisionName(options.precision))
+                  .arg(header.elements() * complexSize / (1024.0 * 1024.0), 0, 'f', 1));
 
     return imageList;
 }
 
+std::shared_ptr<IImageSource> MrdResponse::imageSource(const recon::Options &examOptions) const {
+    if (!m_files) {
+        return std::make_shared<StaticImageSource>(QVector<QVector<QImage>>());
+    }
+    const auto options = acquisitionOptions(*m_files, examOptions);
+
+    const auto &header = m_files->header();
+    auto blocks = m_files->blocks();
+    auto files = m_files;
+    // The combination is the channel most users look at, show it first
+    QStringList names;
+    for (int i = 0; i < files->coils(); i++) {
+        names.append(QString::number(i));
+    }
+    int defaultChannel = 0;
+    if (hasCombinedChannel(*files, options)) {
+        defaultChannel = static_cast<int>(names.size());
+        names.append(QObject::tr("Combined"));
+    }
+
+    const bool single = options.precision == recon::Precision::Single;
+    const int channels = static_cast<int>(names.size());
+    auto scales = std::make_shared<ChannelScales>(channels);
+    std::shared_ptr<CachedImageSource> source;
+    if (options.acceleration > 1 && !usesSense(options)) {
+        // GRAPPA fits every coil of a block at once, so every channel is cached from one fit
+        auto loader = [files, options, scales, single](int block, const std::atomic<bool> &cancelled) {
+            if (single) {
+                return loadAcceleratedBlock<float>(*files, block, options, *scales, cancelled);
+            }
+            return loadAcceleratedBlock<double>(*files, block, options, *scales, cancelled);
+        };
+        source = std::make_shared<CachedImageSource>(
+            channels, blocks, header.views2, CachedImageSource::BlockLoader(loader));
+    } else {
+        auto loader = single ? channelLoader<float>(files, options, scales)
+                             : channelLoader<double>(files, options, scales);
+        source = std::make_shared<CachedImageSource>(channels, blocks, header.views2, loader);
+    }
+    source->setChannelNames(names, defaultChannel);
+    return source;
+}
+
 QByteArray MrdResponse::bytes() const
 {
-    return m_data;
+    if (!m_files) {
+        return QByteArray();
+    }
+    return m_files->bytes();
 }
-
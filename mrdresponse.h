@@ -2,19 +2,41 @@
 #define MRDRESPONSE_H
 
 #include "examresponse.h"
+#include "mrdfileset.h"
+#include "mrdview.h"
+
+#include <memory>
 
 class MrdResponse : public IExamResponse {
 public:
     MrdResponse();
     MrdResponse(QByteArray data);
+    MrdResponse(std::shared_ptr<const mrd_utils::MrdView> view);
+    /// Multi-file acquisition, every coil of the set becomes a channel
+    MrdResponse(std::shared_ptr<const mrd_utils::MrdFileSet> files);
     IExamResponse *clone() const override;
 
-    QVector<QVector<QImage>> images() const override;
+    using IExamResponse::images;
+    /**
+     * @brief One channel per coil, multi-coil exams end with the recon::Options::coilCombine channel
+     * @details With SENSE the coil channels are folded and the last channel is the unfolded image.
+     * Every block of a channel shares the scale and window of its middle block, like imageSource().
+     */
+    QVector<QVector<QImage>> images(const recon::Options &options) const override;
+    /**
+     * @brief Reconstruct one (experiment, echo, slice) block of one coil per request
+     * @details Every block of a channel shares one scale and window, taken from the middle
+     * block of the channel with some headroom, so the images equal those of images().
+     * GRAPPA accelerated exams fit each block once and cache every channel from that fit.
+     */
+    std::shared_ptr<IImageSource> imageSource(const recon::Options &options) const override;
 
+    /// A file set is merged into a single MRD file
     QByteArray bytes() const override;
 
 private:
-    QByteArray m_data;
+    /// Shared between clones, the raw data is never copied
+    std::shared_ptr<const mrd_utils::MrdFileSet> m_files;
 };
 
 #endif // MRDRESPONSE_H
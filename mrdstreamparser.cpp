@@ -0,0 +1,180 @@
+#include "mrdstreamparser.h"
+
+#include "utils.h"
+
+using mrd_utils::kFooterBlockSize;
+using mrd_utils::kHeaderSize;
+
+bool MrdStreamParser::parse(QIODevice *device, qint64 chunkSize) {
+    if (!device || !device->isReadable()) {
+        fail("MRD stream device is not readable");
+        return false;
+    }
+
+    while (!hasError() && !device->atEnd()) {
+        auto chunk = device->read(chunkSize);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        feed(chunk);
+    }
+
+    return finish();
+}
+
+void MrdStreamParser::feed(const QByteArray &chunk) {
+    if (hasError() || m_finished || chunk.isEmpty()) {
+        return;
+    }
+
+    m_buffer.append(chunk);
+    m_received += chunk.size();
+
+    if (!m_hasHeader) {
+        if (m_received < kHeaderSize) {
+            return;
+        }
+
+        m_header = mrd_utils::MrdHeader::parse(m_buffer.constData());
+        if (m_header.sampleSize() == 0) {
+            fail(QString("Unknown datatype: %1").arg(m_header.datatype));
+            return;
+        }
+        if (m_header.channelBytes() == 0) {
+            fail("MRD file data error: kdataSize is zero");
+            return;
+        }
+        m_hasHeader = true;
+        if (m_onHeader) {
+            m_onHeader(m_header);
+        }
+    }
+
+    decodeAvailable();
+
+    // Channel i is data if another full channel and the footer block follow it
+    emitConfirmed(m_received - m_header.channelBytes() - kFooterBlockSize);
+}
+
+bool MrdStreamParser::finish() {
+    if (m_finished) {
+        return !hasError();
+    }
+    m_finished = true;
+    if (hasError()) {
+        return false;
+    }
+
+    if (!m_hasHeader) {
+        fail(QString("Received MRD file with length %1, minimum length should be 512")
+                 .arg(m_received));
+        return false;
+    }
+
+    // The footer is among the buffered bytes, after the last channel handed out
+    auto posPPR = mrd_utils::findFooter(m_buffer.constData(), m_buffer.size());
+    if (posPPR < 0) {
+        fail("Invalid MRD file");
+        return false;
+    }
+    m_ppr = mrd_utils::Ppr::parse(m_buffer.mid(posPPR + 1));
+
+    qint64 totalSize = m_bufferStart + posPPR + 1 - kHeaderSize - kFooterBlockSize;
+    if (totalSize < 0) {
+        fail("Invalid totalSize calculated for Mrd data.");
+        return false;
+    }
+    if (totalSize % m_header.channelBytes() != 0) {
+        fail("MRD file data error");
+        return false;
+    }
+
+    m_channels = static_cast<int>(totalSize / m_header.channelBytes());
+    if (m_channels < m_emitted) {
+        fail(QString("MRD footer larger than one channel, %1 channels were handed out but only %2 exist")
+                 .arg(m_emitted)
+                 .arg(m_channels));
+        return false;
+    }
+
+    emitConfirmed(kHeaderSize + totalSize);
+    m_pending.clear();
+    if (!m_keepStream) {
+        m_buffer.clear();
+    }
+    return true;
+}
+
+void MrdStreamParser::reset() {
+    m_buffer.clear();
+    m_bufferStart = 0;
+    m_received = 0;
+    m_hasHeader = false;
+    m_finished = false;
+    m_error.clear();
+    m_header = mrd_utils::MrdHeader();
+    m_ppr = mrd_utils::Ppr();
+    m_channels = 0;
+    m_decoded = 0;
+    m_emitted = 0;
+    m_pending.clear();
+}
+
+std::shared_ptr<mrd_utils::MrdView> MrdStreamParser::view() const {
+    if (!m_keepStream || !m_finished || hasError()) {
+        return nullptr;
+    }
+    // QByteArray is implicitly shared, the view refers to the received bytes
+    return mrd_utils::MrdView::fromBytes(m_buffer);
+}
+
+void MrdStreamParser::fail(const QString &message) {
+    LOG_ERROR(message);
+    m_error = message;
+}
+
+void MrdStreamParser::decodeAvailable() {
+    auto channelBytes = m_header.channelBytes();
+
+    while (channelOffset(m_decoded) + channelBytes <= m_received) {
+        std::shared_ptr<mrd_utils::Mrd> mrd;
+        if (m_onChannel) {
+            auto kdata = m_buffer.constData() + (channelOffset(m_decoded) - m_bufferStart);
+            auto kspace = m_header.channel(kdata, 0);
+            mrd = std::make_shared<mrd_utils::Mrd>(mrd_utils::Mrd::fromKspace(m_header, kspace));
+            if (!mrd->kdata) {
+                fail(QString("Failed to decode channel %1").arg(m_decoded));
+                return;
+            }
+        }
+        m_pending.push_back(std::move(mrd));
+        m_decoded++;
+    }
+}
+
+void MrdStreamParser::emitConfirmed(qint64 confirmedEnd) {
+    auto channelBytes = m_header.channelBytes();
+
+    int emitted = m_emitted;
+    while (!m_pending.empty() && channelOffset(m_emitted) + channelBytes <= confirmedEnd) {
+        auto mrd = std::move(m_pending.front());
+        m_pending.pop_front();
+        if (m_onChannel) {
+            m_onChannel(m_emitted, std::move(mrd));
+        }
+        m_emitted++;
+    }
+
+    if (m_emitted == emitted || m_keepStream) {
+        return;
+    }
+
+    // Channels handed out are no longer needed
+    auto dropEnd = channelOffset(m_emitted);
+    m_buffer.remove(0, dropEnd - m_bufferStart);
+    m_bufferStart = dropEnd;
+}
+
+qint64 MrdStreamParser::channelOffset(int index) const {
+    return kHeaderSize + index * m_header.channelBytes();
+}
@@ -0,0 +1,105 @@
+#ifndef MRDSTREAMPARSER_H
+#define MRDSTREAMPARSER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "mrdutils.h"
+
+/**
+ * @class MrdStreamParser
+ * @brief Push-style MRD parser, handles each channel as soon as its bytes have arrived
+ * @details Bytes are pushed with feed() or pulled from a QIODevice by parse(). Unless the
+ * stream is kept for view(), only the bytes of channels not yet handed out stay in memory.
+ *
+ * The stream length is unknown until finish(), so a channel is handed out once at least
+ * one more channel plus the fixed footer block follow it, which can only be data
+ * because the PPR footer is always smaller than a channel. The remaining channels
+ * are handed out by finish() after the footer has been located.
+ */
+class MrdStreamParser {
+public:
+    static constexpr qint64 kDefaultChunkSize = 4 * 1024 * 1024;
+
+    using HeaderHandler = std::function<void(const mrd_utils::MrdHeader &header)>;
+    /**
+     * @brief Called with every decoded channel in order
+     * @details The PPR follows the k-space, so mrd carries no ppr and its views are in
+     * acquisition order, ppr() holds it once finish() succeeded
+     */
+    using ChannelHandler = std::function<void(int index, std::shared_ptr<mrd_utils::Mrd> mrd)>;
+
+    MrdStreamParser() = default;
+
+    void setHeaderHandler(HeaderHandler handler) { m_onHeader = std::move(handler); }
+    /// Channels are only decoded if there is a handler
+    void setChannelHandler(ChannelHandler handler) { m_onChannel = std::move(handler); }
+    /// Keep every received byte for view(), call before the first feed()
+    void setKeepStream(bool keep) { m_keepStream = keep; }
+
+    /**
+     * @brief Read a device chunk by chunk until its end, then call finish()
+     * @return false on parse error
+     */
+    bool parse(QIODevice *device, qint64 chunkSize = kDefaultChunkSize);
+
+    /// Push the next bytes of the stream
+    void feed(const QByteArray &chunk);
+
+    /**
+     * @brief End of stream, locate the footer and hand out the remaining channels
+     * @return false if the stream is not a valid MRD file
+     */
+    bool finish();
+
+    /// Drop all state to parse a new stream, the handlers are kept
+    void reset();
+
+    bool hasHeader() const { return m_hasHeader; }
+    const mrd_utils::MrdHeader &header() const { return m_header; }
+    /// Acquisition parameters, available after finish()
+    const mrd_utils::Ppr &ppr() const { return m_ppr; }
+    /// Number of channels, available after finish()
+    int channels() const { return m_channels; }
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString error() const { return m_error; }
+
+    /**
+     * @brief The received file, without copying it
+     * @return nullptr unless the stream was kept and finish() succeeded
+     */
+    std::shared_ptr<mrd_utils::MrdView> view() const;
+
+private:
+    void fail(const QString &message);
+    void decodeAvailable();
+    void emitConfirmed(qint64 confirmedEnd);
+    qint64 channelOffset(int index) const;
+
+    HeaderHandler m_onHeader;
+    ChannelHandler m_onChannel;
+    bool m_keepStream = false;
+
+    /// Bytes of the stream starting at absolute offset m_bufferStart
+    QByteArray m_buffer;
+    qint64 m_bufferStart = 0;
+    qint64 m_received = 0;
+
+    bool m_hasHeader = false;
+    bool m_finished = false;
+    QString m_error;
+    mrd_utils::MrdHeader m_header;
+    mrd_utils::Ppr m_ppr;
+    int m_channels = 0;
+
+    /// Channels whose bytes are complete, decoded if there is a channel handler
+    int m_decoded = 0;
+    int m_emitted = 0;
+    /// Decoded channels not yet known to lie before the footer
+    std::deque<std::shared_ptr<mrd_utils::Mrd>> m_pending;
+};
+
+#endif // MRDSTREAMPARSER_H
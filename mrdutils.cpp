@@ -1,60 +1,141 @@
 #include "mrdutils.h"
 
-#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <vector>
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
 
+#include "imageutils.h"
+#include "parallelutils.h"
+#include "simdutils.h"
 #include "utils.h"
 
 namespace {
 
-template <typename T>
-/// 从指针中读取指定长度的整数，并转为int类型
-int readInt32(const char *ptr) {
-    return static_cast<int>(qFromLittleEndian<T>(ptr));
+/// Samples per task when searching the peak magnitude
+constexpr size_t kMagnitudeChunk = size_t(1) << 16;
+/// Below this many samples the magnitude passes run on the calling thread only
+constexpr size_t kMagnitudeParallelMin = size_t(1) << 18;
+
+/// Multiply sample i of the row by (-1)^i, or by -(-1)^i if negateFirst
+template <typename Real>
+void alternateSign(Real (*row)[2], size_t n, bool negateFirst) {
+    for (size_t i = negateFirst ? 0 : 1; i < n; i += 2) {
+        row[i][0] = -row[i][0];
+        row[i][1] = -row[i][1];
+    }
 }
 
-template <typename T>
-fftw_utils::fftw_complex_ptr readKdata(const char *ptr, int nele, bool isComplex) {
-    auto kdata_ptr = fftw_utils::createArray(nele);
-
+/**
+ * @param volume If not null, modulate every volume of this shape by (-1)^(x+y+z)
+ */
+template <typename T, typename Real>
+void readKdata(const char *ptr, Real (*dst)[2], size_t nele, bool isComplex,
+               const std::vector<int> *volume) {
     auto array = reinterpret_cast<const T *>(ptr);
-    if (isComplex) {
-        for (size_t i = 0; i < nele; i++) {
-            kdata_ptr.get()[i][0] = array[2 * i];
-            kdata_ptr.get()[i][1] = array[2 * i + 1];
-        }
-    } else {
-        for (size_t i = 0; i < nele; i++) {
-            kdata_ptr.get()[i][0] = array[i];
-            kdata_ptr.get()[i][1] = 0;
-        }
+    if (!volume) {
+        simd_utils::toComplex(array, dst, nele, isComplex);
+        return;
     }
-    return kdata_ptr;
-}
 
-template <typename T>
-std::vector<fftw_utils::fftw_complex_ptr> readKdatas(const char *ptr, int nele, bool isComplex,
-                                   int totalSize) {
-    auto kdataSize = nele * sizeof(T) * (isComplex ? 2 : 1);
+    // Rows along z (samples) are contiguous, the row (x, y) starts with (-1)^(x+y)
+    const size_t nz = (*volume)[2];
+    const size_t ny = (*volume)[1];
+    const size_t rowsPerVolume = static_cast<size_t>((*volume)[0]) * ny;
+    const size_t rowScalars = isComplex ? 2 * nz : nz;
+    for (size_t row = 0; row * nz < nele; row++) {
+        auto r = row % rowsPerVolume;
+        auto out = dst + row * nz;
+        simd_utils::toComplex(array + row * rowScalars, out, nz, isComplex);
+        alternateSign(out, nz, ((r / ny) + (r % ny)) % 2 == 1);
+    }
+}
 
-    if (kdataSize == 0) {
+template <typename Real>
+bool decodeKdata(const mrd_utils::KspaceView &kspace, fftw_utils::Complex<Real> *dst,
+                 const std::vector<int> *volume) {
+    if (!kspace.data || kspace.elements == 0) {
         LOG_ERROR("MRD file data error: kdataSize is zero");
-        return {};
+        return false;
     }
-    if (totalSize % kdataSize != 0) {
-        LOG_ERROR("MRD file data error");
-        return {};
+
+    auto ptr = kspace.data;
+    auto nele = kspace.elements;
+    bool isComplex = kspace.isComplex();
+    switch (kspace.datatype & 0xf) {
+    case 0:
+        readKdata<quint8>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 1:
+        readKdata<qint8>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 2:
+        readKdata<quint16>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 3:
+        readKdata<qint16>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 4:
+        readKdata<quint32>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 5:
+        readKdata<qint32>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 6:
+        readKdata<float>(ptr, dst, nele, isComplex, volume);
+        return true;
+    case 7:
+        readKdata<double>(ptr, dst, nele, isComplex, volume);
+        return true;
+    default:
+        LOG_ERROR(QString("Unknown datatype: %1").arg(kspace.datatype));
+        return false;
     }
+}
+
+/**
+ * @brief Move the views of every block to their k-space positions
+ * @param positions mrd_utils::Acquisition::viewPositions(), a permutation of [0, views)
+ * @param centred Rows carry the (-1)^view factor of decodeCentredInto for their acquired
+ * position, a row moving by an odd distance is negated to match its new one
+ */
+template <typename Real>
+void reorderViews(fftw_utils::Complex<Real> *data, size_t elements, int views, size_t rowLength,
+                  const QVector<int> &positions, bool centred) {
+    const size_t blockLength = views * rowLength;
+    parallel_utils::parallelFor(0, static_cast<int>(elements / blockLength), [&](int block) {
+        auto blockData = data + block * blockLength;
+        auto acquired = fftw_utils::createArray<Real>(blockLength);
+        std::memcpy(acquired.get(), blockData, blockLength * sizeof(*blockData));
+        for (int view = 0; view < views; view++) {
+            auto dst = blockData + positions[view] * rowLength;
+            std::memcpy(dst, acquired.get() + view * rowLength, rowLength * sizeof(*dst));
+            if (centred && (positions[view] - view) % 2 != 0) {
+                for (size_t i = 0; i < rowLength; i++) {
+                    dst[i][0] = -dst[i][0];
+                    dst[i][1] = -dst[i][1];
+                }
+            }
+        }
+    });
+}
 
-    std::vector<fftw_utils::fftw_complex_ptr> kdatas_vec;
-    kdatas_vec.reserve(totalSize / kdataSize);
-    int noChannels = totalSize / kdataSize;
-    for (int i = 0; i < noChannels; i++) {
-        auto single_kdata_ptr = readKdata<T>(ptr + i * kdataSize, nele, isComplex);
-        kdatas_vec.push_back(std::move(single_kdata_ptr));
+template <typename Real>
+std::vector<fftw_utils::complex_ptr<Real>> readKdatas(const mrd_utils::MrdView &view,
+                                                      int workers) {
+    // Channels are independent, each worker decodes whole channels into its own slot
+    std::vector<fftw_utils::complex_ptr<Real>> kdatas_vec(view.channels());
+    parallel_utils::parallelFor(
+        0, view.channels(),
+        [&](int i) { kdatas_vec[i] = mrd_utils::decode<Real>(view.channel(i)); }, workers);
+
+    for (const auto &single_kdata_ptr : kdatas_vec) {
+        if (!single_kdata_ptr) {
+            return {};
+        }
     }
     return kdatas_vec;
 }
@@ -62,11 +143,48 @@ std::vector<fftw_utils::fftw_complex_ptr> readKdatas(const char *ptr, int nele,
 
 namespace mrd_utils {
 
-QVector<int> Mrd::shape() const {
+template <typename Real>
+QVector<int> BasicMrd<Real>::shape() const {
     return {experiments, echoes, slices, views, views2, samples};
 }
 
-size_t Mrd::size() const {
+template <typename Real>
+typename BasicMrd<Real>::Kspace BasicMrd<Real>::kspace() const {
+    if (!kdata || size() == 0) {
+        return {};
+    }
+    return Kspace::wrap(kdata.get(),
+                        {static_cast<size_t>(experiments), static_cast<size_t>(echoes),
+                         static_cast<size_t>(slices), static_cast<size_t>(views),
+                         static_cast<size_t>(views2), static_cast<size_t>(samples)},
+                        kdata);
+}
+
+template <typename Real>
+typename BasicMrd<Real>::Volumes BasicMrd<Real>::volumes() const {
+    if (!kdata || size() == 0) {
+        return {};
+    }
+    return Volumes::wrap(kdata.get(),
+                         {static_cast<size_t>(experiments) * echoes * slices, static_cast<size_t>(views),
+                          static_cast<size_t>(views2), static_cast<size_t>(samples)},
+                         kdata);
+}
+
+template <typename Real>
+typename BasicMrd<Real>::MutableVolumes BasicMrd<Real>::detachVolumes() {
+    auto data = detach();
+    if (!data || size() == 0) {
+        return {};
+    }
+    return MutableVolumes::wrap(data,
+                                {static_cast<size_t>(experiments) * echoes * slices,
+                                 static_cast<size_t>(views), static_cast<size_t>(views2),
+                                 static_cast<size_t>(samples)});
+}
+
+template <typename Real>
+size_t BasicMrd<Real>::size() const {
     if (experiments <= 0 || echoes <= 0 || slices <= 0 || views <= 0 ||
         views2 <= 0 || samples <= 0) {
         return 0;
@@ -77,126 +195,211 @@ size_t Mrd::size() const {
            static_cast<size_t>(views2) * static_cast<size_t>(samples);
 }
 
-QVector<QImage> Mrd::images() const {
+template <typename Real>
+std::vector<int> BasicMrd<Real>::transformShape() const {
+    if (views2 > 1) {
+        // 3D encode, the partitions are a phase encoded dimension
+        return {views, views2, samples};
+    }
+    // 2D multi-slice, every slice is transformed on its own
+    return {views, samples};
+}
+
+template <typename Real>
+int BasicMrd<Real>::transforms() const {
+    return experiments * echoes * slices;
+}
+
+template <typename Real>
+QVector<QImage> BasicMrd<Real>::images() const {
     if (!kdata.get()) {
         return {};
     }
-
-    size_t noImages;
-    std::vector<int> shape(3);
-    if (slices == 1) {
-        // T1
-        noImages = views2;
-        shape[0] = views;
-        shape[1] = views2;
-        shape[2] = samples;
-    } else {
-        // T2
-        noImages = slices;
-        shape[0] = slices;
-        shape[1] = views;
-        shape[2] = samples;
+    if (transformed) {
+        return magnitudeImages(kdata.get());
     }
 
-    auto outPtr = fftw_utils::exec_fft_3d(kdata.get(), shape);
+    auto outPtr = fftw_utils::exec_fft(kdata.get(), transformShape(), transforms());
     if (!outPtr.get()) {
         LOG_ERROR("FFT execution failed or returned null pointer.");
         return {};
     }
-    fftw_utils::fftshift3d(outPtr.get(), shape);
+    if (!centred) {
+        fftw_utils::fftshift(outPtr.get(), {transforms(), views, views2, samples}, {1, 2, 3});
+    }
+    return magnitudeImages(outPtr.get());
+}
 
-    // Take absolute values
-    size_t noPixels = shape[0] * shape[1] * shape[2];
-    auto absValues = fftw_utils::abs(outPtr.get(), noPixels);
+template <typename Real>
+QVector<QImage> BasicMrd<Real>::takeImages() {
+    if (!transform()) {
+        return {};
+    }
+    auto imageList = magnitudeImages(kdata.get());
+    kdata.reset();
+    return imageList;
+}
 
-    double max_val = 0;
-    for (size_t i = 0; i < noPixels; i++) {
-        if (absValues[i] > max_val) {
-            max_val = absValues[i];
-        }
+template <typename Real>
+QVector<QImage> BasicMrd<Real>::takeImages(Real peak, const image_utils::Window *window) {
+    if (!transform()) {
+        return {};
+    }
+    auto imageList = magnitudeImages(kdata.get(), peak, window);
+    kdata.reset();
+    return imageList;
+}
+
+template <typename Real>
+Real BasicMrd<Real>::peakMagnitude() {
+    if (!transform()) {
+        return 0;
+    }
+    return maxMagnitude(kdata.get());
+}
+
+template <typename Real>
+bool BasicMrd<Real>::transform() {
+    if (transformed) {
+        return kdata != nullptr;
+    }
+
+    // Copies the k-space only if another Mrd still shares it
+    auto data = detach();
+    if (!data) {
+        return false;
+    }
+
+    if (!fftw_utils::exec_fft_inplace(data, transformShape(), transforms())) {
+        LOG_ERROR("FFT execution failed.");
+        return false;
     }
+    if (!centred) {
+        // One block per transform, views2 is 1 for 2D
+        fftw_utils::fftshift(data, {transforms(), views, views2, samples}, {1, 2, 3});
+    }
+    transformed = true;
+    return true;
+}
+
+template <typename Real>
+Real BasicMrd<Real>::maxMagnitude(const fftw_utils::Complex<Real> *volume) const {
+    // Compared squared so the sqrt is taken once
+    const size_t noPixels = size();
+    if (noPixels == 0) {
+        return 0;
+    }
+    const size_t chunks = (noPixels + kMagnitudeChunk - 1) / kMagnitudeChunk;
+    const int workers = noPixels < kMagnitudeParallelMin ? 1 : 0;
+    std::vector<Real> peaks(chunks, 0);
+    parallel_utils::parallelFor(0, static_cast<int>(chunks), [&](int chunk) {
+        size_t begin = chunk * kMagnitudeChunk;
+        peaks[chunk] = simd_utils::maxNorm(volume + begin, std::min(kMagnitudeChunk, noPixels - begin));
+    }, workers);
+    return std::sqrt(*std::max_element(peaks.begin(), peaks.end()));
+}
 
-    QVector<QImage> imageList;
-    if (slices == 1) {
-        // T1
-        for (int i = 0; i < noImages; i++) {
-            QImage img(shape[2], shape[0], QImage::Format_Grayscale8);
-            for (int j = 0; j < shape[0]; j++) {
-                std::vector<int> indexes = {j, i, 0};
-                uchar *scanLine = img.scanLine(j);
-                for (int k = 0; k < shape[2]; k++) {
-                    indexes[2] = k;
-                    auto index = fftw_utils::getIndex(shape, indexes);
-                    double val = absValues[index];
-                    scanLine[k] = static_cast<uchar>(val * 255 / max_val);
+template <typename Real>
+QVector<QImage> BasicMrd<Real>::magnitudeImages(const fftw_utils::Complex<Real> *volume, Real peak,
+                                                const image_utils::Window *window) const {
+    // Pass 1: peak magnitude, unless the caller fixed the scale
+    const size_t noPixels = size();
+    if (noPixels == 0) {
+        return {};
+    }
+    const int workers = noPixels < kMagnitudeParallelMin ? 1 : 0;
+    Real max_val = peak > 0 ? peak : maxMagnitude(volume);
+    Real scale = max_val > 0 ? Real(65535) / max_val : Real(0);
+
+    // Each partition of each block is an image, rows run over views and columns over samples.
+    // Images are allocated up front, bits() detaches and must not run on the workers.
+    // An oversampled readout only shows the central field of view.
+    const int partitions = views2;
+    const int width = Acquisition::fromPpr(ppr).fieldOfViewSamples(samples);
+    const int firstSample = (samples - width) / 2;
+    QVector<QImage> imageList(transforms() * partitions);
+    std::vector<uchar *> bits(imageList.size());
+    for (int i = 0; i < imageList.size(); i++) {
+        imageList[i] = QImage(width, views, QImage::Format_Grayscale16);
+        bits[i] = imageList[i].bits();
+    }
+    const qsizetype bytesPerLine = imageList.front().bytesPerLine();
+
+    // Pass 2: magnitude, scale and quantize each row straight into its scanline and count it
+    // while it is in cache. Images are dealt round robin to groups, one histogram per group.
+    const int images = static_cast<int>(imageList.size());
+    const int groups = std::min(images, workers > 0 ? workers : parallel_utils::maxThreads());
+    std::vector<image_utils::Histogram> histograms(groups, image_utils::emptyHistogram());
+    parallel_utils::parallelFor(0, groups, [&](int group) {
+        for (int image = group; image < images; image += groups) {
+            auto block = volume + static_cast<size_t>(image / partitions) * views * views2 * samples;
+            auto partition = image % partitions;
+            for (int j = 0; j < views; j++) {
+                auto row = block + (static_cast<size_t>(j) * views2 + partition) * samples + firstSample;
+                auto pixels = reinterpret_cast<quint16 *>(bits[image] + j * bytesPerLine);
+                simd_utils::magnitudeToGray16(row, pixels, width, scale);
+                if (!window) {
+                    image_utils::accumulate(histograms[group], pixels, width);
                 }
             }
-            imageList.push_back(img);
         }
-    } else {
-        // T2
-        for (int i = 0; i < noImages; i++) {
-            QImage img(shape[2], shape[1], QImage::Format_Grayscale8);
-            for (int j = 0; j < shape[1]; j++) {
-                std::vector<int> indexes = {i, j, 0};
-                uchar *scanLine = img.scanLine(j);
-                for (int k = 0; k < shape[2]; k++) {
-                    indexes[2] = k;
-                    auto index = fftw_utils::getIndex(shape, indexes);
-                    double val = absValues[index];
-                    scanLine[k] = static_cast<uchar>(val * 255 / max_val);
-                }
-            }
-            imageList.push_back(img);
+    }, groups);
+
+    // The default window covers the whole volume so every image of it looks alike
+    image_utils::Window autoWindow;
+    if (!window) {
+        for (int group = 1; group < groups; group++) {
+            image_utils::merge(histograms[0], histograms[group]);
         }
+        autoWindow = image_utils::autoWindow(histograms[0]);
+        window = &autoWindow;
+    }
+    for (auto &image : imageList) {
+        image_utils::setWindow(image, *window);
     }
 
     return imageList;
 }
 
-Mrd::Mrd() {}
+template <typename Real>
+BasicMrd<Real>::BasicMrd() {}
 
-Mrd::~Mrd() {
+template <typename Real>
+BasicMrd<Real>::~BasicMrd() {
 }
 
-Mrd::Mrd(const Mrd &other)
-    : experiments(other.experiments), echoes(other.echoes),
-    slices(other.slices), views(other.views), views2(other.views2),
-    samples(other.samples) {
-    if (!other.kdata.get()) {
-        return;
+template <typename Real>
+fftw_utils::Complex<Real> *BasicMrd<Real>::detach() {
+    if (!kdata) {
+        return nullptr;
     }
 
-    auto num_elements = other.size();
-    if (num_elements == 0) return;
-
-    kdata = fftw_utils::createArray(num_elements);
-    memcpy(kdata.get(), other.kdata.get(), num_elements * sizeof(fftw_complex));
-}
-
-Mrd &Mrd::operator=(const Mrd &other) {
-    if (this == &other) {
-        return *this;
+    if (kdata.use_count() > 1) {
+        auto num_elements = size();
+        auto copy = fftw_utils::createArray<Real>(num_elements);
+        memcpy(copy.get(), kdata.get(), num_elements * sizeof(fftw_utils::Complex<Real>));
+        kdata = std::move(copy);
     }
-
-    Mrd temp(other);
-    swap(temp);
-    return *this;
+    // The buffer is only referenced by this Mrd now
+    return const_cast<fftw_utils::Complex<Real> *>(kdata.get());
 }
 
-Mrd::Mrd(Mrd &&other) noexcept
+template <typename Real>
+BasicMrd<Real>::BasicMrd(BasicMrd &&other) noexcept
     : kdata(nullptr), experiments(0), echoes(0), slices(0), views(0), views2(0),
     samples(0) {
     swap(other);
 }
 
-Mrd &Mrd::operator=(Mrd &&other) noexcept {
+template <typename Real>
+BasicMrd<Real> &BasicMrd<Real>::operator=(BasicMrd &&other) noexcept {
     swap(other);
 
     return *this;
 }
 
-void Mrd::swap(Mrd &other) noexcept {
+template <typename Real>
+void BasicMrd<Real>::swap(BasicMrd &other) noexcept {
     using std::swap;
 
     swap(kdata, other.kdata);
@@ -206,108 +409,239 @@ void Mrd::swap(Mrd &other) noexcept {
     swap(views, other.views);
     swap(views2, other.views2);
     swap(samples, other.samples);
+    swap(ppr, other.ppr);
+    swap(centred, other.centred);
+    swap(transformed, other.transformed);
 }
 
-/**
- * @brief Mrd::fromBytes
- * @param bytes
- * @return
- * @ref https://github.com/hongmingjian/mrscan/blob/master/smisscanner.py#L34
- * function: SmisScanner.parseMrd
- */
-QVector<Mrd> Mrd::fromBytes(const QByteArray &bytes) {
-    if (bytes.size() < 512) {
-        LOG_ERROR(QString("Received MRD file with length %1, minimum length should be 512")
-                      .arg(bytes.size()));
+template <typename Real>
+QVector<BasicMrd<Real>> BasicMrd<Real>::fromBytes(const QByteArray &bytes) {
+    auto view = MrdView::fromBytes(bytes);
+    if (!view) {
         return {};
     }
+    return fromView(*view);
+}
 
-    auto rawData = bytes.constData();
+template <typename Real>
+QVector<BasicMrd<Real>> BasicMrd<Real>::fromView(const MrdView &view, int workers) {
+    const auto &header = view.header();
 
-    // Parse header
-    auto samples = readInt32<qint32>(rawData + 0);
-    auto views = readInt32<qint32>(rawData + 4);
-    auto views2 = readInt32<qint32>(rawData + 8);
-    auto slices = readInt32<qint32>(rawData + 12);
-    // 16-18 Unspecified
-    auto datatype = readInt32<qint16>(rawData + 18);
-    // 20-152 Unspecified
-    auto echoes = readInt32<qint32>(rawData + 152);
-    auto experiments = readInt32<qint32>(rawData + 156);
+    QVector<BasicMrd> results;
+    const auto positions = Acquisition::fromPpr(view.ppr()).viewPositions(header.views);
+    for (auto &k_ptr : readKdatas<Real>(view, workers)) {
+        if (!positions.isEmpty()) {
+            reorderViews<Real>(k_ptr.get(), header.elements(), header.views,
+                               static_cast<size_t>(header.views2) * header.samples, positions, false);
+        }
+        BasicMrd m;
+        m.samples = header.samples;
+        m.views = header.views;
+        m.views2 = header.views2;
+        m.slices = header.slices;
+        m.echoes = header.echoes;
+        m.experiments = header.experiments;
+        m.ppr = view.ppr();
+        m.kdata = std::move(k_ptr);
+        results.push_back(std::move(m));
+    }
 
-    int nele = experiments * echoes * slices * views * views2 * samples;
+    return results;
+}
 
-    // Extract data section
-    const int kdataOffset = 512;
-    auto posPPR = bytes.lastIndexOf('\x00');
-    if (posPPR < 0) {
-        LOG_ERROR("Invalid MRD file");
-        return {};
+template <typename Real>
+BasicMrd<Real> BasicMrd<Real>::fromChannel(const MrdView &view, int channel) {
+    return fromKspace(view.header(), view.channel(channel), view.ppr());
+}
+
+template <typename Real>
+BasicMrd<Real> BasicMrd<Real>::fromKspace(const MrdHeader &header, const KspaceView &kspace,
+                                          const Ppr &ppr, bool centre) {
+    BasicMrd m;
+    if (!kspace.data || kspace.elements == 0) {
+        LOG_ERROR("MRD file data error: kdataSize is zero");
+        return m;
     }
-    int totalSize = posPPR + 1 - kdataOffset - 120;
-    if (totalSize < 0) {
-        LOG_ERROR("Invalid totalSize calculated for Mrd data.");
-        return {};
+    auto data = fftw_utils::createArray<Real>(kspace.elements);
+    if (!decodeKspaceInto<Real>(header, kspace, ppr, centre, data.get(), &m.centred)) {
+        return m;
     }
+    m.kdata = std::move(data);
+    m.samples = header.samples;
+    m.views = header.views;
+    m.views2 = header.views2;
+    m.slices = header.slices;
+    m.echoes = header.echoes;
+    m.experiments = header.experiments;
+    m.ppr = ppr;
+    return m;
+}
 
-    // Parse data section
-    std::vector<fftw_utils::fftw_complex_ptr> kdatas_ptr_vec;
-    bool isComplex = datatype & 0x10;
-    switch (datatype & 0xf) {
-    case 0:
-        kdatas_ptr_vec =
-            readKdatas<quint8>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 1:
-        kdatas_ptr_vec =
-            readKdatas<qint8>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 2:
-        kdatas_ptr_vec =
-            readKdatas<quint16>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 3:
-        kdatas_ptr_vec =
-            readKdatas<qint16>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 4:
-        kdatas_ptr_vec =
-            readKdatas<quint32>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 5:
-        kdatas_ptr_vec =
-            readKdatas<qint32>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 6:
-        kdatas_ptr_vec =
-            readKdatas<float>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    case 7:
-        kdatas_ptr_vec =
-            readKdatas<double>(rawData + kdataOffset, nele, isComplex, totalSize);
-        break;
-    default:
-        LOG_ERROR(QString("Unknown datatype: %1").arg(datatype));
-        return {};
+template <typename Real>
+bool decodeKspaceInto(const MrdHeader &header, const KspaceView &kspace, const Ppr &ppr,
+                      bool centre, fftw_utils::Complex<Real> *dst, bool *centred) {
+    *centred = false;
+    auto volume = volumeShape(header.views, header.views2, header.samples);
+    if (centre && canCentre(volume) && kspace.data && kspace.elements > 0) {
+        *centred = decodeCentredInto<Real>(kspace, volume, dst);
     }
+    if (!*centred && !decodeInto<Real>(kspace, dst)) {
+        return false;
+    }
+    // Sequences with a view table acquire the views out of k-space order
+    const auto positions = Acquisition::fromPpr(ppr).viewPositions(header.views);
+    if (!positions.isEmpty()) {
+        reorderViews<Real>(dst, kspace.elements, header.views,
+                           static_cast<size_t>(header.views2) * header.samples, positions,
+                           *centred);
+    }
+    return true;
+}
 
-    QVector<Mrd> results;
-    for (auto &k_ptr : kdatas_ptr_vec) {
-        Mrd m;
-        m.samples = samples;
-        m.views = views;
-        m.views2 = views2;
-        m.slices = slices;
-        m.echoes = echoes;
-        m.experiments = experiments;
-        m.kdata = std::move(k_ptr);
-        results.push_back(std::move(m));
+template <typename Real>
+fftw_utils::complex_ptr<Real> decode(const KspaceView &kspace) {
+    if (!kspace.data || kspace.elements == 0) {
+        LOG_ERROR("MRD file data error: kdataSize is zero");
+        return nullptr;
     }
 
-    return results;
+    auto kdata_ptr = fftw_utils::createArray<Real>(kspace.elements);
+    if (!decodeInto<Real>(kspace, kdata_ptr.get())) {
+        return nullptr;
+    }
+    return kdata_ptr;
+}
+
+template <typename Real>
+bool decodeInto(const KspaceView &kspace, fftw_utils::Complex<Real> *dst) {
+    return decodeKdata<Real>(kspace, dst, nullptr);
+}
+
+template <typename Real>
+bool decodeCentredInto(const KspaceView &kspace, const std::vector<int> &volume,
+                       fftw_utils::Complex<Real> *dst) {
+    if (!canCentre(volume)) {
+        LOG_ERROR("Volume shape can not be centred by modulation");
+        return false;
+    }
+    size_t volumeElements = static_cast<size_t>(volume[0]) * volume[1] * volume[2];
+    if (kspace.elements % volumeElements != 0) {
+        LOG_ERROR("MRD file data error: k-space is not a whole number of volumes");
+        return false;
+    }
+    return decodeKdata<Real>(kspace, dst, &volume);
 }
 
-void swap(Mrd &lhs, Mrd &rhs) noexcept { lhs.swap(rhs); }
+std::vector<int> volumeShape(int views, int views2, int samples) {
+    return {views, views2, samples};
+}
+
+bool canCentre(const std::vector<int> &volume) {
+    if (volume.size() != 3) {
+        return false;
+    }
+    for (auto n : volume) {
+        if (n <= 0 || (n != 1 && n % 2 != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template struct BasicMrd<double>;
+template struct BasicMrd<float>;
+template fftw_utils::complex_ptr<double> decode<double>(const KspaceView &kspace);
+template fftw_utils::complex_ptr<float> decode<float>(const KspaceView &kspace);
+template bool decodeInto<double>(const KspaceView &kspace, fftw_complex *dst);
+template bool decodeInto<float>(const KspaceView &kspace, fftwf_complex *dst);
+template bool decodeKspaceInto<double>(const MrdHeader &header, const KspaceView &kspace,
+                                       const Ppr &ppr, bool centre, fftw_complex *dst,
+                                       bool *centred);
+template bool decodeKspaceInto<float>(const MrdHeader &header, const KspaceView &kspace,
+                                      const Ppr &ppr, bool centre, fftwf_complex *dst,
+                                      bool *centred);
+template bool decodeCentredInto<double>(const KspaceView &kspace, const std::vector<int> &volume,
+                                        fftw_complex *dst);
+template bool decodeCentredInto<float>(const KspaceView &kspace, const std::vector<int> &volume,
+                                       fftwf_complex *dst);
+
+qint64 MrdInfo::decodedSize(bool singlePrecision) const {
+    auto sampleSize = singlePrecision ? sizeof(fftwf_complex) : sizeof(fftw_complex);
+    return static_cast<qint64>(channels) * static_cast<qint64>(header.elements()) *
+           static_cast<qint64>(sampleSize);
+}
+
+MrdInfo probe(const QString &path) {
+    MrdInfo info;
+    auto fail = [&info, &path](const QString &error) {
+        info.error = error;
+        LOG_WARNING(QString("Probe %1 failed: %2").arg(path, error));
+        return info;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+
+    info.fileSize = file.size();
+    if (info.fileSize < kHeaderSize) {
+        return fail(QString("Received MRD file with length %1, minimum length should be 512")
+                        .arg(info.fileSize));
+    }
+
+    auto headerBytes = file.read(kHeaderSize);
+    if (headerBytes.size() != kHeaderSize) {
+        return fail(file.errorString());
+    }
+    info.header = MrdHeader::parse(headerBytes.constData());
+    if (info.header.sampleSize() == 0) {
+        return fail(QString("Unknown datatype: %1").arg(info.header.datatype));
+    }
+
+    // Search the tail backwards chunk by chunk, the PPR text follows the last '\0'
+    const qint64 kChunkSize = 64 * 1024;
+    const qint64 scanStart = std::max(kHeaderSize, info.fileSize - kMaxFooterScan);
+    QByteArray tail;
+    qint64 posPPR = -1;
+    for (qint64 end = info.fileSize; end > scanStart && posPPR < 0;) {
+        qint64 begin = std::max(scanStart, end - kChunkSize);
+        if (!file.seek(begin)) {
+            return fail(file.errorString());
+        }
+        auto chunk = file.read(end - begin);
+        if (chunk.size() != end - begin) {
+            return fail(file.errorString());
+        }
+
+        auto pos = chunk.lastIndexOf('\x00');
+        if (pos >= 0) {
+            posPPR = begin + pos;
+        }
+        tail.prepend(chunk);
+        end = begin;
+    }
+    if (posPPR < 0) {
+        return fail("Invalid MRD file");
+    }
+    info.ppr = Ppr::parse(tail.right(info.fileSize - posPPR - 1));
+
+    info.payloadSize = posPPR + 1 - kHeaderSize - kFooterBlockSize;
+    if (info.payloadSize < 0) {
+        return fail("Invalid totalSize calculated for Mrd data.");
+    }
+    auto kdataSize = info.header.channelBytes();
+    if (kdataSize == 0) {
+        return fail("MRD file data error: kdataSize is zero");
+    }
+    if (info.payloadSize % kdataSize != 0) {
+        return fail("MRD file data error");
+    }
+
+    info.channels = static_cast<int>(info.payloadSize / kdataSize);
+    info.valid = true;
+    return info;
+}
 
 QStringList getAllChannelsFile(const QString& path) {
     QFileInfo fileInfo(path);
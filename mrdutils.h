@@ -3,34 +3,217 @@
 
 #include <QImage>
 #include <QVector>
+#include "imageutils.h"
+#include "mrdview.h"
+#include "ndarray.h"
 #include "utils.h"
 
 namespace mrd_utils {
-struct Mrd {
-    fftw_utils::fftw_complex_ptr kdata = nullptr;
+/**
+ * @brief 单通道的k空间数据
+ * @tparam Real double使用fftw，float使用fftwf，单精度内存和FFT耗时约减半
+ * @details kdata is immutable and shared by copies, a stage that modifies k-space
+ * calls detach() which copies the buffer only if another Mrd still refers to it.
+ */
+template <typename Real>
+struct BasicMrd {
+    /// [experiments][echoes][slices][views][views2][samples]
+    using Kspace = nd_utils::NdArray<const fftw_utils::Complex<Real>, 6>;
+    /// [blocks][views][views2][samples], a block is one (experiment, echo, slice)
+    using Volumes = nd_utils::NdArray<const fftw_utils::Complex<Real>, 4>;
+    using MutableVolumes = nd_utils::NdArray<fftw_utils::Complex<Real>, 4>;
+    using Buffer = std::shared_ptr<const fftw_utils::Complex<Real>[]>;
+
+    Buffer kdata = nullptr;
     int experiments = 0;
     int echoes = 0;
     int slices = 0;
     int views = 0;
     int views2 = 0;
     int samples = 0;
+    /// Acquisition parameters from the file footer
+    Ppr ppr;
+    /**
+     * @brief kdata was decoded with decodeCentredInto, its FFT is already fftshift-ed
+     * @details Sample (x, y, z) of every block carries a factor (-1)^(x+y+z)
+     */
+    bool centred = false;
+    /**
+     * @brief kdata holds the centred complex images of every block instead of k-space
+     * @details Set by transform(), images() and takeImages() then only quantize
+     */
+    bool transformed = false;
 
     QVector<int> shape() const;
+    /// Strided read-only view of kdata, shares the buffer, empty if there is no data
+    Kspace kspace() const;
+    /// kspace() with the blocks flattened, what the per block stages iterate over
+    Volumes volumes() const;
+    /**
+     * @brief Writable k-space, copy on write
+     * @return kdata after making it unique to this Mrd, nullptr if there is no data
+     */
+    fftw_utils::Complex<Real> *detach();
+    /**
+     * @brief detach() seen as volumes(), empty if there is no data
+     * @details The view borrows kdata, a Volumes sharing the buffer would make every later
+     * detach() copy it. It stays valid as long as kdata is not replaced.
+     */
+    MutableVolumes detachVolumes();
     size_t size() const;
+    /**
+     * @brief Reconstruct into a separate buffer, kdata is kept
+     * @details Every (experiment, echo, slice) block is transformed by one batched plan, 3D
+     * encodes give views2 images per block and 2D multi-slice data one image per block.
+     * Images are QImage::Format_Grayscale16 magnitudes with the peak of the channel at 65535
+     * and carry an auto window (image_utils::window), use image_utils::toDisplay to show them.
+     */
     QVector<QImage> images()const;
+    /**
+     * @brief Reconstruct in the k-space buffer itself, peak memory is one volume
+     * @details kdata is released afterwards, use it when the raw k-space is no longer needed
+     */
+    QVector<QImage> takeImages();
+    /**
+     * @brief takeImages() on a fixed scale, for a channel whose blocks are reconstructed one by one
+     * @param peak Magnitude mapped to 65535, brighter pixels saturate, <= 0 uses the peak of this Mrd
+     * @param window Window stored in every image, nullptr stores the auto window of these images
+     */
+    QVector<QImage> takeImages(Real peak, const image_utils::Window *window = nullptr);
+    /// Largest magnitude after transform(), 0 if there is no data
+    Real peakMagnitude();
+    /**
+     * @brief FFT and centre kdata in place, copy on write, for stages working on complex images
+     * @return false if there is no data or the FFT failed, true if already transformed
+     */
+    bool transform();
 
-    Mrd();
-    ~Mrd();
-    Mrd(const Mrd &other);
-    Mrd &operator=(const Mrd &other);
-    Mrd(Mrd &&other) noexcept;
-    Mrd &operator=(Mrd &&other) noexcept;
-    void swap(Mrd &other) noexcept;
+    BasicMrd();
+    ~BasicMrd();
+    /// Copies share kdata
+    BasicMrd(const BasicMrd &other) = default;
+    BasicMrd &operator=(const BasicMrd &other) = default;
+    BasicMrd(BasicMrd &&other) noexcept;
+    BasicMrd &operator=(BasicMrd &&other) noexcept;
+    void swap(BasicMrd &other) noexcept;
 
-    static QVector<Mrd> fromBytes(const QByteArray &bytes);
+    static QVector<BasicMrd> fromBytes(const QByteArray &bytes);
+    /**
+     * @brief Decode every channel of the view, channels are decoded in parallel
+     * @param workers Number of decode threads, <= 0 means parallel_utils::maxThreads()
+     */
+    static QVector<BasicMrd> fromView(const MrdView &view, int workers = 0);
+    /// Decode a single channel, kdata is null on failure
+    static BasicMrd fromChannel(const MrdView &view, int channel);
+    /**
+     * @brief Decode one channel laid out as described by header, kdata is null on failure
+     * @param centre Modulate the k-space while decoding so images() needs no fftshift,
+     * ignored if the volume shape does not allow it (see canCentre)
+     */
+    static BasicMrd fromKspace(const MrdHeader &header, const KspaceView &kspace,
+                               const Ppr &ppr = Ppr(), bool centre = false);
+
+private:
+    /// {views, views2, samples} for 3D encodes (views2 > 1), {views, samples} for 2D multi-slice
+    std::vector<int> transformShape() const;
+    /// Number of transforms batched into one plan, one per experiment, echo and slice
+    int transforms() const;
+    /**
+     * @brief Take the magnitude, quantize and window all transformed and centred blocks
+     * @param peak Magnitude mapped to 65535, <= 0 uses the peak of volume
+     * @param window Window of every image, nullptr computes it from their histogram
+     */
+    QVector<QImage> magnitudeImages(const fftw_utils::Complex<Real> *volume, Real peak = 0,
+                                    const image_utils::Window *window = nullptr) const;
+    Real maxMagnitude(const fftw_utils::Complex<Real> *volume) const;
 };
 
-void swap(Mrd &lhs, Mrd &rhs) noexcept;
+extern template struct BasicMrd<double>;
+extern template struct BasicMrd<float>;
+
+using Mrd = BasicMrd<double>;
+using MrdF = BasicMrd<float>;
+
+template <typename Real>
+void swap(BasicMrd<Real> &lhs, BasicMrd<Real> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+/**
+ * @brief 将单通道的原始采样转换为fftw_complex(Real为float时为fftwf_complex)
+ * @return 转换失败时返回nullptr
+ */
+template <typename Real = double>
+fftw_utils::complex_ptr<Real> decode(const KspaceView &kspace);
+
+/**
+ * @brief 将单通道的原始采样转换到已分配的缓冲区
+ * @param dst 至少kspace.elements个元素
+ * @return 数据类型未知或kspace为空时返回false
+ */
+template <typename Real = double>
+bool decodeInto(const KspaceView &kspace, fftw_utils::Complex<Real> *dst);
+
+/**
+ * @brief What BasicMrd::fromKspace() decodes, into a buffer the caller owns
+ * @param dst At least kspace.elements samples
+ * @param centred Set to whether dst was centred, see BasicMrd::centred
+ * @return false if the samples could not be decoded
+ */
+template <typename Real = double>
+bool decodeKspaceInto(const MrdHeader &header, const KspaceView &kspace, const Ppr &ppr,
+                      bool centre, fftw_utils::Complex<Real> *dst, bool *centred);
+
+/**
+ * @brief Shape of one (experiment, echo, slice) block of k-space
+ * @details Blocks are transformed independently, in 3D if views2 > 1 and per slice in 2D otherwise
+ */
+std::vector<int> volumeShape(int views, int views2, int samples);
+
+/**
+ * @brief Whether modulating by (-1)^(x+y+z) reproduces fftshift exactly
+ * @details True if every dimension is even or 1, fftshift of odd lengths is not a half period
+ */
+bool canCentre(const std::vector<int> &volume);
+
+/**
+ * @brief decodeInto, multiplying sample (x, y, z) of every volume by (-1)^(x+y+z)
+ * @details The FFT of the result equals fftshift of the FFT of the raw samples. The sign
+ * is applied to each row right after its conversion while it is still in cache, so there
+ * is no extra pass over the volume.
+ * @param volume Shape of one block, see volumeShape()
+ * @return false if canCentre(volume) does not hold or decodeInto would fail
+ */
+template <typename Real = double>
+bool decodeCentredInto(const KspaceView &kspace, const std::vector<int> &volume,
+                       fftw_utils::Complex<Real> *dst);
+
+/**
+ * @brief Metadata of an MRD file obtained without reading its k-space
+ */
+struct MrdInfo {
+    bool valid = false;
+    QString error;
+
+    MrdHeader header;
+    qint64 fileSize = 0;
+    /// Size of the k-space section between the header and the footer
+    qint64 payloadSize = 0;
+    int channels = 0;
+    /// Acquisition parameters following the footer block
+    Ppr ppr;
+
+    /// Size the payload must have for the header and channel count
+    qint64 expectedPayloadSize() const { return channels * header.channelBytes(); }
+    /// Memory needed to decode every channel, sizeof(fftwf_complex) per sample for single precision
+    qint64 decodedSize(bool singlePrecision = false) const;
+};
+
+/**
+ * @brief 只读取文件头和末尾的PPR文本，不读取k空间数据
+ * @details 末尾按固定大小分块向前查找PPR，最多扫描kMaxFooterScan字节
+ */
+MrdInfo probe(const QString &path);
 
 /**
  * @brief 获取同文件夹下所有通道的文件
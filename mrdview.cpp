@@ -0,0 +1,190 @@
+#include "mrdview.h"
+
+#include <QtEndian>
+#include <algorithm>
+
+#include "utils.h"
+
+namespace {
+
+template <typename T>
+/// 从指针中读取指定长度的整数，并转为int类型
+int readInt32(const char *ptr) {
+    return static_cast<int>(qFromLittleEndian<T>(ptr));
+}
+
+int sizeOfDatatype(int datatype) {
+    switch (datatype & 0xf) {
+    case 0:
+    case 1:
+        return 1;
+    case 2:
+    case 3:
+        return 2;
+    case 4:
+    case 5:
+    case 6:
+        return 4;
+    case 7:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+namespace mrd_utils {
+
+int MrdHeader::sampleSize() const { return sizeOfDatatype(datatype); }
+
+size_t MrdHeader::elements() const {
+    if (experiments <= 0 || echoes <= 0 || slices <= 0 || views <= 0 ||
+        views2 <= 0 || samples <= 0) {
+        return 0;
+    }
+
+    return static_cast<size_t>(experiments) * static_cast<size_t>(echoes) *
+           static_cast<size_t>(slices) * static_cast<size_t>(views) *
+           static_cast<size_t>(views2) * static_cast<size_t>(samples);
+}
+
+qint64 MrdHeader::channelBytes() const {
+    return static_cast<qint64>(elements()) * sampleSize() * (isComplex() ? 2 : 1);
+}
+
+/**
+ * @ref https://github.com/hongmingjian/mrscan/blob/master/smisscanner.py#L34
+ * function: SmisScanner.parseMrd
+ */
+MrdHeader MrdHeader::parse(const char *data) {
+    MrdHeader header;
+    header.samples = readInt32<qint32>(data + 0);
+    header.views = readInt32<qint32>(data + 4);
+    header.views2 = readInt32<qint32>(data + 8);
+    header.slices = readInt32<qint32>(data + 12);
+    // 16-18 Unspecified
+    header.datatype = readInt32<qint16>(data + 18);
+    // 20-152 Unspecified
+    header.echoes = readInt32<qint32>(data + 152);
+    header.experiments = readInt32<qint32>(data + 156);
+    return header;
+}
+
+KspaceView MrdHeader::channel(const char *kdata, int index) const {
+    KspaceView view;
+    view.data = kdata + index * channelBytes();
+    view.datatype = datatype;
+    view.elements = elements();
+    return view;
+}
+
+int KspaceView::sampleSize() const { return sizeOfDatatype(datatype); }
+
+qint64 findFooter(const char *data, qint64 size) {
+    const qint64 scanStart = std::max<qint64>(0, size - kMaxFooterScan);
+    for (qint64 pos = size - 1; pos >= scanStart; pos--) {
+        if (data[pos] == '\x00') {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+MrdView::~MrdView() {}
+
+std::shared_ptr<MrdView> MrdView::open(const QString &path) {
+    std::shared_ptr<MrdView> view(new MrdView);
+
+    view->m_file = std::make_unique<QFile>(path);
+    auto &file = *view->m_file;
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR(QString("Failed to open file:%1 Error: %2").arg(path, file.errorString()));
+        return nullptr;
+    }
+
+    view->m_size = file.size();
+    if (view->m_size > 0) {
+        // The mapping stays valid as long as m_file is alive
+        view->m_data = reinterpret_cast<const char *>(file.map(0, view->m_size));
+        if (!view->m_data) {
+            LOG_ERROR(QString("Failed to map file:%1 Error: %2").arg(path, file.errorString()));
+            return nullptr;
+        }
+    }
+
+    if (!view->parse()) {
+        return nullptr;
+    }
+    return view;
+}
+
+std::shared_ptr<MrdView> MrdView::fromBytes(const QByteArray &bytes) {
+    std::shared_ptr<MrdView> view(new MrdView);
+    view->m_bytes = bytes;
+    view->m_data = view->m_bytes.constData();
+    view->m_size = view->m_bytes.size();
+
+    if (!view->parse()) {
+        return nullptr;
+    }
+    return view;
+}
+
+KspaceView MrdView::channel(int index) const {
+    if (index < 0 || index >= m_channels) {
+        LOG_ERROR(QString("Channel index %1 out of range, channels: %2").arg(index).arg(m_channels));
+        return {};
+    }
+
+    return m_header.channel(m_data + kHeaderSize, index);
+}
+
+QByteArray MrdView::bytes() const {
+    if (m_file) {
+        return QByteArray::fromRawData(m_data, m_size);
+    }
+    return m_bytes;
+}
+
+bool MrdView::parse() {
+    if (m_size < kHeaderSize) {
+        LOG_ERROR(QString("Received MRD file with length %1, minimum length should be 512")
+                      .arg(m_size));
+        return false;
+    }
+
+    m_header = MrdHeader::parse(m_data);
+    if (m_header.sampleSize() == 0) {
+        LOG_ERROR(QString("Unknown datatype: %1").arg(m_header.datatype));
+        return false;
+    }
+
+    // Extract data section, the PPR text follows the last '\0'
+    qint64 posPPR = findFooter(m_data, m_size);
+    if (posPPR < 0) {
+        LOG_ERROR("Invalid MRD file");
+        return false;
+    }
+    m_ppr = Ppr::parse(QByteArray::fromRawData(m_data + posPPR + 1, m_size - posPPR - 1));
+    qint64 totalSize = posPPR + 1 - kHeaderSize - kFooterBlockSize;
+    if (totalSize < 0) {
+        LOG_ERROR("Invalid totalSize calculated for Mrd data.");
+        return false;
+    }
+
+    auto kdataSize = m_header.channelBytes();
+    if (kdataSize == 0) {
+        LOG_ERROR("MRD file data error: kdataSize is zero");
+        return false;
+    }
+    if (totalSize % kdataSize != 0) {
+        LOG_ERROR("MRD file data error");
+        return false;
+    }
+
+    m_channels = static_cast<int>(totalSize / kdataSize);
+    return true;
+}
+
+} // namespace mrd_utils
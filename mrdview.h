@@ -0,0 +1,129 @@
+#ifndef MRDVIEW_H
+#define MRDVIEW_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <memory>
+
+#include "ppr.h"
+
+namespace mrd_utils {
+
+/// Size of the fixed MRD file header
+constexpr qint64 kHeaderSize = 512;
+/// Size of the block between the end of k-space and the PPR text
+constexpr qint64 kFooterBlockSize = 120;
+/// Largest tail searched for the PPR footer
+constexpr qint64 kMaxFooterScan = 1024 * 1024;
+
+struct KspaceView;
+
+/**
+ * @brief MRD文件头(前512字节)中与数据布局相关的字段
+ */
+struct MrdHeader {
+    int samples = 0;
+    int views = 0;
+    int views2 = 0;
+    int slices = 0;
+    int echoes = 0;
+    int experiments = 0;
+    int datatype = 0;
+
+    bool isComplex() const { return datatype & 0x10; }
+
+    /// Size in bytes of one scalar of the stored datatype, 0 if the datatype is unknown
+    int sampleSize() const;
+
+    /// Number of (complex or real) samples in one channel
+    size_t elements() const;
+
+    /// Size in bytes of one channel's k-space
+    qint64 channelBytes() const;
+
+    /// @param data Points to at least kHeaderSize bytes
+    static MrdHeader parse(const char *data);
+
+    /// View of the index-th channel, kdata points to the start of the k-space section
+    KspaceView channel(const char *kdata, int index) const;
+
+    bool operator==(const MrdHeader &other) const = default;
+};
+
+/**
+ * @brief 单通道k空间的只读视图，直接指向文件数据，不做拷贝
+ * @details 第i个采样点位于 data + i * stride()，复数时实部在前、虚部在后
+ */
+struct KspaceView {
+    const char *data = nullptr;
+    int datatype = 0;
+    size_t elements = 0;
+
+    bool isComplex() const { return datatype & 0x10; }
+    int sampleSize() const;
+
+    /// Distance in bytes between two consecutive samples
+    qsizetype stride() const { return sampleSize() * (isComplex() ? 2 : 1); }
+
+    /// Reinterpret the raw samples as the stored scalar type
+    template <typename T>
+    const T *as() const {
+        return reinterpret_cast<const T *>(data);
+    }
+};
+
+/**
+ * @brief 在末尾kMaxFooterScan字节内向前查找最后一个'\0'，其后为PPR文本
+ * @param data Complete file contents
+ * @return Offset of the last '\0', -1 if there is none in the scanned tail
+ */
+qint64 findFooter(const char *data, qint64 size);
+
+/**
+ * @brief Read-only view of an MRD file, backed by a memory mapping or a shared QByteArray
+ * @details The header and the PPR footer are located in place, k-space is never copied.
+ * Conversion to fftw_complex happens only when Mrd::fromView or Mrd::fromChannel is called.
+ */
+class MrdView {
+public:
+    ~MrdView();
+    MrdView(const MrdView &) = delete;
+    MrdView &operator=(const MrdView &) = delete;
+
+    /// Map the file into memory, returns nullptr if the file can not be mapped or is invalid
+    static std::shared_ptr<MrdView> open(const QString &path);
+    /// Wrap bytes already in memory, QByteArray is implicitly shared so nothing is copied
+    static std::shared_ptr<MrdView> fromBytes(const QByteArray &bytes);
+
+    const MrdHeader &header() const { return m_header; }
+    const Ppr &ppr() const { return m_ppr; }
+    int channels() const { return m_channels; }
+    KspaceView channel(int index) const;
+
+    const char *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+    /**
+     * @brief Raw file contents
+     * @note For a mapped file the returned array refers to the mapping, it must not outlive this view
+     */
+    QByteArray bytes() const;
+
+private:
+    MrdView() = default;
+    bool parse();
+
+    std::unique_ptr<QFile> m_file;
+    QByteArray m_bytes;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+
+    MrdHeader m_header;
+    Ppr m_ppr;
+    int m_channels = 0;
+};
+
+} // namespace mrd_utils
+
+#endif // MRDVIEW_H
@@ -0,0 +1,218 @@
+#ifndef NDARRAY_H
+#define NDARRAY_H
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * @brief Strided N-dimensional arrays for the reconstruction code
+ * @details Header only and free of Qt so it can be used by plain C++ code, like fftw_utils
+ */
+namespace nd_utils {
+
+/// Alignment of owned storage, enough for AVX-512 and for FFTW's SIMD plans
+constexpr size_t kAlignment = 64;
+
+/// Uninitialized storage for count elements of T aligned to kAlignment
+template <typename T>
+std::shared_ptr<void> allocateAligned(size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>, "NdArray storage is never constructed");
+    if (count == 0) {
+        return nullptr;
+    }
+    auto ptr = ::operator new(count * sizeof(T), std::align_val_t{kAlignment});
+    return std::shared_ptr<void>(ptr, [](void *p) { ::operator delete(p, std::align_val_t{kAlignment}); });
+}
+
+/**
+ * @class NdArray
+ * @brief Shape + strides over a shared buffer, sub-views never copy
+ * @tparam T Trivially copyable element type, fftw_complex is fine
+ * @details An NdArray behaves like a shared pointer: copies and views (slice, range,
+ * permute, reshape) refer to the same elements and keep the buffer alive. Use copy()
+ * for an independent contiguous array. Strides are counted in elements.
+ */
+template <typename T, size_t Rank>
+class NdArray {
+    static_assert(Rank > 0, "NdArray needs at least one dimension");
+
+public:
+    using Shape = std::array<size_t, Rank>;
+    using Strides = std::array<std::ptrdiff_t, Rank>;
+
+    NdArray() = default;
+
+    /// Allocate an uninitialized row-major array
+    explicit NdArray(const Shape &shape)
+        : m_shape(shape), m_strides(rowMajorStrides(shape)),
+          m_storage(allocateAligned<T>(count(shape))), m_data(static_cast<T *>(const_cast<void *>(m_storage.get()))) {}
+
+    /**
+     * @brief Row-major view of memory owned elsewhere, e.g. an fftw_complex_ptr
+     * @param owner Kept alive by the view and its sub-views, may be empty for borrowed memory
+     */
+    static NdArray wrap(T *data, const Shape &shape, std::shared_ptr<const void> owner = {}) {
+        return NdArray(data, shape, rowMajorStrides(shape), std::move(owner));
+    }
+
+    const Shape &shape() const { return m_shape; }
+    size_t shape(size_t dim) const { return m_shape[dim]; }
+    const Strides &strides() const { return m_strides; }
+    std::ptrdiff_t stride(size_t dim) const { return m_strides[dim]; }
+    static constexpr size_t rank() { return Rank; }
+
+    size_t size() const { return count(m_shape); }
+    bool empty() const { return !m_data || size() == 0; }
+    T *data() const { return m_data; }
+
+    /// Elements are row-major without gaps, so data() can be handed to FFTW
+    bool isContiguous() const { return m_strides == rowMajorStrides(m_shape); }
+
+    template <typename... Index>
+    T &operator()(Index... index) const {
+        static_assert(sizeof...(Index) == Rank, "Number of indices must match the rank");
+        std::ptrdiff_t offset = 0;
+        size_t dim = 0;
+        ((offset += static_cast<std::ptrdiff_t>(index) * m_strides[dim++]), ...);
+        return m_data[offset];
+    }
+
+    T &operator[](const Shape &index) const {
+        std::ptrdiff_t offset = 0;
+        for (size_t d = 0; d < Rank; d++) {
+            offset += static_cast<std::ptrdiff_t>(index[d]) * m_strides[d];
+        }
+        return m_data[offset];
+    }
+
+    /// Fix dimension dim at index, the result has one dimension less
+    NdArray<T, Rank - 1> slice(size_t dim, size_t index) const {
+        static_assert(Rank > 1, "Can not slice a one dimensional array");
+        checkIndex(dim, index);
+
+        typename NdArray<T, Rank - 1>::Shape shape;
+        typename NdArray<T, Rank - 1>::Strides strides;
+        for (size_t d = 0, o = 0; d < Rank; d++) {
+            if (d == dim) {
+                continue;
+            }
+            shape[o] = m_shape[d];
+            strides[o] = m_strides[d];
+            o++;
+        }
+        return NdArray<T, Rank - 1>(m_data + index * m_strides[dim], shape, strides, m_storage);
+    }
+
+    /// Keep [begin, end) of dimension dim
+    NdArray range(size_t dim, size_t begin, size_t end) const {
+        if (dim >= Rank || begin > end || end > m_shape[dim]) {
+            throw std::out_of_range("NdArray range out of bounds");
+        }
+        auto shape = m_shape;
+        shape[dim] = end - begin;
+        return NdArray(m_data + begin * m_strides[dim], shape, m_strides, m_storage);
+    }
+
+    /// Reorder the dimensions, dimension d of the result is dimension order[d] of this array
+    NdArray permute(const std::array<size_t, Rank> &order) const {
+        Shape shape;
+        Strides strides;
+        std::array<bool, Rank> used{};
+        for (size_t d = 0; d < Rank; d++) {
+            if (order[d] >= Rank || used[order[d]]) {
+                throw std::invalid_argument("NdArray permute order is not a permutation");
+            }
+            used[order[d]] = true;
+            shape[d] = m_shape[order[d]];
+            strides[d] = m_strides[order[d]];
+        }
+        return NdArray(m_data, shape, strides, m_storage);
+    }
+
+    /// Same elements with another shape, only for contiguous arrays
+    template <size_t NewRank>
+    NdArray<T, NewRank> reshape(const std::array<size_t, NewRank> &shape) const {
+        if (!isContiguous() || NdArray<T, NewRank>::count(shape) != size()) {
+            throw std::invalid_argument("NdArray reshape needs a contiguous array of the same size");
+        }
+        return NdArray<T, NewRank>(m_data, shape, NdArray<T, NewRank>::rowMajorStrides(shape),
+                                   m_storage);
+    }
+
+    /// Independent contiguous copy
+    NdArray copy() const {
+        NdArray result(m_shape);
+        if (empty()) {
+            return result;
+        }
+        if (isContiguous()) {
+            std::memcpy(result.m_data, m_data, size() * sizeof(T));
+            return result;
+        }
+
+        Shape index{};
+        for (size_t i = 0, n = size(); i < n; i++) {
+            std::memcpy(&result.m_data[i], &(*this)[index], sizeof(T));
+            next(index);
+        }
+        return result;
+    }
+
+    /// Buffer shared by this array and its views
+    const std::shared_ptr<const void> &storage() const { return m_storage; }
+
+    static constexpr Strides rowMajorStrides(const Shape &shape) {
+        Strides strides{};
+        std::ptrdiff_t stride = 1;
+        for (size_t d = Rank; d-- > 0;) {
+            strides[d] = stride;
+            stride *= static_cast<std::ptrdiff_t>(shape[d]);
+        }
+        return strides;
+    }
+
+    static constexpr size_t count(const Shape &shape) {
+        size_t n = 1;
+        for (auto s : shape) {
+            n *= s;
+        }
+        return n;
+    }
+
+private:
+    template <typename, size_t>
+    friend class NdArray;
+
+    NdArray(T *data, const Shape &shape, const Strides &strides, std::shared_ptr<const void> storage)
+        : m_shape(shape), m_strides(strides), m_storage(std::move(storage)), m_data(data) {}
+
+    void checkIndex(size_t dim, size_t index) const {
+        if (dim >= Rank || index >= m_shape[dim]) {
+            throw std::out_of_range("NdArray index out of bounds");
+        }
+    }
+
+    /// Advance a row-major multi-index
+    void next(Shape &index) const {
+        for (size_t d = Rank; d-- > 0;) {
+            if (++index[d] < m_shape[d]) {
+                return;
+            }
+            index[d] = 0;
+        }
+    }
+
+    Shape m_shape{};
+    Strides m_strides{};
+    std::shared_ptr<const void> m_storage;
+    T *m_data = nullptr;
+};
+
+} // namespace nd_utils
+
+#endif // NDARRAY_H
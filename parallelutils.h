@@ -0,0 +1,90 @@
+#ifndef PARALLELUTILS_H
+#define PARALLELUTILS_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Minimal fork-join helpers for the data-parallel loops of the reconstruction
+ * @detail Uses the standard library only, like fftw_utils, so it can be reused outside Qt
+ */
+namespace parallel_utils {
+
+inline std::atomic<int> s_maxThreads{0};
+
+/// Default number of workers, hardware concurrency unless set by setMaxThreads
+inline int maxThreads() {
+    int count = s_maxThreads.load(std::memory_order_relaxed);
+    if (count > 0) {
+        return count;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// @param count <= 0 means hardware concurrency
+inline void setMaxThreads(int count) {
+    s_maxThreads.store(std::max(0, count), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Call fn(i) for every i in [begin, end), indexes are handed out dynamically
+ * @param workers Number of threads including the calling one, <= 0 means maxThreads()
+ * @details The first exception thrown by fn is rethrown in the calling thread
+ */
+template <typename F>
+void parallelFor(int begin, int end, F &&fn, int workers = 0) {
+    if (end <= begin) {
+        return;
+    }
+    if (workers <= 0) {
+        workers = maxThreads();
+    }
+    workers = std::min(workers, end - begin);
+
+    if (workers <= 1) {
+        for (int i = begin; i < end; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next{begin};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        for (int i = next++; i < end; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = end;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (int i = 1; i < workers; i++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace parallel_utils
+
+#endif // PARALLELUTILS_H
@@ -0,0 +1,323 @@
+#include "partialfourier.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "parallelutils.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// Below this many samples the loops run on the calling thread only
+constexpr size_t kParallelMin = size_t(1) << 18;
+
+/// Layout of a zero filled Mrd, every (block, view) row is rowLength contiguous samples
+struct Layout {
+    int blocks = 0;
+    int views = 0;
+    size_t rowLength = 0;
+
+    int rows() const { return blocks * views; }
+    size_t size() const { return static_cast<size_t>(rows()) * rowLength; }
+};
+
+template <typename Real>
+Layout layoutOf(const mrd_utils::BasicMrd<Real> &mrd) {
+    return {mrd.experiments * mrd.echoes * mrd.slices, mrd.views,
+            static_cast<size_t>(mrd.views2) * mrd.samples};
+}
+
+/// Call fn(row, view) for every row, rows of all blocks are spread over the workers
+template <typename F>
+void forRows(const Layout &layout, F &&fn) {
+    const int workers = layout.size() < kParallelMin ? 1 : 0;
+    parallel_utils::parallelFor(0, layout.rows(), [&](int row) { fn(row, row % layout.views); },
+                                workers);
+}
+
+/**
+ * @brief Unit phasors of the low resolution image of the symmetric centre, image order of exec_fft
+ * @details The symmetric views are tapered by a Hann window so the phase is smooth
+ */
+template <typename Real>
+fftw_utils::complex_ptr<Real> phaseEstimate(const fftw_utils::Complex<Real> *kspace,
+                                            const Layout &layout,
+                                            const partial_fourier::Coverage &coverage,
+                                            const std::vector<int> &shape) {
+    const int centre = coverage.centre();
+    const int half = coverage.symmetricViews();
+    auto phase = fftw_utils::createArray<Real>(layout.size());
+    auto out = phase.get();
+    forRows(layout, [&](int row, int view) {
+        auto dst = out + row * layout.rowLength;
+        auto distance = std::abs(view - centre);
+        if (distance > half) {
+            std::memset(dst, 0, layout.rowLength * sizeof(*dst));
+            return;
+        }
+        auto weight = static_cast<Real>(0.5 * (1 + std::cos(kPi * distance / (half + 1))));
+        auto src = kspace + row * layout.rowLength;
+        for (size_t i = 0; i < layout.rowLength; i++) {
+            dst[i][0] = src[i][0] * weight;
+            dst[i][1] = src[i][1] * weight;
+        }
+    });
+
+    if (!fftw_utils::exec_fft_inplace(out, shape, layout.blocks)) {
+        return {};
+    }
+
+    forRows(layout, [&](int row, int) {
+        auto dst = out + row * layout.rowLength;
+        for (size_t i = 0; i < layout.rowLength; i++) {
+            Real norm = std::sqrt(dst[i][0] * dst[i][0] + dst[i][1] * dst[i][1]);
+            Real scale = norm > 0 ? 1 / norm : 0;
+            dst[i][0] *= scale;
+            dst[i][1] *= scale;
+        }
+    });
+    return phase;
+}
+
+/**
+ * @brief Homodyne weight of a view, 2 on the acquired only side, 0 on the missing one
+ * @details w(c + d) + w(c - d) = 2 across the symmetric views, so every frequency is counted once
+ */
+double homodyneWeight(const partial_fourier::Coverage &coverage, int view) {
+    const int half = coverage.symmetricViews();
+    const bool missingHigh = coverage.offset + coverage.acquired < coverage.fullViews;
+    const int distance = (view - coverage.centre()) * (missingHigh ? 1 : -1);
+    if (distance < -half) {
+        return 2;
+    }
+    if (distance > half) {
+        return 0;
+    }
+    return 1 - std::sin(kPi / 2 * distance / (half + 1));
+}
+
+template <typename Real>
+bool homodyne(fftw_utils::Complex<Real> *data, const Layout &layout,
+              const partial_fourier::Coverage &coverage, const std::vector<int> &shape) {
+    auto phase = phaseEstimate<Real>(data, layout, coverage, shape);
+    if (!phase) {
+        return false;
+    }
+
+    forRows(layout, [&](int row, int view) {
+        auto weight = static_cast<Real>(homodyneWeight(coverage, view));
+        auto dst = data + row * layout.rowLength;
+        for (size_t i = 0; i < layout.rowLength; i++) {
+            dst[i][0] *= weight;
+            dst[i][1] *= weight;
+        }
+    });
+    if (!fftw_utils::exec_fft_inplace(data, shape, layout.blocks)) {
+        return false;
+    }
+
+    // Real part after removing the phase, conj(p) * x with |p| = 1
+    auto p = phase.get();
+    forRows(layout, [&](int row, int) {
+        auto offset = row * layout.rowLength;
+        auto dst = data + offset;
+        auto src = p + offset;
+        for (size_t i = 0; i < layout.rowLength; i++) {
+            dst[i][0] = src[i][0] * dst[i][0] + src[i][1] * dst[i][1];
+            dst[i][1] = 0;
+        }
+    });
+    return true;
+}
+
+/// Replace the missing views of data by the k-space of |image| with the estimated phase
+template <typename Real>
+bool pocs(fftw_utils::Complex<Real> *data, const Layout &layout,
+          const partial_fourier::Coverage &coverage, const std::vector<int> &shape,
+          int iterations) {
+    auto phase = phaseEstimate<Real>(data, layout, coverage, shape);
+    if (!phase) {
+        return false;
+    }
+
+    size_t points = 1;
+    for (auto size : shape) {
+        points *= size;
+    }
+    // The backward transform is unnormalized, fold 1 / points into the phase
+    const auto normalization = static_cast<Real>(1.0 / points);
+    auto p = phase.get();
+    forRows(layout, [&](int row, int) {
+        auto dst = p + row * layout.rowLength;
+        for (size_t i = 0; i < layout.rowLength; i++) {
+            dst[i][0] *= normalization;
+            dst[i][1] *= normalization;
+        }
+    });
+
+    const int first = coverage.offset;
+    const int last = coverage.offset + coverage.acquired;
+    auto estimate = fftw_utils::createArray<Real>(layout.size());
+    auto work = estimate.get();
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        std::memcpy(work, data, layout.size() * sizeof(*work));
+        if (!fftw_utils::exec_fft_inplace(work, shape, layout.blocks)) {
+            return false;
+        }
+        forRows(layout, [&](int row, int) {
+            auto offset = row * layout.rowLength;
+            auto dst = work + offset;
+            auto src = p + offset;
+            for (size_t i = 0; i < layout.rowLength; i++) {
+                Real magnitude = std::sqrt(dst[i][0] * dst[i][0] + dst[i][1] * dst[i][1]);
+                dst[i][0] = magnitude * src[i][0];
+                dst[i][1] = magnitude * src[i][1];
+            }
+        });
+        if (!fftw_utils::exec_ifft_inplace(work, shape, layout.blocks)) {
+            return false;
+        }
+        // Measured views are kept as acquired, only the missing ones take the estimate
+        forRows(layout, [&](int row, int view) {
+            if (view < first || view >= last) {
+                auto offset = row * layout.rowLength;
+                std::memcpy(data + offset, work + offset, layout.rowLength * sizeof(*work));
+            }
+        });
+    }
+    return fftw_utils::exec_fft_inplace(data, shape, layout.blocks);
+}
+
+} // namespace
+
+namespace partial_fourier {
+
+int Coverage::symmetricViews() const {
+    const int before = centre() - offset;
+    const int after = offset + acquired - 1 - centre();
+    return std::max(0, std::min(before, after));
+}
+
+template <typename Real>
+Coverage locate(const mrd_utils::BasicMrd<Real> &kspace, int fullViews) {
+    Coverage coverage;
+    coverage.fullViews = fullViews;
+    coverage.acquired = kspace.views;
+    if (!coverage.isPartial() || !kspace.kdata || kspace.transformed) {
+        return coverage;
+    }
+
+    // The peak is the k-space centre, its view is centre() of the full k-space
+    auto data = kspace.kdata.get();
+    const size_t rowLength = static_cast<size_t>(kspace.views2) * kspace.samples;
+    const size_t blockSize = kspace.views * rowLength;
+    size_t peak = 0;
+    Real peakNorm = -1;
+    for (size_t i = 0; i < blockSize; i++) {
+        Real norm = data[i][0] * data[i][0] + data[i][1] * data[i][1];
+        if (norm > peakNorm) {
+            peakNorm = norm;
+            peak = i;
+        }
+    }
+    const int peakView = static_cast<int>(peak / rowLength);
+    coverage.offset = std::clamp(coverage.centre() - peakView, 0, fullViews - kspace.views);
+    return coverage;
+}
+
+template <typename Real>
+mrd_utils::BasicMrd<Real> zeroFill(const mrd_utils::BasicMrd<Real> &kspace,
+                                   const Coverage &coverage) {
+    if (!coverage.isPartial() || !kspace.kdata || kspace.transformed ||
+        kspace.views != coverage.acquired) {
+        return kspace;
+    }
+
+    mrd_utils::BasicMrd<Real> result;
+    result.experiments = kspace.experiments;
+    result.echoes = kspace.echoes;
+    result.slices = kspace.slices;
+    result.views = coverage.fullViews;
+    result.views2 = kspace.views2;
+    result.samples = kspace.samples;
+    result.ppr = kspace.ppr;
+    result.centred = kspace.centred;
+
+    const auto layout = layoutOf(result);
+    auto filled = fftw_utils::createArray<Real>(layout.size());
+    auto src = kspace.kdata.get();
+    auto dst = filled.get();
+    forRows(layout, [&](int row, int view) {
+        auto out = dst + row * layout.rowLength;
+        auto acquiredView = view - coverage.offset;
+        if (acquiredView < 0 || acquiredView >= coverage.acquired) {
+            std::memset(out, 0, layout.rowLength * sizeof(*out));
+            return;
+        }
+        auto block = row / layout.views;
+        auto in = src + (static_cast<size_t>(block) * coverage.acquired + acquiredView) * layout.rowLength;
+        std::memcpy(out, in, layout.rowLength * sizeof(*out));
+    });
+    result.kdata = std::move(filled);
+    return result;
+}
+
+template <typename Real>
+bool reconstruct(mrd_utils::BasicMrd<Real> &mrd, const Coverage &coverage,
+                 recon::PartialFourier method, int iterations) {
+    if (mrd.transformed || mrd.views != coverage.fullViews) {
+        LOG_ERROR("Partial Fourier reconstruction needs zero filled k-space");
+        return false;
+    }
+    if (method == recon::PartialFourier::ZeroFill || !coverage.isPartial()) {
+        return mrd.transform();
+    }
+    if (coverage.symmetricViews() < kMinSymmetricViews) {
+        LOG_WARNING(QString("Only %1 symmetric views around the k-space centre, zero filling instead")
+                        .arg(coverage.symmetricViews()));
+        return mrd.transform();
+    }
+
+    auto data = mrd.detach();
+    if (!data) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto layout = layoutOf(mrd);
+    const auto shape = mrd_utils::volumeShape(mrd.views, mrd.views2, mrd.samples);
+    bool ok = method == recon::PartialFourier::Pocs
+                  ? pocs<Real>(data, layout, coverage, shape, iterations)
+                  : homodyne<Real>(data, layout, coverage, shape);
+    if (!ok) {
+        LOG_ERROR("Partial Fourier reconstruction failed.");
+        return false;
+    }
+    if (!mrd.centred) {
+        fftw_utils::fftshift(data, {layout.blocks, mrd.views, mrd.views2, mrd.samples}, {1, 2, 3});
+    }
+    mrd.transformed = true;
+
+    LOG_DEBUG(QString("Partial Fourier (%1, %2 of %3 views) in %4 ms, %5 ms per block")
+                  .arg(recon::partialFourierName(method))
+                  .arg(coverage.acquired)
+                  .arg(coverage.fullViews)
+                  .arg(timer.elapsed())
+                  .arg(static_cast<double>(timer.elapsed()) / std::max(layout.blocks, 1), 0, 'f', 2));
+    return true;
+}
+
+template Coverage locate(const mrd_utils::BasicMrd<double> &, int);
+template Coverage locate(const mrd_utils::BasicMrd<float> &, int);
+template mrd_utils::BasicMrd<double> zeroFill(const mrd_utils::BasicMrd<double> &, const Coverage &);
+template mrd_utils::BasicMrd<float> zeroFill(const mrd_utils::BasicMrd<float> &, const Coverage &);
+template bool reconstruct(mrd_utils::BasicMrd<double> &, const Coverage &, recon::PartialFourier, int);
+template bool reconstruct(mrd_utils::BasicMrd<float> &, const Coverage &, recon::PartialFourier, int);
+
+} // namespace partial_fourier
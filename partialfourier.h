@@ -0,0 +1,70 @@
+#ifndef PARTIALFOURIER_H
+#define PARTIALFOURIER_H
+
+#include "mrdutils.h"
+#include "reconoptions.h"
+
+/**
+ * @brief Reconstruction of k-space acquired with only a part of the views
+ * @details A partial Fourier acquisition skips views on one side of the k-space centre.
+ * The views are zero filled to the full k-space and the missing half is estimated from
+ * conjugate symmetry, using the phase of the symmetrically sampled centre. All blocks are
+ * processed by batched FFTs, the pixel loops run in parallel over the blocks.
+ */
+namespace partial_fourier {
+
+/// POCS iterations, the estimate barely changes after a few
+constexpr int kPocsIterations = 6;
+/// Fewer symmetric views on each side of the centre give no usable phase, zero fill is used
+constexpr int kMinSymmetricViews = 2;
+
+/**
+ * @brief Where the acquired views lie in the full k-space
+ */
+struct Coverage {
+    int fullViews = 0;
+    /// Views acquired, contiguous
+    int acquired = 0;
+    /// Full k-space view of the first acquired one
+    int offset = 0;
+
+    /// A partial acquisition, more than half and fewer than all views
+    bool isPartial() const { return acquired < fullViews && 2 * acquired > fullViews; }
+    /// View of the k-space centre in the full k-space
+    int centre() const { return fullViews / 2; }
+    /// Views sampled on both sides of the centre, [centre - n, centre + n] is symmetric
+    int symmetricViews() const;
+};
+
+/**
+ * @brief Locate the acquired views by the peak of the first block, the k-space centre
+ * @return isPartial() is false if kspace is no partial acquisition of fullViews views
+ */
+template <typename Real>
+Coverage locate(const mrd_utils::BasicMrd<Real> &kspace, int fullViews);
+
+/**
+ * @brief Copy the acquired views into a zero k-space of coverage.fullViews views
+ * @details A centred kspace stays centred, its modulation is off by the same sign in
+ * every view if offset is odd which no stage can tell apart
+ * @return kspace itself if coverage is not partial or kspace is transformed
+ */
+template <typename Real>
+mrd_utils::BasicMrd<Real> zeroFill(const mrd_utils::BasicMrd<Real> &kspace,
+                                   const Coverage &coverage);
+
+/**
+ * @brief Transform zero filled k-space, estimating the views it lacks
+ * @details Leaves mrd transformed like BasicMrd::transform. Homodyne gives real images,
+ * sign included, Pocs and ZeroFill complex ones.
+ * @param mrd zeroFill() of the acquired k-space
+ * @param iterations Pocs only
+ * @return false if the FFT failed or mrd does not match coverage
+ */
+template <typename Real>
+bool reconstruct(mrd_utils::BasicMrd<Real> &mrd, const Coverage &coverage,
+                 recon::PartialFourier method, int iterations = kPocsIterations);
+
+} // namespace partial_fourier
+
+#endif // PARTIALFOURIER_H
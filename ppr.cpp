@@ -0,0 +1,136 @@
+#include "ppr.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+
+#include "utils.h"
+
+namespace mrd_utils {
+
+Ppr Ppr::parse(const QByteArray &text) {
+    Ppr ppr;
+    ppr.m_text = QString::fromLatin1(text);
+
+    static const QRegularExpression lineBreak("[\\r\\n]+");
+    static const QRegularExpression space("\\s+");
+    for (const auto &rawLine : ppr.m_text.split(lineBreak, Qt::SkipEmptyParts)) {
+        auto line = rawLine.trimmed();
+        if (!line.startsWith(':')) {
+            continue;
+        }
+        line.remove(0, 1);
+
+        auto key = line.section(space, 0, 0);
+        auto value = line.section(space, 1).trimmed();
+        if (key.isEmpty()) {
+            continue;
+        }
+        ppr.m_values.insert(key, value);
+
+        // ":VAR name, value" declares a named variable
+        if (key == "VAR") {
+            auto name = value.section(',', 0, 0).trimmed();
+            if (!name.isEmpty()) {
+                ppr.m_values.insert(name, value.section(',', 1).trimmed());
+            }
+        }
+    }
+
+    return ppr;
+}
+
+QString Ppr::value(const QString &key, const QString &defaultValue) const {
+    return m_values.value(key, defaultValue);
+}
+
+QStringList Ppr::fields(const QString &key) const {
+    QStringList result;
+    for (const auto &field : value(key).split(',')) {
+        result << field.trimmed();
+    }
+    return result;
+}
+
+int Ppr::toInt(const QString &key, int defaultValue) const {
+    if (!contains(key)) {
+        return defaultValue;
+    }
+
+    bool ok = false;
+    auto result = fields(key).last().toInt(&ok);
+    return ok ? result : defaultValue;
+}
+
+double Ppr::toDouble(const QString &key, double defaultValue) const {
+    if (!contains(key)) {
+        return defaultValue;
+    }
+
+    bool ok = false;
+    auto result = fields(key).last().toDouble(&ok);
+    return ok ? result : defaultValue;
+}
+
+Acquisition Acquisition::fromPpr(const Ppr &ppr) {
+    Acquisition acquisition;
+    acquisition.views = std::max(ppr.toInt(KEY_VIEWS), 0);
+    acquisition.oversampling = std::max(ppr.toInt(KEY_OVERSAMPLING, 1), 1);
+    acquisition.acceleration = std::max(ppr.toInt(KEY_ACCELERATION), 0);
+    acquisition.acsLines = std::max(ppr.toInt(KEY_ACS_LINES), 0);
+    acquisition.partialFourier = ppr.toInt(KEY_PARTIAL_FOURIER) != 0;
+    if (ppr.contains(KEY_VIEW_TABLE)) {
+        for (const auto &field : ppr.fields(KEY_VIEW_TABLE)) {
+            bool ok = false;
+            auto view = field.toInt(&ok);
+            if (!ok) {
+                LOG_WARNING(QString("Invalid %1 entry '%2', views stay in acquisition order")
+                                .arg(KEY_VIEW_TABLE, field));
+                acquisition.viewTable.clear();
+                break;
+            }
+            acquisition.viewTable.push_back(view);
+        }
+    }
+    return acquisition;
+}
+
+QVector<int> Acquisition::viewPositions(int views) const {
+    if (viewTable.isEmpty()) {
+        return {};
+    }
+    if (viewTable.size() != views) {
+        LOG_WARNING(QString("%1 lists %2 views, the data has %3, views stay in acquisition order")
+                        .arg(KEY_VIEW_TABLE)
+                        .arg(viewTable.size())
+                        .arg(views));
+        return {};
+    }
+
+    const bool offsets = *std::min_element(viewTable.begin(), viewTable.end()) < 0;
+    QVector<int> positions;
+    std::vector<bool> seen(views, false);
+    bool ordered = true;
+    for (int i = 0; i < views; i++) {
+        const int position = viewTable[i] + (offsets ? views / 2 : 0);
+        if (position < 0 || position >= views || seen[position]) {
+            LOG_WARNING(QString("%1 is no permutation of the %2 views, views stay in acquisition order")
+                            .arg(KEY_VIEW_TABLE)
+                            .arg(views));
+            return {};
+        }
+        seen[position] = true;
+        ordered = ordered && position == i;
+        positions.push_back(position);
+    }
+    return ordered ? QVector<int>() : positions;
+}
+
+int Acquisition::fieldOfViewSamples(int samples) const {
+    if (oversampling <= 1 || samples % oversampling != 0) {
+        return samples;
+    }
+    return samples / oversampling;
+}
+
+} // namespace mrd_utils
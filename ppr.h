@@ -0,0 +1,83 @@
+#ifndef PPR_H
+#define PPR_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace mrd_utils {
+
+/**
+ * @brief Acquisition parameters stored as PPR text at the end of an MRD file
+ * @details Every line has the form ":KEY value", values of the form "name, value" keep
+ * all fields, the typed getters use the last one. ":VAR name, value" lines are also
+ * available under "name". Keys are case sensitive, as written by the scanner.
+ */
+class Ppr {
+public:
+    Ppr() = default;
+
+    static Ppr parse(const QByteArray &text);
+
+    bool isEmpty() const { return m_values.isEmpty(); }
+    bool contains(const QString &key) const { return m_values.contains(key); }
+    QStringList keys() const { return m_values.keys(); }
+
+    /// Raw text after the key
+    QString value(const QString &key, const QString &defaultValue = QString()) const;
+    /// Comma separated fields of the value, trimmed
+    QStringList fields(const QString &key) const;
+
+    int toInt(const QString &key, int defaultValue = 0) const;
+    double toDouble(const QString &key, double defaultValue = 0) const;
+
+    /// The PPR text as stored in the file
+    QString text() const { return m_text; }
+
+private:
+    QString m_text;
+    QMap<QString, QString> m_values;
+};
+
+/**
+ * @brief Geometry of the acquisition as recorded in the PPR, what the scanner actually ran
+ * @details Values the PPR does not record are 0, 1 or empty, the exam options hold for them
+ */
+struct Acquisition {
+    /// Prescribed views of the full k-space, more than the file holds if some were skipped
+    static constexpr const char *KEY_VIEWS = "NO_VIEWS";
+    /// k-space view of each acquired view, ":VAR pe1_table, v0, v1, ..."
+    static constexpr const char *KEY_VIEW_TABLE = "pe1_table";
+    /// Readout oversampling factor, the field of view is the central 1 / factor of the samples
+    static constexpr const char *KEY_OVERSAMPLING = "read_oversampling";
+    static constexpr const char *KEY_ACCELERATION = "accel_factor";
+    static constexpr const char *KEY_ACS_LINES = "acs_lines";
+    /// Non-zero if the sequence skipped views on one side of k-space on purpose
+    static constexpr const char *KEY_PARTIAL_FOURIER = "partial_fourier";
+
+    int views = 0;
+    /// As written, either view indices or offsets from the k-space centre
+    QVector<int> viewTable;
+    int oversampling = 1;
+    int acceleration = 0;
+    int acsLines = 0;
+    bool partialFourier = false;
+
+    static Acquisition fromPpr(const Ppr &ppr);
+
+    /**
+     * @brief k-space position of each of the acquired views
+     * @details A table with negative entries holds offsets from the centre views / 2
+     * @return Empty if the table is missing, in acquisition order already or not a
+     * permutation of [0, views)
+     */
+    QVector<int> viewPositions(int views) const;
+    /// Samples of the field of view, samples if not oversampled or not divisible
+    int fieldOfViewSamples(int samples) const;
+};
+
+} // namespace mrd_utils
+
+#endif // PPR_H
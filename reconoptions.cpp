@@ -0,0 +1,132 @@
+#include "reconoptions.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "utils.h"
+
+namespace {
+std::mutex s_mutex;
+recon::Options s_defaults;
+} // namespace
+
+namespace recon {
+
+Options Options::defaults() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_defaults;
+}
+
+void Options::setDefaults(const Options &options) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_defaults = options;
+}
+
+Options Options::fromParams(const QJsonObject &params, Options base) {
+    if (params.contains(KEY_PRECISION)) {
+        auto value = params[KEY_PRECISION].toString().toLower();
+        if (value == "single" || value == "float") {
+            base.precision = Precision::Single;
+        } else if (value == "double") {
+            base.precision = Precision::Double;
+        } else {
+            LOG_WARNING(QString("Unknown reconstruction precision: %1").arg(value));
+        }
+    }
+    if (params.contains(KEY_SHIFT_FREE)) {
+        base.shiftFree = params[KEY_SHIFT_FREE].toBool(base.shiftFree);
+    }
+    if (params.contains(KEY_COIL_COMBINE)) {
+        auto value = params[KEY_COIL_COMBINE].toString().toLower();
+        if (value == "rss") {
+            base.coilCombine = CoilCombine::Rss;
+        } else if (value == "sensitivity") {
+            base.coilCombine = CoilCombine::Sensitivity;
+        } else if (value == "none") {
+            base.coilCombine = CoilCombine::None;
+        } else {
+            LOG_WARNING(QString("Unknown coil combination: %1").arg(value));
+        }
+    }
+    if (params.contains(KEY_PARTIAL_FOURIER)) {
+        auto value = params[KEY_PARTIAL_FOURIER].toString().toLower();
+        if (value == "zerofill" || value == "zero_fill") {
+            base.partialFourier = PartialFourier::ZeroFill;
+        } else if (value == "homodyne") {
+            base.partialFourier = PartialFourier::Homodyne;
+        } else if (value == "pocs") {
+            base.partialFourier = PartialFourier::Pocs;
+        } else {
+            LOG_WARNING(QString("Unknown partial Fourier reconstruction: %1").arg(value));
+        }
+    }
+    if (params.contains(KEY_FULL_VIEWS)) {
+        base.fullViews = params[KEY_FULL_VIEWS].toInt(base.fullViews);
+    }
+    if (params.contains(KEY_PARTIAL_FOURIER_ACQUIRED)) {
+        base.partialFourierAcquired = params[KEY_PARTIAL_FOURIER_ACQUIRED].toBool(base.partialFourierAcquired);
+    }
+    if (params.contains(KEY_ACCELERATION)) {
+        base.acceleration = std::max(1, params[KEY_ACCELERATION].toInt(base.acceleration));
+    }
+    if (params.contains(KEY_ACS_LINES)) {
+        base.acsLines = std::max(0, params[KEY_ACS_LINES].toInt(base.acsLines));
+    }
+    if (params.contains(KEY_PARALLEL_IMAGING)) {
+        auto value = params[KEY_PARALLEL_IMAGING].toString().toLower();
+        if (value == "grappa") {
+            base.parallelImaging = ParallelImaging::Grappa;
+        } else if (value == "sense") {
+            base.parallelImaging = ParallelImaging::Sense;
+        } else {
+            LOG_WARNING(QString("Unknown parallel imaging reconstruction: %1").arg(value));
+        }
+    }
+    return base;
+}
+
+QString precisionName(Precision precision) {
+    switch (precision) {
+    case Precision::Single:
+        return "single";
+    case Precision::Double:
+    default:
+        return "double";
+    }
+}
+
+QString coilCombineName(CoilCombine combine) {
+    switch (combine) {
+    case CoilCombine::Sensitivity:
+        return "sensitivity";
+    case CoilCombine::None:
+        return "none";
+    case CoilCombine::Rss:
+    default:
+        return "rss";
+    }
+}
+
+QString partialFourierName(PartialFourier method) {
+    switch (method) {
+    case PartialFourier::ZeroFill:
+        return "zerofill";
+    case PartialFourier::Pocs:
+        return "pocs";
+    case PartialFourier::Homodyne:
+    default:
+        return "homodyne";
+    }
+}
+
+QString parallelImagingName(ParallelImaging method) {
+    switch (method) {
+    case ParallelImaging::Sense:
+        return "sense";
+    case ParallelImaging::Grappa:
+    default:
+        return "grappa";
+    }
+}
+
+} // namespace recon
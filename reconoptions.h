@@ -0,0 +1,103 @@
+#ifndef RECONOPTIONS_H
+#define RECONOPTIONS_H
+
+#include <QJsonObject>
+#include <QString>
+
+namespace recon {
+
+/// Floating point precision of the k-space buffers and FFTs
+enum class Precision { Double = 0, Single };
+
+/// How coil images are merged into the extra "Combined" channel of multi-coil exams
+enum class CoilCombine {
+    /// Root sum of squares of the coil magnitudes
+    Rss = 0,
+    /// Coils weighted by sensitivities estimated from the k-space centre
+    Sensitivity,
+    /// No combined channel
+    None
+};
+
+/// How the views a partial Fourier acquisition skipped are filled in
+enum class PartialFourier {
+    /// Left at zero, fastest, blurs along the phase encode direction
+    ZeroFill = 0,
+    /// Conjugate symmetry with a phase estimate from the symmetric centre, one extra FFT
+    Homodyne,
+    /// Iterative projection onto the measured data and a smooth phase, slowest and sharpest
+    Pocs
+};
+
+/// How the views skipped by an accelerated acquisition are recovered
+enum class ParallelImaging {
+    /// Skipped views estimated in k-space from their acquired neighbours, every coil stays a full image
+    Grappa = 0,
+    /// Folded coil images unfolded by their sensitivities, only the combined channel is unaliased
+    Sense
+};
+
+/**
+ * @brief Reconstruction settings passed down to IExamResponse::images
+ * @details defaults() holds the application wide values (Debug preferences),
+ * fromParams() lets a single exam override them through its request parameters.
+ */
+struct Options {
+    static constexpr const char *KEY_PRECISION = "precision";
+    static constexpr const char *KEY_SHIFT_FREE = "shift_free";
+    static constexpr const char *KEY_COIL_COMBINE = "coil_combine";
+    static constexpr const char *KEY_PARTIAL_FOURIER = "partial_fourier";
+    /// Prescribed views of the exam, the acquisition parameter edited in ExamInfoDialog
+    static constexpr const char *KEY_FULL_VIEWS = "noViews";
+    static constexpr const char *KEY_PARTIAL_FOURIER_ACQUIRED = "partial_fourier_acquired";
+    static constexpr const char *KEY_ACCELERATION = "acceleration";
+    static constexpr const char *KEY_ACS_LINES = "acs_lines";
+    static constexpr const char *KEY_PARALLEL_IMAGING = "parallel_imaging";
+
+    Precision precision = Precision::Double;
+    /// Centre the images by modulating k-space while decoding instead of a fftshift pass
+    bool shiftFree = true;
+    CoilCombine coilCombine = CoilCombine::Rss;
+    PartialFourier partialFourier = PartialFourier::Homodyne;
+    /**
+     * @brief Views of the fully sampled k-space, 0 if unknown
+     * @details Data with fewer views than this, but more than half, is a partial Fourier
+     * acquisition and is reconstructed with partialFourier, if partialFourierAcquired
+     */
+    int fullViews = 0;
+    /**
+     * @brief The sequence skipped views on purpose, set by the exam or the PPR
+     * @details Without it fewer views than fullViews are an aborted or misconfigured scan,
+     * reconstructed as acquired
+     */
+    bool partialFourierAcquired = false;
+    /**
+     * @brief Parallel imaging factor along the views, 1 means fully sampled
+     * @details Above 1 only every acceleration-th view through the k-space centre and
+     * acsLines views around it were acquired, the others are recovered by parallelImaging
+     */
+    int acceleration = 1;
+    int acsLines = 24;
+    ParallelImaging parallelImaging = ParallelImaging::Grappa;
+
+    static Options defaults();
+    static void setDefaults(const Options &options);
+
+    /**
+     * @brief Options for one exam
+     * @param params ExamRequest::params(), e.g. {"precision": "single", "shift_free": false,
+     * "coil_combine": "sensitivity", "partial_fourier": "pocs", "noViews": 256,
+     * "partial_fourier_acquired": true, "acceleration": 2, "acs_lines": 24, "parallel_imaging": "sense"}
+     * @param base Values used for keys missing in params
+     */
+    static Options fromParams(const QJsonObject &params, Options base = defaults());
+};
+
+QString precisionName(Precision precision);
+QString coilCombineName(CoilCombine combine);
+QString partialFourierName(PartialFourier method);
+QString parallelImagingName(ParallelImaging method);
+
+} // namespace recon
+
+#endif // RECONOPTIONS_H
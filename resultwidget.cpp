@@ -1,5 +1,6 @@
 #include "../resultwidget.h"
 #include "ui_resultwidget.h"
+#include "imageutils.h"
 #include "utils.h"
 
 #include <QApplication>
@@ -9,6 +10,8 @@
 #include <QGraphicsView>
 #include <QMessageBox>
 #include <QRegularExpression>
+#include <QSignalBlocker>
+#include <algorithm>
 #include <memory>
 
 ResultWidget::ResultWidget(QWidget *parent)
@@ -35,6 +38,8 @@ void ResultWidget::setupUi() {
     ui->rowSpin->setMinimumWidth(60);
     ui->heightSpin->setMinimumWidth(80);
     ui->widthSpin->setMinimumWidth(80);
+    ui->windowLevelSpin->setMinimumWidth(80);
+    ui->windowWidthSpin->setMinimumWidth(80);
 }
 
 void ResultWidget::setupConnections() {
@@ -53,40 +58,61 @@ void ResultWidget::setupConnections() {
             &QImagesWidget::setViewWidth);
     connect(ui->heightSpin, &QSpinBox::valueChanged, ui->contentWidget,
             &QImagesWidget::setViewHeight);
+
+    // Window/level only re-maps the kept 16-bit images
+    connect(ui->windowLevelSpin, &QSpinBox::valueChanged, this,
+            &ResultWidget::onWindowChanged);
+    connect(ui->windowWidthSpin, &QSpinBox::valueChanged, this,
+            &ResultWidget::onWindowChanged);
+    connect(ui->autoWindowButton, &QToolButton::clicked, this,
+            &ResultWidget::onAutoWindowClicked);
 }
 
 void ResultWidget::setData(const Exam &exam) {
     clear();
-    m_channels = exam.images();
-
-    // 更新选择框
-    auto channelsNum = m_channels.size();
-    auto imagesNum = m_channels[0].size();
-    QStringList channelsList;
-    QStringList imagesList;
-    for (int i = 0; i < channelsNum; i++) {
-        channelsList.append(QString::number(i));
+    m_source = exam.imageSource();
+    if (!m_source || m_source->channels() == 0 || m_source->count() == 0) {
+        return;
     }
+    // Reconstructions finish on the source's thread, redraw on this one
+    m_source->setReadyHandler([this] {
+        QMetaObject::invokeMethod(this, &ResultWidget::onImagesReady, Qt::QueuedConnection);
+    });
+
+    // 更新选择框, channels carry their index so named ones such as "Combined" still map back
+    auto channelsNum = m_source->channels();
+    auto imagesNum = m_source->count();
+    QStringList imagesList;
     for (int i = 0; i < imagesNum; i++) {
         imagesList.append(QString::number(i));
     }
-    ui->ChannelBox->setItems(channelsList);
-    ui->ImageBox->setItems(imagesList);
-
-    // 选中所有
+    QSignalBlocker channelBlocker(ui->ChannelBox);
+    QSignalBlocker imageBlocker(ui->ImageBox);
     for (int i = 0; i < channelsNum; i++) {
-        ui->ChannelBox->setChecked(i, true);
+        ui->ChannelBox->addItem(m_source->channelName(i), i);
     }
-    for (int i = 0; i < imagesNum; i++) {
+    ui->ImageBox->setItems(imagesList);
+
+    // Check the default channel and as many images as the grid shows, the others are
+    // reconstructed only when checked. The images are fetched once, below.
+    ui->ChannelBox->setChecked(std::clamp(m_source->defaultChannel(), 0, channelsNum - 1), true);
+    auto visible = std::min(imagesNum, ui->rowSpin->value() * ui->columnSpin->value());
+    for (int i = 0; i < visible; i++) {
         ui->ImageBox->setChecked(i, true);
     }
 
+    m_manualWindow = false;
+    showAutoWindow();
     updateImages();
 }
 
 void ResultWidget::clear() {
-    // Clear data
-    QVector<QVector<QImage>>().swap(m_channels);
+    // Clear data, cached reconstructions are released with the source
+    if (m_source) {
+        m_source->setReadyHandler(nullptr);
+    }
+    m_source.reset();
+    m_autoWindowPending = false;
 
     // Clear UI
     ui->ChannelBox->removeAllItems();
@@ -97,7 +123,7 @@ void ResultWidget::clear() {
 }
 
 void ResultWidget::updateImages() {
-    if (m_channels.isEmpty())
+    if (!m_source)
         return;
 
     // Get selected channels and images
@@ -116,17 +142,59 @@ void ResultWidget::updateImages() {
 
     for (const QVariant &channel : checkedChannels) {
         int channelIndex = channel.toInt();
-        if (channelIndex < 0 || channelIndex >= m_channels.size())
+        if (channelIndex < 0 || channelIndex >= m_source->channels())
             continue;
 
         for (const QVariant &image : checkedImages) {
-            int imageIndex = image.toInt();
-            if (imageIndex < 0 || imageIndex >= m_channels[channelIndex].size())
+            // Reconstructed in the background on first request, onImagesReady() shows it
+            auto img = m_source->cachedImage(channelIndex, image.toInt());
+            if (img.isNull())
                 continue;
 
-            images.push_back(m_channels[channelIndex][imageIndex]);
+            images.push_back(img);
         }
     }
 
-    ui->contentWidget->setImages(images);
+    image_utils::Window window;
+    window.level = ui->windowLevelSpin->value();
+    window.width = ui->windowWidthSpin->value();
+    ui->contentWidget->setImages(
+        image_utils::toDisplay(images, m_manualWindow ? &window : nullptr));
+}
+
+void ResultWidget::onWindowChanged() {
+    m_manualWindow = true;
+    updateImages();
+}
+
+void ResultWidget::onAutoWindowClicked() {
+    m_manualWindow = false;
+    showAutoWindow();
+    updateImages();
+}
+
+void ResultWidget::onImagesReady() {
+    if (m_autoWindowPending) {
+        showAutoWindow();
+    }
+    updateImages();
+}
+
+void ResultWidget::showAutoWindow() {
+    if (!m_source) {
+        return;
+    }
+
+    // Every image of a channel carries its window, any loaded one will do
+    auto channel = std::clamp(m_source->defaultChannel(), 0, m_source->channels() - 1);
+    auto image = m_source->cachedImage(channel, 0);
+    m_autoWindowPending = image.isNull();
+    if (m_autoWindowPending) {
+        return;
+    }
+    auto window = image_utils::window(image);
+    QSignalBlocker levelBlocker(ui->windowLevelSpin);
+    QSignalBlocker widthBlocker(ui->windowWidthSpin);
+    ui->windowLevelSpin->setValue(window.level);
+    ui->windowWidthSpin->setValue(window.width);
 }
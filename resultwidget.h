@@ -19,6 +19,9 @@ class ResultWidget;
  * @class ResultWidget
  * @brief 内置QImagesWidget，提供了可交互的接口
  * @details 接收一个Exam对象，展示Exam的相关数据(目前只实现了简单接口)
+ * Images come from the exam's IImageSource, only the checked ones are reconstructed, in
+ * the background, and shown once they are ready.
+ * The 16-bit reconstructions are kept, changing the window only rebuilds the 8-bit frames.
  */
 class ResultWidget : public QWidget {
     Q_OBJECT
@@ -33,12 +36,24 @@ public:
 public slots:
     void updateImages();
 
+private slots:
+    void onWindowChanged();
+    void onAutoWindowClicked();
+    /// The source loaded images requested by updateImages()
+    void onImagesReady();
+
 private:
-    QVector<QVector<QImage>> m_channels;
+    std::shared_ptr<IImageSource> m_source;
+    /// The window spin boxes override the auto window of every channel
+    bool m_manualWindow = false;
+    /// showAutoWindow() waits for the first image of the default channel
+    bool m_autoWindowPending = false;
 
     std::unique_ptr<Ui::ResultWidget> ui;
 
     void setupUi();
     void setupConnections();
+    /// Show the auto window of the first image in the spin boxes without applying it, once it is loaded
+    void showAutoWindow();
 };
 #endif // RESULTWIDGET_H
@@ -6,12 +6,47 @@
 
 #include "utils.h"
 #include "mrdresponse.h"
+#include "mrdstreamparser.h"
 #include "configmanager.h"
 #include "debugconfig.h"
 
 namespace {
+
+/**
+ * @brief Receive the channel files of an acquisition as the scanner streams them
+ * @details Each file is read in chunks, its header is checked as soon as it arrives and
+ * the footer is located without rescanning the data. prefix#N.mrd siblings of path are
+ * received as the other coils.
+ * @return nullptr if a file can not be read or is no valid MRD file
+ */
+std::shared_ptr<mrd_utils::MrdFileSet> receive(const QString &path)
+{
+    auto paths = mrd_utils::getAllChannelsFile(path);
+    if (paths.isEmpty()) {
+        paths = QStringList{path};
+    }
+
+    QVector<std::shared_ptr<const mrd_utils::MrdView>> views;
+    MrdStreamParser parser;
+    parser.setKeepStream(true);
+    for (const auto &channelPath : mrd_utils::sortChannelFiles(paths)) {
+        QFile file(channelPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            LOG_ERROR(QString("Failed to open file:%1 Error: %2").arg(channelPath, file.errorString()));
+            return nullptr;
+        }
+        parser.reset();
+        if (!parser.parse(&file)) {
+            LOG_ERROR(QString("Failed to receive %1: %2").arg(channelPath, parser.error()));
+            return nullptr;
+        }
+        views.push_back(parser.view());
+    }
+    return mrd_utils::MrdFileSet::fromViews(views);
 }
 
+} // namespace
+
 VScanner::VScanner(QObject *parent)
     : IScanner(parent), m_isConnected(false)
 {
@@ -45,15 +80,18 @@ void VScanner::scan(const ExamRequest& request) {
     // 返回扫描结果
     QString mockFilePath = config::Debug::mockFilePath();
     
-    QByteArray fileContent = file_utils::read(mockFilePath);
-    if (fileContent.isEmpty() && !mockFilePath.isEmpty()) {
+    std::shared_ptr<mrd_utils::MrdFileSet> files;
+    if (!mockFilePath.isEmpty()) {
+        files = receive(mockFilePath);
+    }
+    if (!files && !mockFilePath.isEmpty()) {
         LOG_ERROR(QString("Failed to read mock file from path: %1").arg(mockFilePath));
         // Handle error: maybe emit a completed signal with an error response
-    } else if (fileContent.isEmpty() && mockFilePath.isEmpty()) {
+    } else if (!files && mockFilePath.isEmpty()) {
         LOG_ERROR("Mock file path is empty and not configured. Cannot load mock data.");
     }
 
-    emit completed(new MrdResponse(fileContent));
+    emit completed(new MrdResponse(files));
 }
 
 /// @todo 应该中止扫描
@@ -1,5 +1,6 @@
 #include "scoutwidget.h"
 #include "configmanager.h"
+#include "imageutils.h"
 #include "utils.h"
 #include <QGraphicsPixmapItem>
 #include <QMatrix4x4>
@@ -109,7 +110,8 @@ void ScoutWidget::setScouts(QList<QImage> images, double fov,
 
     for (int i = 0; i < angles.length(); i++) {
         auto scout = std::make_shared<ScoutData>();
-        scout->image = images[i];
+        // Scouts are drawn with their auto window
+        scout->image = image_utils::toDisplay(images[i]);
         scout->angle = angles[i];
         scout->offset = offsets[i];
 
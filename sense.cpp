@@ -0,0 +1,423 @@
+#include "sense.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "parallelutils.h"
+#include "simdutils.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// Below this many samples the loops run on the calling thread only
+constexpr size_t kParallelMin = size_t(1) << 18;
+
+template <typename Real>
+using Volumes = typename mrd_utils::BasicMrd<Real>::Volumes;
+template <typename Real>
+using MutableVolumes = typename mrd_utils::BasicMrd<Real>::MutableVolumes;
+
+/// Call fn(block, view, partition) for every row of samples of volumes, large volumes in parallel
+template <typename T, typename F>
+void forRows(const nd_utils::NdArray<T, 4> &volumes, F &&fn) {
+    const int views = static_cast<int>(volumes.shape(1));
+    const int views2 = static_cast<int>(volumes.shape(2));
+    const int rows = static_cast<int>(volumes.shape(0)) * views * views2;
+    const int workers = volumes.size() < kParallelMin ? 1 : 0;
+    parallel_utils::parallelFor(0, rows, [&](int row) {
+        fn(row / (views * views2), (row / views2) % views, row % views2);
+    }, workers);
+}
+
+template <typename Real>
+bool sameShape(const QVector<mrd_utils::BasicMrd<Real>> &coils, bool transformed) {
+    if (coils.isEmpty()) {
+        return false;
+    }
+    const auto shape = coils.front().shape();
+    for (const auto &coil : coils) {
+        if (!coil.kdata || coil.transformed != transformed || coil.shape() != shape) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Slot of entry (m, k), m <= k, of the upper triangle of an n x n matrix
+constexpr int upper(int n, int m, int k) { return m * n - m * (m - 1) / 2 + (k - m); }
+
+/**
+ * @brief Solve the systems of one row of folded pixels, one lane per readout sample
+ * @details Arrays are [entry][lane], the loops over the lanes carry no dependencies
+ */
+template <typename Real>
+class RowSolver {
+public:
+    RowSolver(int acceleration, int lanes)
+        : m_n(acceleration), m_lanes(lanes), m_entries(acceleration * (acceleration + 1) / 2),
+          m_are(m_entries * lanes), m_aim(m_entries * lanes), m_bre(acceleration * lanes),
+          m_bim(acceleration * lanes) {}
+
+    /// Add one coil, s[m] is its sensitivity row of replica m, folded its folded row
+    void add(const fftw_utils::Complex<Real> *const *s, const fftw_utils::Complex<Real> *folded) {
+        for (int m = 0; m < m_n; m++) {
+            for (int k = m; k < m_n; k++) {
+                auto re = are(upper(m_n, m, k));
+                auto im = aim(upper(m_n, m, k));
+                auto sm = s[m];
+                auto sk = s[k];
+                for (int x = 0; x < m_lanes; x++) {
+                    re[x] += sm[x][0] * sk[x][0] + sm[x][1] * sk[x][1];
+                    im[x] += sm[x][0] * sk[x][1] - sm[x][1] * sk[x][0];
+                }
+            }
+            auto re = bre(m);
+            auto im = bim(m);
+            auto sm = s[m];
+            for (int x = 0; x < m_lanes; x++) {
+                re[x] += sm[x][0] * folded[x][0] + sm[x][1] * folded[x][1];
+                im[x] += sm[x][0] * folded[x][1] - sm[x][1] * folded[x][0];
+            }
+        }
+    }
+
+    /// Solve (A + lambda I) rho = b, out[m] receives the row of replica m
+    void solve(fftw_utils::Complex<Real> *const *out) {
+        // Tikhonov term from the mean diagonal, the smallest normal keeps unmasked pixels at 0
+        const auto regularization = static_cast<Real>(sense::kRegularization / m_n);
+        const auto floor = std::numeric_limits<Real>::min();
+        std::vector<Real> lambda(m_lanes, Real(0));
+        for (int m = 0; m < m_n; m++) {
+            auto diagonal = are(upper(m_n, m, m));
+            for (int x = 0; x < m_lanes; x++) {
+                lambda[x] += diagonal[x];
+            }
+        }
+        for (int m = 0; m < m_n; m++) {
+            auto diagonal = are(upper(m_n, m, m));
+            for (int x = 0; x < m_lanes; x++) {
+                diagonal[x] += regularization * lambda[x] + floor;
+            }
+        }
+
+        // Cholesky A = L L^H, L(i, j) overwrites slot (j, i) which only A(i, j) needed
+        for (int j = 0; j < m_n; j++) {
+            auto djj = are(upper(m_n, j, j));
+            for (int k = 0; k < j; k++) {
+                auto re = are(upper(m_n, k, j));
+                auto im = aim(upper(m_n, k, j));
+                for (int x = 0; x < m_lanes; x++) {
+                    djj[x] -= re[x] * re[x] + im[x] * im[x];
+                }
+            }
+            for (int x = 0; x < m_lanes; x++) {
+                djj[x] = std::sqrt(std::max(djj[x], floor));
+            }
+            for (int i = j + 1; i < m_n; i++) {
+                // A(i, j) = conj(A(j, i))
+                auto re = are(upper(m_n, j, i));
+                auto im = aim(upper(m_n, j, i));
+                for (int x = 0; x < m_lanes; x++) {
+                    im[x] = -im[x];
+                }
+                for (int k = 0; k < j; k++) {
+                    auto ire = are(upper(m_n, k, i));
+                    auto iim = aim(upper(m_n, k, i));
+                    auto jre = are(upper(m_n, k, j));
+                    auto jim = aim(upper(m_n, k, j));
+                    // L(i, k) conj(L(j, k))
+                    for (int x = 0; x < m_lanes; x++) {
+                        re[x] -= ire[x] * jre[x] + iim[x] * jim[x];
+                        im[x] -= iim[x] * jre[x] - ire[x] * jim[x];
+                    }
+                }
+                for (int x = 0; x < m_lanes; x++) {
+                    re[x] /= djj[x];
+                    im[x] /= djj[x];
+                }
+            }
+        }
+
+        // L y = b
+        for (int i = 0; i < m_n; i++) {
+            auto yre = bre(i);
+            auto yim = bim(i);
+            for (int k = 0; k < i; k++) {
+                auto lre = are(upper(m_n, k, i));
+                auto lim = aim(upper(m_n, k, i));
+                auto kre = bre(k);
+                auto kim = bim(k);
+                for (int x = 0; x < m_lanes; x++) {
+                    yre[x] -= lre[x] * kre[x] - lim[x] * kim[x];
+                    yim[x] -= lre[x] * kim[x] + lim[x] * kre[x];
+                }
+            }
+            auto dii = are(upper(m_n, i, i));
+            for (int x = 0; x < m_lanes; x++) {
+                yre[x] /= dii[x];
+                yim[x] /= dii[x];
+            }
+        }
+        // L^H rho = y
+        for (int i = m_n - 1; i >= 0; i--) {
+            auto yre = bre(i);
+            auto yim = bim(i);
+            for (int k = i + 1; k < m_n; k++) {
+                // conj(L(k, i))
+                auto lre = are(upper(m_n, i, k));
+                auto lim = aim(upper(m_n, i, k));
+                auto kre = bre(k);
+                auto kim = bim(k);
+                for (int x = 0; x < m_lanes; x++) {
+                    yre[x] -= lre[x] * kre[x] + lim[x] * kim[x];
+                    yim[x] -= lre[x] * kim[x] - lim[x] * kre[x];
+                }
+            }
+            // rho_i stays in b for the rows above
+            auto dii = are(upper(m_n, i, i));
+            auto dst = out[i];
+            for (int x = 0; x < m_lanes; x++) {
+                yre[x] /= dii[x];
+                yim[x] /= dii[x];
+                dst[x][0] = yre[x];
+                dst[x][1] = yim[x];
+            }
+        }
+    }
+
+private:
+    Real *are(int entry) { return m_are.data() + static_cast<size_t>(entry) * m_lanes; }
+    Real *aim(int entry) { return m_aim.data() + static_cast<size_t>(entry) * m_lanes; }
+    Real *bre(int m) { return m_bre.data() + static_cast<size_t>(m) * m_lanes; }
+    Real *bim(int m) { return m_bim.data() + static_cast<size_t>(m) * m_lanes; }
+
+    int m_n;
+    int m_lanes;
+    int m_entries;
+    std::vector<Real> m_are;
+    std::vector<Real> m_aim;
+    std::vector<Real> m_bre;
+    std::vector<Real> m_bim;
+};
+
+} // namespace
+
+namespace sense {
+
+template <typename Real>
+QVector<mrd_utils::BasicMrd<Real>> sensitivities(const QVector<mrd_utils::BasicMrd<Real>> &coils,
+                                                 const grappa::Sampling &sampling) {
+    if (!sameShape(coils, false) || coils.front().views != sampling.views ||
+        sampling.acsLines <= 0) {
+        LOG_ERROR("SENSE sensitivities need untransformed coils matching the sampling");
+        return {};
+    }
+
+    const int samples = coils.front().samples;
+    const int acsBegin = std::max(sampling.acsBegin(), sampling.first);
+    const int acsEnd = std::min(sampling.acsEnd(), sampling.last);
+    const double middle = (sampling.acsBegin() + sampling.acsEnd() - 1) / 2.0;
+    const double half = sampling.acsLines / 2.0;
+
+    QVector<mrd_utils::BasicMrd<Real>> maps;
+    for (const auto &coil : coils) {
+        const auto src = coil.volumes();
+        auto buffer = fftw_utils::createArray<Real>(src.size());
+        const auto dst = MutableVolumes<Real>::wrap(buffer.get(), src.shape());
+        forRows(src, [&](int block, int view, int partition) {
+            auto out = &dst(block, view, partition, 0);
+            if (view < acsBegin || view >= acsEnd) {
+                std::memset(out, 0, samples * sizeof(*out));
+                return;
+            }
+            auto weight = static_cast<Real>(0.5 * (1 + std::cos(kPi * (view - middle) / half)));
+            auto in = &src(block, view, partition, 0);
+            for (int x = 0; x < samples; x++) {
+                out[x][0] = in[x][0] * weight;
+                out[x][1] = in[x][1] * weight;
+            }
+        });
+
+        mrd_utils::BasicMrd<Real> map;
+        map.kdata = std::move(buffer);
+        map.experiments = coil.experiments;
+        map.echoes = coil.echoes;
+        map.slices = coil.slices;
+        map.views = coil.views;
+        map.views2 = coil.views2;
+        map.samples = coil.samples;
+        map.ppr = coil.ppr;
+        map.centred = coil.centred;
+        if (!map.transform()) {
+            return {};
+        }
+        maps.push_back(std::move(map));
+    }
+
+    // sum |lowres_c|^2, then every map is divided by its root inside the mask
+    const auto shape = maps.front().volumes().shape();
+    std::vector<Real> sums(nd_utils::NdArray<Real, 4>::count(shape), Real(0));
+    const auto norms = nd_utils::NdArray<Real, 4>::wrap(sums.data(), shape);
+    for (const auto &map : maps) {
+        const auto src = map.volumes();
+        forRows(src, [&](int block, int view, int partition) {
+            simd_utils::addNorm(&src(block, view, partition, 0), &norms(block, view, partition, 0),
+                                samples);
+        });
+    }
+    // The mask of a block follows its own peak, so a block gets the maps it would get alone
+    const size_t blockSize = sums.size() / shape[0];
+    std::vector<Real> thresholds;
+    for (auto begin = sums.begin(); begin != sums.end(); begin += blockSize) {
+        const Real peak = *std::max_element(begin, begin + blockSize);
+        thresholds.push_back(static_cast<Real>(kMaskThreshold * kMaskThreshold * peak));
+    }
+    for (auto &map : maps) {
+        const auto data = map.detachVolumes();
+        forRows(data, [&](int block, int view, int partition) {
+            auto row = &data(block, view, partition, 0);
+            auto norm = &norms(block, view, partition, 0);
+            const Real threshold = thresholds[block];
+            for (int x = 0; x < samples; x++) {
+                Real scale = norm[x] > threshold && norm[x] > 0 ? 1 / std::sqrt(norm[x]) : 0;
+                row[x][0] *= scale;
+                row[x][1] *= scale;
+            }
+        });
+    }
+    return maps;
+}
+
+bool canUnfold(int views, int acceleration) {
+    return acceleration > 0 && views % acceleration == 0 && (views / 2) % acceleration == 0;
+}
+
+template <typename Real>
+bool fold(mrd_utils::BasicMrd<Real> &coil, const grappa::Sampling &sampling) {
+    if (coil.transformed || coil.views != sampling.views) {
+        LOG_ERROR("SENSE folding needs untransformed k-space matching the sampling");
+        return false;
+    }
+    if (!canUnfold(coil.views, sampling.acceleration)) {
+        LOG_ERROR(QString("SENSE cannot fold acceleration %1 of %2 views through view %3")
+                      .arg(sampling.acceleration)
+                      .arg(coil.views)
+                      .arg(sampling.centre()));
+        return false;
+    }
+    const auto data = coil.detachVolumes();
+    if (data.empty()) {
+        return false;
+    }
+
+    // Keeping 1 of acceleration views scales every replica by 1 / acceleration, undo it
+    const int samples = coil.samples;
+    const auto scale = static_cast<Real>(sampling.acceleration);
+    forRows(data, [&](int block, int view, int partition) {
+        auto dst = &data(block, view, partition, 0);
+        if (view < sampling.first || view >= sampling.last || !sampling.isPattern(view)) {
+            std::memset(dst, 0, samples * sizeof(*dst));
+            return;
+        }
+        for (int x = 0; x < samples; x++) {
+            dst[x][0] *= scale;
+            dst[x][1] *= scale;
+        }
+    });
+    return coil.transform();
+}
+
+template <typename Real>
+mrd_utils::BasicMrd<Real> unfold(const QVector<mrd_utils::BasicMrd<Real>> &folded,
+                                 const QVector<mrd_utils::BasicMrd<Real>> &maps,
+                                 int acceleration) {
+    if (!sameShape(folded, true) || !sameShape(maps, true) || folded.size() != maps.size() ||
+        folded.front().shape() != maps.front().shape()) {
+        LOG_ERROR("SENSE unfolding needs transformed coils and sensitivities of the same shape");
+        return {};
+    }
+    const auto &first = folded.front();
+    if (acceleration < 2 || acceleration > kMaxAcceleration || !canUnfold(first.views, acceleration)) {
+        LOG_ERROR(QString("SENSE cannot unfold acceleration %1 of %2 views")
+                      .arg(acceleration)
+                      .arg(first.views));
+        return {};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Folded view y holds the replicas y + m * period, m < acceleration
+    const int period = first.views / acceleration;
+    const int coils = static_cast<int>(folded.size());
+    std::vector<Volumes<Real>> foldedVolumes;
+    std::vector<Volumes<Real>> mapVolumes;
+    for (int c = 0; c < coils; c++) {
+        foldedVolumes.push_back(folded[c].volumes());
+        mapVolumes.push_back(maps[c].volumes());
+    }
+    const auto shape = foldedVolumes.front().shape();
+    auto buffer = fftw_utils::createArray<Real>(foldedVolumes.front().size());
+    const auto out = MutableVolumes<Real>::wrap(buffer.get(), shape);
+    const int blocks = static_cast<int>(shape[0]);
+    const int tasks = blocks * period * first.views2;
+    const int workers = out.size() < kParallelMin ? 1 : 0;
+    parallel_utils::parallelFor(0, tasks, [&](int task) {
+        const int z = task % first.views2;
+        const int y = (task / first.views2) % period;
+        const int block = task / (first.views2 * period);
+
+        RowSolver<Real> solver(acceleration, first.samples);
+        const fftw_utils::Complex<Real> *rows[kMaxAcceleration];
+        for (int c = 0; c < coils; c++) {
+            for (int m = 0; m < acceleration; m++) {
+                rows[m] = &mapVolumes[c](block, y + m * period, z, 0);
+            }
+            solver.add(rows, &foldedVolumes[c](block, y, z, 0));
+        }
+
+        fftw_utils::Complex<Real> *targets[kMaxAcceleration];
+        for (int m = 0; m < acceleration; m++) {
+            targets[m] = &out(block, y + m * period, z, 0);
+        }
+        solver.solve(targets);
+    }, workers);
+
+    mrd_utils::BasicMrd<Real> result;
+    result.kdata = std::move(buffer);
+    result.experiments = first.experiments;
+    result.echoes = first.echoes;
+    result.slices = first.slices;
+    result.views = first.views;
+    result.views2 = first.views2;
+    result.samples = first.samples;
+    result.ppr = first.ppr;
+    result.centred = first.centred;
+    result.transformed = true;
+
+    LOG_DEBUG(QString("SENSE R=%1 of %2 coils, %3 blocks unfolded in %4 ms")
+                  .arg(acceleration)
+                  .arg(coils)
+                  .arg(blocks)
+                  .arg(timer.elapsed()));
+    return result;
+}
+
+template QVector<mrd_utils::BasicMrd<double>> sensitivities(const QVector<mrd_utils::BasicMrd<double>> &,
+                                                            const grappa::Sampling &);
+template QVector<mrd_utils::BasicMrd<float>> sensitivities(const QVector<mrd_utils::BasicMrd<float>> &,
+                                                           const grappa::Sampling &);
+template bool fold(mrd_utils::BasicMrd<double> &, const grappa::Sampling &);
+template bool fold(mrd_utils::BasicMrd<float> &, const grappa::Sampling &);
+template mrd_utils::BasicMrd<double> unfold(const QVector<mrd_utils::BasicMrd<double>> &,
+                                            const QVector<mrd_utils::BasicMrd<double>> &, int);
+template mrd_utils::BasicMrd<float> unfold(const QVector<mrd_utils::BasicMrd<float>> &,
+                                           const QVector<mrd_utils::BasicMrd<float>> &, int);
+
+} // namespace sense
@@ -0,0 +1,69 @@
+#ifndef SENSE_H
+#define SENSE_H
+
+#include <QVector>
+
+#include "grappa.h"
+#include "mrdutils.h"
+
+/**
+ * @brief Image domain SENSE reconstruction of k-space undersampled along the views
+ * @details Uses the sampling pattern of grappa::Sampling. The pattern views alone give coil
+ * images folded acceleration times along the views, the coil sensitivities estimated from the
+ * ACS band unfold them with one small least squares system per folded pixel.
+ */
+namespace sense {
+
+/// Largest acceleration unfold() supports, the systems are acceleration x acceleration
+constexpr int kMaxAcceleration = 8;
+/// Tikhonov weight relative to the mean diagonal of each system
+constexpr double kRegularization = 1e-3;
+/// Pixels whose combined low resolution magnitude is below this fraction of the peak of their block get no sensitivity
+constexpr double kMaskThreshold = 0.02;
+
+/**
+ * @brief Coil sensitivities from the ACS views, transformed like BasicMrd::transform
+ * @details Each coil's ACS band is tapered by a Hann window along the views and transformed,
+ * the low resolution images are then normalized to sum |s_c|^2 = 1 inside the mask
+ * @param coils Untransformed k-space of every coil, same shape
+ * @return Empty if the coils do not match or have no ACS views
+ */
+template <typename Real>
+QVector<mrd_utils::BasicMrd<Real>> sensitivities(const QVector<mrd_utils::BasicMrd<Real>> &coils,
+                                                 const grappa::Sampling &sampling);
+
+/**
+ * @brief Whether views acquired every acceleration-th view through the centre views / 2 fold
+ * into plain sums of acceleration replicas
+ * @details The replicas are views / acceleration apart, and only add up without a phase
+ * between them if the pattern also runs through view 0, i.e. views / 2 is on the pattern too
+ */
+bool canUnfold(int views, int acceleration);
+
+/**
+ * @brief Keep only the pattern views of the coil and transform it, copy on write
+ * @details The ACS views outside the pattern are dropped, otherwise the images are not
+ * periodic copies of each other and cannot be unfolded
+ * @return false, with the coil untouched, if canUnfold() does not hold
+ */
+template <typename Real>
+bool fold(mrd_utils::BasicMrd<Real> &coil, const grappa::Sampling &sampling);
+
+/**
+ * @brief Unfold the folded coil images into one image, a transformed Mrd
+ * @details The pixels are solved a readout row at a time, the systems of a row are laid out
+ * lane by lane so the Cholesky factorization is vectorized across the pixels. Rows of all
+ * blocks are spread over parallel_utils workers.
+ * @param folded fold() of every coil
+ * @param maps sensitivities() of the same coils
+ * @return Empty if the shapes differ, acceleration exceeds kMaxAcceleration or canUnfold()
+ * does not hold
+ */
+template <typename Real>
+mrd_utils::BasicMrd<Real> unfold(const QVector<mrd_utils::BasicMrd<Real>> &folded,
+                                 const QVector<mrd_utils::BasicMrd<Real>> &maps,
+                                 int acceleration);
+
+} // namespace sense
+
+#endif // SENSE_H
@@ -0,0 +1,814 @@
+#include "simdutils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_UTILS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts intrinsics of any instruction set without extra flags,
+// GCC and Clang need the target attribute on every function using them
+#if defined(SIMD_UTILS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+using simd_utils::Isa;
+
+Isa detect() {
+#if defined(SIMD_UTILS_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = info[3] & (1 << 26);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        // The OS must save the YMM registers on context switches
+        bool ymmEnabled = (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        avx2 = ymmEnabled && (info[1] & (1 << 5));
+    }
+#else
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse2 = __builtin_cpu_supports("sse2");
+#endif
+    if (avx2) {
+        return Isa::Avx2;
+    }
+    if (sse2) {
+        return Isa::Sse2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+std::atomic<int> s_activeIsa{-1};
+
+template <typename T, typename Real>
+void toComplexScalar(const T *src, Real (*dst)[2], size_t n, bool isComplex) {
+    if (isComplex) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i][0] = static_cast<Real>(src[2 * i]);
+            dst[i][1] = static_cast<Real>(src[2 * i + 1]);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dst[i][0] = static_cast<Real>(src[i]);
+            dst[i][1] = 0;
+        }
+    }
+}
+
+template <typename Real>
+Real maxNormScalar(const Real (*src)[2], size_t n) {
+    Real peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        peak = std::max(peak, src[i][0] * src[i][0] + src[i][1] * src[i][1]);
+    }
+    return peak;
+}
+
+template <typename Real>
+void magnitudeToGray16Scalar(const Real (*src)[2], std::uint16_t *dst, size_t n, Real scale) {
+    for (size_t i = 0; i < n; i++) {
+        auto value = std::sqrt(src[i][0] * src[i][0] + src[i][1] * src[i][1]) * scale;
+        dst[i] = static_cast<std::uint16_t>(std::min(value, Real(65535)));
+    }
+}
+
+template <typename Real>
+void addNormScalar(const Real (*src)[2], Real *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] += src[i][0] * src[i][0] + src[i][1] * src[i][1];
+    }
+}
+
+template <typename Real>
+void addConjugateProductScalar(const Real (*a)[2], const Real (*b)[2], Real (*dst)[2], size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i][0] += a[i][0] * b[i][0] + a[i][1] * b[i][1];
+        dst[i][1] += a[i][0] * b[i][1] - a[i][1] * b[i][0];
+    }
+}
+
+#if defined(SIMD_UTILS_X86)
+
+/// Widen 4 consecutive scalars to doubles
+TARGET_AVX2 inline __m256d load4Avx2(const std::int16_t *p) {
+    auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(v));
+}
+
+TARGET_AVX2 inline __m256d load4Avx2(const std::int32_t *p) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+TARGET_AVX2 inline __m256d load4Avx2(const float *p) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+/// [a b c d] -> [a 0 b 0 c 0 d 0]
+TARGET_AVX2 inline void storeReal4Avx2(double *dst, __m256d v) {
+    auto zero = _mm256_setzero_pd();
+    auto lo = _mm256_unpacklo_pd(v, zero); // [a 0 c 0]
+    auto hi = _mm256_unpackhi_pd(v, zero); // [b 0 d 0]
+    _mm256_storeu_pd(dst, _mm256_permute2f128_pd(lo, hi, 0x20));
+    _mm256_storeu_pd(dst + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+}
+
+template <typename T>
+TARGET_AVX2 void toComplexAvx2(const T *src, fftw_complex *dst, size_t n, bool isComplex) {
+    auto out = reinterpret_cast<double *>(dst);
+    if (isComplex) {
+        // Real and imaginary parts are already interleaved, only widen
+        size_t m = 2 * n;
+        size_t i = 0;
+        for (; i + 4 <= m; i += 4) {
+            _mm256_storeu_pd(out + i, load4Avx2(src + i));
+        }
+        for (; i < m; i++) {
+            out[i] = src[i];
+        }
+    } else {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            storeReal4Avx2(out + 2 * i, load4Avx2(src + i));
+        }
+        for (; i < n; i++) {
+            out[2 * i] = src[i];
+            out[2 * i + 1] = 0;
+        }
+    }
+}
+
+/// Widen 2 consecutive scalars to doubles
+TARGET_SSE2 inline __m128d load2Sse2(const std::int16_t *p) {
+    std::int32_t pair;
+    std::memcpy(&pair, p, sizeof(pair));
+    auto v = _mm_cvtsi32_si128(pair);
+    // Sign extend int16 to int32, SSE2 has no cvtepi16
+    auto v32 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    return _mm_cvtepi32_pd(v32);
+}
+
+TARGET_SSE2 inline __m128d load2Sse2(const std::int32_t *p) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+TARGET_SSE2 inline __m128d load2Sse2(const float *p) {
+    auto v = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    return _mm_cvtps_pd(v);
+}
+
+template <typename T>
+TARGET_SSE2 void toComplexSse2(const T *src, fftw_complex *dst, size_t n, bool isComplex) {
+    auto out = reinterpret_cast<double *>(dst);
+    if (isComplex) {
+        size_t m = 2 * n;
+        size_t i = 0;
+        for (; i + 2 <= m; i += 2) {
+            _mm_storeu_pd(out + i, load2Sse2(src + i));
+        }
+        for (; i < m; i++) {
+            out[i] = src[i];
+        }
+    } else {
+        auto zero = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            auto v = load2Sse2(src + i);
+            _mm_storeu_pd(out + 2 * i, _mm_unpacklo_pd(v, zero));
+            _mm_storeu_pd(out + 2 * i + 2, _mm_unpackhi_pd(v, zero));
+        }
+        for (; i < n; i++) {
+            out[2 * i] = src[i];
+            out[2 * i + 1] = 0;
+        }
+    }
+}
+
+/// Convert 8 consecutive scalars to floats
+TARGET_AVX2 inline __m256 load8Avx2(const std::int16_t *p) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+}
+
+TARGET_AVX2 inline __m256 load8Avx2(const std::int32_t *p) {
+    return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+
+TARGET_AVX2 inline __m256 load8Avx2(const float *p) {
+    return _mm256_loadu_ps(p);
+}
+
+/// [a b c d e f g h] -> [a 0 b 0 c 0 d 0 e 0 f 0 g 0 h 0]
+TARGET_AVX2 inline void storeReal8Avx2(float *dst, __m256 v) {
+    auto zero = _mm256_setzero_ps();
+    auto lo = _mm256_unpacklo_ps(v, zero); // [a 0 b 0 | e 0 f 0]
+    auto hi = _mm256_unpackhi_ps(v, zero); // [c 0 d 0 | g 0 h 0]
+    _mm256_storeu_ps(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+template <typename T>
+TARGET_AVX2 void toComplexAvx2(const T *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    auto out = reinterpret_cast<float *>(dst);
+    if (isComplex) {
+        size_t m = 2 * n;
+        size_t i = 0;
+        for (; i + 8 <= m; i += 8) {
+            _mm256_storeu_ps(out + i, load8Avx2(src + i));
+        }
+        for (; i < m; i++) {
+            out[i] = static_cast<float>(src[i]);
+        }
+    } else {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            storeReal8Avx2(out + 2 * i, load8Avx2(src + i));
+        }
+        for (; i < n; i++) {
+            out[2 * i] = static_cast<float>(src[i]);
+            out[2 * i + 1] = 0;
+        }
+    }
+}
+
+/// Convert 4 consecutive scalars to floats
+TARGET_SSE2 inline __m128 load4Sse2(const std::int16_t *p) {
+    auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    auto v32 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    return _mm_cvtepi32_ps(v32);
+}
+
+TARGET_SSE2 inline __m128 load4Sse2(const std::int32_t *p) {
+    return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+TARGET_SSE2 inline __m128 load4Sse2(const float *p) {
+    return _mm_loadu_ps(p);
+}
+
+template <typename T>
+TARGET_SSE2 void toComplexSse2(const T *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    auto out = reinterpret_cast<float *>(dst);
+    if (isComplex) {
+        size_t m = 2 * n;
+        size_t i = 0;
+        for (; i + 4 <= m; i += 4) {
+            _mm_storeu_ps(out + i, load4Sse2(src + i));
+        }
+        for (; i < m; i++) {
+            out[i] = static_cast<float>(src[i]);
+        }
+    } else {
+        auto zero = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            auto v = load4Sse2(src + i);
+            _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(v, zero));
+            _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(v, zero));
+        }
+        for (; i < n; i++) {
+            out[2 * i] = static_cast<float>(src[i]);
+            out[2 * i + 1] = 0;
+        }
+    }
+}
+
+/// Squared magnitudes of 4 consecutive samples, in order
+TARGET_AVX2 inline __m256d norm4Avx2(const double *p) {
+    auto a = _mm256_loadu_pd(p);
+    auto b = _mm256_loadu_pd(p + 4);
+    // [n0 n2 | n1 n3] -> [n0 n1 n2 n3]
+    auto sums = _mm256_hadd_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));
+    return _mm256_permute4x64_pd(sums, 0xd8);
+}
+
+/// Squared magnitudes of 8 consecutive samples, in order
+TARGET_AVX2 inline __m256 norm8Avx2(const float *p) {
+    auto a = _mm256_loadu_ps(p);
+    auto b = _mm256_loadu_ps(p + 8);
+    // [n0 n1 n4 n5 | n2 n3 n6 n7] -> [n0 ... n7]
+    auto sums = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+    return _mm256_permutevar8x32_ps(sums, _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+}
+
+TARGET_AVX2 double maxNormAvx2(const fftw_complex *src, size_t n) {
+    auto in = reinterpret_cast<const double *>(src);
+    auto peak = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        peak = _mm256_max_pd(peak, norm4Avx2(in + 2 * i));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, peak);
+    auto result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return std::max(result, maxNormScalar(src + i, n - i));
+}
+
+TARGET_AVX2 float maxNormAvx2(const fftwf_complex *src, size_t n) {
+    auto in = reinterpret_cast<const float *>(src);
+    auto peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        peak = _mm256_max_ps(peak, norm8Avx2(in + 2 * i));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, peak);
+    auto result = *std::max_element(lanes, lanes + 8);
+    return std::max(result, maxNormScalar(src + i, n - i));
+}
+
+TARGET_AVX2 void magnitudeToGray16Avx2(const fftw_complex *src, std::uint16_t *dst, size_t n,
+                                       double scale) {
+    auto in = reinterpret_cast<const double *>(src);
+    auto factor = _mm256_set1_pd(scale);
+    auto limit = _mm256_set1_pd(65535);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto lo = _mm256_min_pd(_mm256_mul_pd(_mm256_sqrt_pd(norm4Avx2(in + 2 * i)), factor), limit);
+        auto hi = _mm256_min_pd(_mm256_mul_pd(_mm256_sqrt_pd(norm4Avx2(in + 2 * i + 8)), factor), limit);
+        auto words = _mm_packus_epi32(_mm256_cvttpd_epi32(lo), _mm256_cvttpd_epi32(hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), words);
+    }
+    magnitudeToGray16Scalar(src + i, dst + i, n - i, scale);
+}
+
+TARGET_AVX2 void magnitudeToGray16Avx2(const fftwf_complex *src, std::uint16_t *dst, size_t n,
+                                       float scale) {
+    auto in = reinterpret_cast<const float *>(src);
+    auto factor = _mm256_set1_ps(scale);
+    auto limit = _mm256_set1_ps(65535);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto value = _mm256_min_ps(_mm256_mul_ps(_mm256_sqrt_ps(norm8Avx2(in + 2 * i)), factor), limit);
+        auto ints = _mm256_cvttps_epi32(value);
+        auto words = _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), words);
+    }
+    magnitudeToGray16Scalar(src + i, dst + i, n - i, scale);
+}
+
+/// Store 4 int32 in [0, 65535] as uint16, SSE2 only has the signed 32 -> 16 bit pack
+TARGET_SSE2 inline void storeUnsigned16Sse2(std::uint16_t *dst, __m128i ints) {
+    auto bias = _mm_set1_epi32(32768);
+    auto words = _mm_packs_epi32(_mm_sub_epi32(ints, bias), _mm_setzero_si128());
+    words = _mm_xor_si128(words, _mm_set1_epi16(static_cast<short>(0x8000)));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), words);
+}
+
+/// Squared magnitudes of 2 consecutive samples
+TARGET_SSE2 inline __m128d norm2Sse2(const double *p) {
+    auto a = _mm_loadu_pd(p);
+    auto b = _mm_loadu_pd(p + 2);
+    a = _mm_mul_pd(a, a);
+    b = _mm_mul_pd(b, b);
+    return _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+}
+
+/// Squared magnitudes of 4 consecutive samples
+TARGET_SSE2 inline __m128 norm4Sse2(const float *p) {
+    auto a = _mm_loadu_ps(p);
+    auto b = _mm_loadu_ps(p + 4);
+    a = _mm_mul_ps(a, a);
+    b = _mm_mul_ps(b, b);
+    return _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                      _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+TARGET_SSE2 double maxNormSse2(const fftw_complex *src, size_t n) {
+    auto in = reinterpret_cast<const double *>(src);
+    auto peak = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        peak = _mm_max_pd(peak, norm2Sse2(in + 2 * i));
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, peak);
+    return std::max(std::max(lanes[0], lanes[1]), maxNormScalar(src + i, n - i));
+}
+
+TARGET_SSE2 float maxNormSse2(const fftwf_complex *src, size_t n) {
+    auto in = reinterpret_cast<const float *>(src);
+    auto peak = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        peak = _mm_max_ps(peak, norm4Sse2(in + 2 * i));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, peak);
+    auto result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return std::max(result, maxNormScalar(src + i, n - i));
+}
+
+TARGET_SSE2 void magnitudeToGray16Sse2(const fftw_complex *src, std::uint16_t *dst, size_t n,
+                                       double scale) {
+    auto in = reinterpret_cast<const double *>(src);
+    auto factor = _mm_set1_pd(scale);
+    auto limit = _mm_set1_pd(65535);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto lo = _mm_min_pd(_mm_mul_pd(_mm_sqrt_pd(norm2Sse2(in + 2 * i)), factor), limit);
+        auto hi = _mm_min_pd(_mm_mul_pd(_mm_sqrt_pd(norm2Sse2(in + 2 * i + 4)), factor), limit);
+        storeUnsigned16Sse2(dst + i, _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi)));
+    }
+    magnitudeToGray16Scalar(src + i, dst + i, n - i, scale);
+}
+
+TARGET_SSE2 void magnitudeToGray16Sse2(const fftwf_complex *src, std::uint16_t *dst, size_t n,
+                                       float scale) {
+    auto in = reinterpret_cast<const float *>(src);
+    auto factor = _mm_set1_ps(scale);
+    auto limit = _mm_set1_ps(65535);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto value = _mm_min_ps(_mm_mul_ps(_mm_sqrt_ps(norm4Sse2(in + 2 * i)), factor), limit);
+        storeUnsigned16Sse2(dst + i, _mm_cvttps_epi32(value));
+    }
+    magnitudeToGray16Scalar(src + i, dst + i, n - i, scale);
+}
+
+TARGET_AVX2 void addNormAvx2(const fftw_complex *src, double *dst, size_t n) {
+    auto in = reinterpret_cast<const double *>(src);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), norm4Avx2(in + 2 * i)));
+    }
+    addNormScalar(src + i, dst + i, n - i);
+}
+
+TARGET_AVX2 void addNormAvx2(const fftwf_complex *src, float *dst, size_t n) {
+    auto in = reinterpret_cast<const float *>(src);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), norm8Avx2(in + 2 * i)));
+    }
+    addNormScalar(src + i, dst + i, n - i);
+}
+
+// conj(a) b = (ar br + ai bi) + i (ar bi - ai br). With t = a b and u = a swap(b),
+// the real part is t + swap(t) in the even lanes and the imaginary part swap(u) - u in the odd ones
+
+TARGET_AVX2 void addConjugateProductAvx2(const fftw_complex *a, const fftw_complex *b,
+                                         fftw_complex *dst, size_t n) {
+    auto pa = reinterpret_cast<const double *>(a);
+    auto pb = reinterpret_cast<const double *>(b);
+    auto out = reinterpret_cast<double *>(dst);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto va = _mm256_loadu_pd(pa + 2 * i);
+        auto vb = _mm256_loadu_pd(pb + 2 * i);
+        auto t = _mm256_mul_pd(va, vb);
+        auto u = _mm256_mul_pd(va, _mm256_permute_pd(vb, 0x5));
+        auto re = _mm256_add_pd(t, _mm256_permute_pd(t, 0x5));
+        auto im = _mm256_sub_pd(_mm256_permute_pd(u, 0x5), u);
+        auto sum = _mm256_add_pd(_mm256_loadu_pd(out + 2 * i), _mm256_blend_pd(re, im, 0xa));
+        _mm256_storeu_pd(out + 2 * i, sum);
+    }
+    addConjugateProductScalar(a + i, b + i, dst + i, n - i);
+}
+
+TARGET_AVX2 void addConjugateProductAvx2(const fftwf_complex *a, const fftwf_complex *b,
+                                         fftwf_complex *dst, size_t n) {
+    auto pa = reinterpret_cast<const float *>(a);
+    auto pb = reinterpret_cast<const float *>(b);
+    auto out = reinterpret_cast<float *>(dst);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto va = _mm256_loadu_ps(pa + 2 * i);
+        auto vb = _mm256_loadu_ps(pb + 2 * i);
+        auto t = _mm256_mul_ps(va, vb);
+        auto u = _mm256_mul_ps(va, _mm256_permute_ps(vb, 0xb1));
+        auto re = _mm256_add_ps(t, _mm256_permute_ps(t, 0xb1));
+        auto im = _mm256_sub_ps(_mm256_permute_ps(u, 0xb1), u);
+        auto sum = _mm256_add_ps(_mm256_loadu_ps(out + 2 * i), _mm256_blend_ps(re, im, 0xaa));
+        _mm256_storeu_ps(out + 2 * i, sum);
+    }
+    addConjugateProductScalar(a + i, b + i, dst + i, n - i);
+}
+
+TARGET_SSE2 void addNormSse2(const fftw_complex *src, double *dst, size_t n) {
+    auto in = reinterpret_cast<const double *>(src);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), norm2Sse2(in + 2 * i)));
+    }
+    addNormScalar(src + i, dst + i, n - i);
+}
+
+TARGET_SSE2 void addNormSse2(const fftwf_complex *src, float *dst, size_t n) {
+    auto in = reinterpret_cast<const float *>(src);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), norm4Sse2(in + 2 * i)));
+    }
+    addNormScalar(src + i, dst + i, n - i);
+}
+
+TARGET_SSE2 void addConjugateProductSse2(const fftw_complex *a, const fftw_complex *b,
+                                         fftw_complex *dst, size_t n) {
+    auto pa = reinterpret_cast<const double *>(a);
+    auto pb = reinterpret_cast<const double *>(b);
+    auto out = reinterpret_cast<double *>(dst);
+    for (size_t i = 0; i < n; i++) {
+        auto va = _mm_loadu_pd(pa + 2 * i);
+        auto vb = _mm_loadu_pd(pb + 2 * i);
+        auto t = _mm_mul_pd(va, vb);
+        auto u = _mm_mul_pd(va, _mm_shuffle_pd(vb, vb, 1));
+        auto re = _mm_add_pd(t, _mm_shuffle_pd(t, t, 1));
+        auto im = _mm_sub_pd(_mm_shuffle_pd(u, u, 1), u);
+        _mm_storeu_pd(out + 2 * i, _mm_add_pd(_mm_loadu_pd(out + 2 * i), _mm_move_sd(im, re)));
+    }
+}
+
+TARGET_SSE2 void addConjugateProductSse2(const fftwf_complex *a, const fftwf_complex *b,
+                                         fftwf_complex *dst, size_t n) {
+    auto pa = reinterpret_cast<const float *>(a);
+    auto pb = reinterpret_cast<const float *>(b);
+    auto out = reinterpret_cast<float *>(dst);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto va = _mm_loadu_ps(pa + 2 * i);
+        auto vb = _mm_loadu_ps(pb + 2 * i);
+        auto t = _mm_mul_ps(va, vb);
+        auto u = _mm_mul_ps(va, _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1)));
+        auto re = _mm_add_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+        auto im = _mm_sub_ps(_mm_shuffle_ps(u, u, _MM_SHUFFLE(2, 3, 0, 1)), u);
+        // [re0 re1 im0 im1] -> [re0 im0 re1 im1]
+        auto packed = _mm_shuffle_ps(re, im, _MM_SHUFFLE(3, 1, 2, 0));
+        packed = _mm_shuffle_ps(packed, packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_loadu_ps(out + 2 * i), packed));
+    }
+    addConjugateProductScalar(a + i, b + i, dst + i, n - i);
+}
+
+#endif // SIMD_UTILS_X86
+
+template <typename T, typename Real>
+void toComplexDispatch(const T *src, Real (*dst)[2], size_t n, bool isComplex) {
+#if defined(SIMD_UTILS_X86)
+    switch (simd_utils::activeIsa()) {
+    case Isa::Avx2:
+        toComplexAvx2(src, dst, n, isComplex);
+        return;
+    case Isa::Sse2:
+        toComplexSse2(src, dst, n, isComplex);
+        return;
+    default:
+        break;
+    }
+#endif
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+} // namespace
+
+namespace simd_utils {
+
+Isa detectedIsa() {
+    static const Isa s_isa = detect();
+    return s_isa;
+}
+
+Isa activeIsa() {
+    auto isa = s_activeIsa.load(std::memory_order_relaxed);
+    if (isa < 0) {
+        return detectedIsa();
+    }
+    return static_cast<Isa>(isa);
+}
+
+void setActiveIsa(Isa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(detectedIsa())) {
+        isa = detectedIsa();
+    }
+    s_activeIsa.store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+const char *isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2:
+        return "AVX2";
+    case Isa::Sse2:
+        return "SSE2";
+    default:
+        return "Scalar";
+    }
+}
+
+void toComplex(const std::uint8_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int8_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::uint16_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int16_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const std::uint32_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int32_t *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const float *src, fftw_complex *dst, size_t n, bool isComplex) {
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const double *src, fftw_complex *dst, size_t n, bool isComplex) {
+    if (isComplex) {
+        std::memcpy(dst, src, n * sizeof(fftw_complex));
+        return;
+    }
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::uint8_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int8_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::uint16_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int16_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const std::uint32_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+void toComplex(const std::int32_t *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const float *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    if (isComplex) {
+        std::memcpy(dst, src, n * sizeof(fftwf_complex));
+        return;
+    }
+    toComplexDispatch(src, dst, n, isComplex);
+}
+
+void toComplex(const double *src, fftwf_complex *dst, size_t n, bool isComplex) {
+    toComplexScalar(src, dst, n, isComplex);
+}
+
+double maxNorm(const fftw_complex *src, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        return maxNormAvx2(src, n);
+    case Isa::Sse2:
+        return maxNormSse2(src, n);
+    default:
+        break;
+    }
+#endif
+    return maxNormScalar(src, n);
+}
+
+float maxNorm(const fftwf_complex *src, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        return maxNormAvx2(src, n);
+    case Isa::Sse2:
+        return maxNormSse2(src, n);
+    default:
+        break;
+    }
+#endif
+    return maxNormScalar(src, n);
+}
+
+void magnitudeToGray16(const fftw_complex *src, std::uint16_t *dst, size_t n, double scale) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        magnitudeToGray16Avx2(src, dst, n, scale);
+        return;
+    case Isa::Sse2:
+        magnitudeToGray16Sse2(src, dst, n, scale);
+        return;
+    default:
+        break;
+    }
+#endif
+    magnitudeToGray16Scalar(src, dst, n, scale);
+}
+
+void magnitudeToGray16(const fftwf_complex *src, std::uint16_t *dst, size_t n, float scale) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        magnitudeToGray16Avx2(src, dst, n, scale);
+        return;
+    case Isa::Sse2:
+        magnitudeToGray16Sse2(src, dst, n, scale);
+        return;
+    default:
+        break;
+    }
+#endif
+    magnitudeToGray16Scalar(src, dst, n, scale);
+}
+
+void addNorm(const fftw_complex *src, double *dst, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        addNormAvx2(src, dst, n);
+        return;
+    case Isa::Sse2:
+        addNormSse2(src, dst, n);
+        return;
+    default:
+        break;
+    }
+#endif
+    addNormScalar(src, dst, n);
+}
+
+void addNorm(const fftwf_complex *src, float *dst, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        addNormAvx2(src, dst, n);
+        return;
+    case Isa::Sse2:
+        addNormSse2(src, dst, n);
+        return;
+    default:
+        break;
+    }
+#endif
+    addNormScalar(src, dst, n);
+}
+
+void addConjugateProduct(const fftw_complex *a, const fftw_complex *b, fftw_complex *dst, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        addConjugateProductAvx2(a, b, dst, n);
+        return;
+    case Isa::Sse2:
+        addConjugateProductSse2(a, b, dst, n);
+        return;
+    default:
+        break;
+    }
+#endif
+    addConjugateProductScalar(a, b, dst, n);
+}
+
+void addConjugateProduct(const fftwf_complex *a, const fftwf_complex *b, fftwf_complex *dst, size_t n) {
+#if defined(SIMD_UTILS_X86)
+    switch (activeIsa()) {
+    case Isa::Avx2:
+        addConjugateProductAvx2(a, b, dst, n);
+        return;
+    case Isa::Sse2:
+        addConjugateProductSse2(a, b, dst, n);
+        return;
+    default:
+        break;
+    }
+#endif
+    addConjugateProductScalar(a, b, dst, n);
+}
+
+} // namespace simd_utils
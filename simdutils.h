@@ -0,0 +1,75 @@
+#ifndef SIMDUTILS_H
+#define SIMDUTILS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fftwcompat.h"
+
+/**
+ * @brief Vectorized conversion kernels from raw MRD samples to fftw_complex/fftwf_complex
+ * and from reconstructed images to 16-bit pixels, plus the coil combination accumulators
+ * @details The instruction set is detected once at runtime (AVX2, SSE2 or scalar),
+ * int16/int32/float have SIMD kernels, the other datatypes use the scalar loop.
+ */
+namespace simd_utils {
+
+enum class Isa { Scalar = 0, Sse2, Avx2 };
+
+/// Best instruction set supported by the running CPU
+Isa detectedIsa();
+
+/// Instruction set used by toComplex, defaults to detectedIsa()
+Isa activeIsa();
+
+/// Restrict the kernels to an instruction set, values above detectedIsa() are clamped
+void setActiveIsa(Isa isa);
+
+const char *isaName(Isa isa);
+
+/**
+ * @brief 将n个采样点转换为fftw_complex
+ * @param src isComplex时包含2n个标量(实部、虚部交替)，否则包含n个实数
+ * @param dst 至少n个元素
+ */
+void toComplex(const std::uint8_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int8_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::uint16_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int16_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::uint32_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int32_t *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const float *src, fftw_complex *dst, size_t n, bool isComplex);
+void toComplex(const double *src, fftw_complex *dst, size_t n, bool isComplex);
+
+/// Single precision variants, used by the fftwf reconstruction path
+void toComplex(const std::uint8_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int8_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::uint16_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int16_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::uint32_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const std::int32_t *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const float *src, fftwf_complex *dst, size_t n, bool isComplex);
+void toComplex(const double *src, fftwf_complex *dst, size_t n, bool isComplex);
+
+/// Largest squared magnitude re^2 + im^2 of n samples, 0 if n is 0
+double maxNorm(const fftw_complex *src, size_t n);
+float maxNorm(const fftwf_complex *src, size_t n);
+
+/**
+ * @brief dst[i] = min(|src[i]| * scale, 65535), truncated like static_cast<uint16_t>
+ * @param scale 65535 / peak magnitude, so the brightest sample maps to 65535
+ */
+void magnitudeToGray16(const fftw_complex *src, std::uint16_t *dst, size_t n, double scale);
+void magnitudeToGray16(const fftwf_complex *src, std::uint16_t *dst, size_t n, float scale);
+
+/// dst[i] += re^2 + im^2, accumulates the squared magnitude of one coil
+void addNorm(const fftw_complex *src, double *dst, size_t n);
+void addNorm(const fftwf_complex *src, float *dst, size_t n);
+
+/// dst[i] += conj(a[i]) * b[i]
+void addConjugateProduct(const fftw_complex *a, const fftw_complex *b, fftw_complex *dst, size_t n);
+void addConjugateProduct(const fftwf_complex *a, const fftwf_complex *b, fftwf_complex *dst, size_t n);
+
+} // namespace simd_utils
+
+#endif // SIMDUTILS_H
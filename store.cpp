@@ -1,7 +1,9 @@
 #include "store.h"
 
 #include <QDir>
+#include <QElapsedTimer>
 
+#include "debugconfig.h"
 #include "mrdresponse.h"
 #include "utils.h"
 
@@ -11,6 +13,7 @@ const auto kRootDir = "./patients";
 
 const auto kRequestFileName = "request.json";
 const auto kResponseFileName = "response.mrd";
+const auto kArchiveFileName = "response.mrdz";
 const auto kExamInfoFileName = "info.json";
 const auto kPatientInfoFileName = "patient.json";
 
@@ -27,6 +30,10 @@ QString respFilePath(const QString &pid, const QString &eid) {
     return QString("%1/%2").arg(store::edir(pid, eid), kResponseFileName);
 }
 
+QString archiveFilePath(const QString &pid, const QString &eid) {
+    return QString("%1/%2").arg(store::edir(pid, eid), kArchiveFileName);
+}
+
 QString examInfoFilePath(const QString &pid, const QString &eid) {
     return QString("%1/%2").arg(store::edir(pid, eid), kExamInfoFileName);
 }
@@ -44,16 +51,52 @@ void saveExamRequest(const QString &pid, const QString &eid,
 }
 
 IExamResponse *loadResponse(const QString &pid, const QString &eid) {
+    if (auto archive = store::openResponseArchive(pid, eid)) {
+        // Blocks are decompressed when they are reconstructed, not when the exam is opened
+        return new MrdResponse(mrd_utils::MrdFileSet::fromArchive(archive));
+    }
+
     auto fpath = respFilePath(pid, eid);
 
     /// @note In the future, need to determine which implementation to return based on file content
-    return new MrdResponse(file_utils::read(fpath));
+    return new MrdResponse(mrd_utils::MrdView::open(fpath));
 }
 
 void saveResponse(const QString &pid, const QString &eid, IExamResponse *resp) {
     auto fpath = respFilePath(pid, eid);
+    auto apath = archiveFilePath(pid, eid);
+    auto bytes = resp->bytes();
+
+    std::shared_ptr<mrd_utils::MrdView> view;
+    if (config::Debug::compressResponses()) {
+        view = mrd_utils::MrdView::fromBytes(bytes);
+    }
+    if (!view) {
+        // The other form is only removed once this one is safely on disk
+        if (!file_utils::save(fpath, bytes)) {
+            LOG_ERROR(QString("Failed to save scan data of pid: %1, eid: %2, keeping the stored copy")
+                          .arg(pid, eid));
+            return;
+        }
+        QFile::remove(apath);
+        return;
+    }
 
-    file_utils::save(fpath, resp->bytes());
+    QElapsedTimer timer;
+    timer.start();
+    auto archive = mrd_utils::MrdArchive::compress(*view);
+    LOG_INFO(QString("Compressed scan data %1 -> %2 bytes (ratio %3) in %4 ms")
+                 .arg(bytes.size())
+                 .arg(archive.size())
+                 .arg(static_cast<double>(bytes.size()) / std::max<qsizetype>(archive.size(), 1), 0, 'f', 2)
+                 .arg(timer.elapsed()));
+
+    if (archive.isEmpty() || !file_utils::save(apath, archive)) {
+        LOG_ERROR(QString("Failed to save compressed scan data of pid: %1, eid: %2, keeping the stored copy")
+                      .arg(pid, eid));
+        return;
+    }
+    QFile::remove(fpath);
 }
 
 void loadExamInfo(Exam &exam, const QString &pid, const QString &eid) {
@@ -146,6 +189,21 @@ void saveExam(const Exam &exam) {
     saveExamInfo(exam);
 }
 
+mrd_utils::MrdInfo probeResponse(const QString &pid, const QString &eid) {
+    if (auto archive = openResponseArchive(pid, eid)) {
+        return archive->info();
+    }
+    return mrd_utils::probe(respFilePath(pid, eid));
+}
+
+std::shared_ptr<mrd_utils::MrdArchive> openResponseArchive(const QString &pid, const QString &eid) {
+    auto apath = archiveFilePath(pid, eid);
+    if (!QFile::exists(apath)) {
+        return nullptr;
+    }
+    return mrd_utils::MrdArchive::open(apath);
+}
+
 QStringList patientEntries(){
     QDir root(kRootDir);
     return root.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
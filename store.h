@@ -2,6 +2,8 @@
 #define STORE_H
 
 #include "exam.h"
+#include "mrdarchive.h"
+#include "mrdutils.h"
 #include "patient.h"
 
 /**
@@ -14,7 +16,7 @@
  *     - patientInfo.json Store patient information
  *     - examId Each scan corresponds to a folder
  *       - request.json Scan parameters
- *       - response.mrd Scan result data
+ *       - response.mrd Scan result data, or response.mrdz when compression is enabled in the Debug preferences
  *       - info.json
 Other information, such as scan ID, start and end events, etc., and the file will contain a complete copy of patient information
  *
@@ -45,6 +47,12 @@ Exam loadExam(const QString &pid, const QString &eid);
 /// Save scan record
 void saveExam(const Exam &exam);
 
+/// Read only the header and footer of the scan result data
+mrd_utils::MrdInfo probeResponse(const QString &pid, const QString &eid);
+
+/// Compressed scan result allowing per-slice reads, nullptr if the exam is stored uncompressed
+std::shared_ptr<mrd_utils::MrdArchive> openResponseArchive(const QString &pid, const QString &eid);
+
 /// Return patient ID list
 QStringList patientEntries();
 
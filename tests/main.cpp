@@ -0,0 +1,41 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "testing.h"
+
+/**
+ * Usage: mrscan_tests [--bench] [filter]
+ * Runs the test cases, or the benchmarks with --bench, whose name contains filter.
+ */
+int main(int argc, char *argv[]) {
+    bool bench = false;
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const auto &test : testing::registry()) {
+        if (test.benchmark != bench || std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        std::printf("%s\n", test.name);
+        std::fflush(stdout);
+        testing::failures() = 0;
+        test.body();
+        run++;
+        if (testing::failures() > 0) {
+            std::printf("FAILED %s (%d)\n", test.name, testing::failures());
+            failed++;
+        }
+    }
+
+    std::printf("%d of %d %s passed\n", run - failed, run, bench ? "benchmarks" : "tests");
+    return failed == 0 ? 0 : 1;
+}
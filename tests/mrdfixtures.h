@@ -0,0 +1,202 @@
+#ifndef MRDFIXTURES_H
+#define MRDFIXTURES_H
+
+#include <QByteArray>
+#include <QtEndian>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "builtinfft.h"
+#include "mrdutils.h"
+#include "mrdview.h"
+
+/**
+ * @brief Synthetic MRD files for the reconstruction tests
+ * @details Files are built in memory with the layout MrdView expects: the 512 byte header,
+ * the k-space of every channel, the footer block and the PPR text.
+ */
+namespace fixtures {
+
+/// Datatype code of complex int16 samples, as written by the scanner
+constexpr int kComplexInt16 = 0x13;
+/// Datatype code of complex float samples
+constexpr int kComplexFloat = 0x16;
+
+inline mrd_utils::MrdHeader header(int views, int samples, int slices = 1, int views2 = 1,
+                                   int datatype = kComplexInt16) {
+    mrd_utils::MrdHeader header;
+    header.samples = samples;
+    header.views = views;
+    header.views2 = views2;
+    header.slices = slices;
+    header.echoes = 1;
+    header.experiments = 1;
+    header.datatype = datatype;
+    return header;
+}
+
+/**
+ * @brief MRD file contents
+ * @param fill Writes channelBytes() bytes of the channel's k-space
+ */
+inline QByteArray mrdBytes(const mrd_utils::MrdHeader &header, int channels,
+                           const std::function<void(int channel, char *kdata)> &fill,
+                           const QByteArray &ppr = ":NO_SAMPLES 0") {
+    const qint64 channelBytes = header.channelBytes();
+    QByteArray bytes(mrd_utils::kHeaderSize + channels * channelBytes +
+                         mrd_utils::kFooterBlockSize,
+                     '\0');
+    auto data = bytes.data();
+    qToLittleEndian<qint32>(header.samples, data + 0);
+    qToLittleEndian<qint32>(header.views, data + 4);
+    qToLittleEndian<qint32>(header.views2, data + 8);
+    qToLittleEndian<qint32>(header.slices, data + 12);
+    qToLittleEndian<qint16>(static_cast<qint16>(header.datatype), data + 18);
+    qToLittleEndian<qint32>(header.echoes, data + 152);
+    qToLittleEndian<qint32>(header.experiments, data + 156);
+    for (int c = 0; c < channels; c++) {
+        fill(c, data + mrd_utils::kHeaderSize + c * channelBytes);
+    }
+    // The footer block ends with the '\0' that precedes the PPR text
+    bytes.append(ppr);
+    return bytes;
+}
+
+/// Complex int16 channels of uniform noise over the full range
+inline QByteArray noiseMrd(const mrd_utils::MrdHeader &header, int channels, unsigned seed = 1) {
+    return mrdBytes(header, channels, [&](int channel, char *kdata) {
+        std::mt19937 gen(seed + channel);
+        std::uniform_int_distribution<int> dist(-32768, 32767);
+        auto samples = reinterpret_cast<qint16 *>(kdata);
+        for (size_t i = 0; i < 2 * header.elements(); i++) {
+            samples[i] = static_cast<qint16>(dist(gen));
+        }
+    });
+}
+
+/**
+ * @brief Centred k-space of a 2D phantom seen by coils placed on a ring
+ * @details The object is an ellipse with a smooth texture, every coil has a Gaussian
+ * sensitivity centred near the edge of the field of view and its own phase. Each of
+ * blocks slices has the slightly different object. Data is [coil][block][views][samples].
+ */
+inline std::vector<std::vector<std::complex<double>>> coilKspace(int coils, int blocks, int views,
+                                                                 int samples) {
+    std::vector<std::vector<std::complex<double>>> kspace(coils);
+    const size_t blockSize = static_cast<size_t>(views) * samples;
+    for (int c = 0; c < coils; c++) {
+        const double angle = 2 * 3.14159265358979323846 * c / coils;
+        const double cy = views / 2 + 0.45 * views * std::sin(angle);
+        const double cx = samples / 2 + 0.45 * samples * std::cos(angle);
+        const double width = 0.45 * std::max(views, samples);
+        std::vector<std::complex<double>> image(blocks * blockSize);
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < views; y++) {
+                for (int x = 0; x < samples; x++) {
+                    double r = std::hypot((y - views / 2) / (0.35 * views),
+                                          (x - samples / 2) / (0.3 * samples + b));
+                    double object = r < 1 ? 1.0 + 0.3 * std::cos(x * 0.3 + y * 0.2) : 0;
+                    double weight = std::exp(-((y - cy) * (y - cy) + (x - cx) * (x - cx)) /
+                                             (2 * width * width));
+                    // Stored uncentred, the image centre at index 0
+                    auto index = b * blockSize + ((y + views / 2) % views) * samples +
+                                 (x + samples / 2) % samples;
+                    image[index] = object * weight * std::polar(1.0, 0.5 * c + 0.01 * x);
+                }
+            }
+        }
+        builtin_fft::transform(image.data(), {views, samples}, blocks, +1);
+
+        // Centre k-space so the reconstruction's FFT and fftshift give the image back
+        auto &k = kspace[c];
+        k.resize(image.size());
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < views; y++) {
+                for (int x = 0; x < samples; x++) {
+                    k[b * blockSize + ((y + views / 2) % views) * samples + (x + samples / 2) % samples] =
+                        image[b * blockSize + y * samples + x] / static_cast<double>(blockSize);
+                }
+            }
+        }
+    }
+    return kspace;
+}
+
+/// Complex float MRD file with one channel per coil of kspace, laid out as described by header
+inline QByteArray coilMrd(const mrd_utils::MrdHeader &header,
+                          const std::vector<std::vector<std::complex<double>>> &kspace,
+                          const QByteArray &ppr = ":NO_SAMPLES 0") {
+    return mrdBytes(header, static_cast<int>(kspace.size()), [&](int channel, char *kdata) {
+        auto samples = reinterpret_cast<float *>(kdata);
+        const auto &coil = kspace[channel];
+        for (size_t i = 0; i < coil.size(); i++) {
+            samples[2 * i] = static_cast<float>(coil[i].real());
+            samples[2 * i + 1] = static_cast<float>(coil[i].imag());
+        }
+    }, ppr);
+}
+
+/**
+ * @brief Untransformed Mrd of every coil of coilKspace(), e.g. for GRAPPA and SENSE
+ * @param acquired Views it rejects are zero, the others get complex Gaussian noise of noise deviation
+ */
+inline QVector<mrd_utils::Mrd> coilMrds(const std::vector<std::vector<std::complex<double>>> &kspace,
+                                        int blocks, int views, int samples,
+                                        const std::function<bool(int view)> &acquired,
+                                        double noise = 0, unsigned seed = 1) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> dist(0, noise > 0 ? noise : 1);
+    QVector<mrd_utils::Mrd> mrds;
+    for (const auto &coil : kspace) {
+        mrd_utils::Mrd mrd;
+        mrd.experiments = 1;
+        mrd.echoes = 1;
+        mrd.slices = blocks;
+        mrd.views = views;
+        mrd.views2 = 1;
+        mrd.samples = samples;
+        auto buffer = fftw_utils::createArray<double>(mrd.size());
+        for (size_t i = 0; i < coil.size(); i++) {
+            std::complex<double> value;
+            if (acquired(static_cast<int>(i / samples % views))) {
+                value = coil[i];
+                if (noise > 0) {
+                    value += std::complex<double>(dist(gen), dist(gen));
+                }
+            }
+            buffer[i][0] = value.real();
+            buffer[i][1] = value.imag();
+        }
+        mrd.kdata = std::move(buffer);
+        mrds.push_back(std::move(mrd));
+    }
+    return mrds;
+}
+
+/// Relative l2 distance |a - b| / |b| of n complex values, Real (*)[2] or std::complex
+template <typename A, typename B>
+double relativeError(const A *a, const B *b, size_t n) {
+    auto value = [](const auto &v) {
+        if constexpr (std::is_array_v<std::remove_cvref_t<decltype(v)>>) {
+            return std::complex<double>(v[0], v[1]);
+        } else {
+            return std::complex<double>(v);
+        }
+    };
+    double error = 0;
+    double reference = 0;
+    for (size_t i = 0; i < n; i++) {
+        error += std::norm(value(a[i]) - value(b[i]));
+        reference += std::norm(value(b[i]));
+    }
+    return reference > 0 ? std::sqrt(error / reference) : std::sqrt(error);
+}
+
+} // namespace fixtures
+
+#endif // MRDFIXTURES_H
@@ -0,0 +1,102 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Minimal self-registering test and benchmark runner of mrscan_tests
+ * @details TEST_CASE bodies run by default, BENCHMARK bodies with --bench. A failed
+ * CHECK reports the expression and keeps going, the process exits non-zero if any failed.
+ */
+namespace testing {
+
+struct Case {
+    const char *name;
+    std::function<void()> body;
+    bool benchmark;
+};
+
+inline std::vector<Case> &registry() {
+    static std::vector<Case> s_cases;
+    return s_cases;
+}
+
+/// Failed checks of the running case
+inline int &failures() {
+    static int s_failures = 0;
+    return s_failures;
+}
+
+struct Registrar {
+    Registrar(const char *name, std::function<void()> body, bool benchmark) {
+        registry().push_back({name, std::move(body), benchmark});
+    }
+};
+
+inline void fail(const char *file, int line, const std::string &what) {
+    std::printf("  %s:%d: %s\n", file, line, what.c_str());
+    failures()++;
+}
+
+/// Seconds of the fastest of repeat runs of fn
+template <typename Fn>
+double bestOf(int repeat, Fn &&fn) {
+    double best = 1e300;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/// One benchmark result line, bytes moved per run give the GB/s column
+inline void report(const std::string &what, double seconds, double bytes = 0) {
+    if (bytes > 0) {
+        std::printf("  %-48s %10.3f ms %8.2f GB/s\n", what.c_str(), seconds * 1e3,
+                    bytes / seconds / 1e9);
+    } else {
+        std::printf("  %-48s %10.3f ms\n", what.c_str(), seconds * 1e3);
+    }
+}
+
+} // namespace testing
+
+#define TESTING_CONCAT_(a, b) a##b
+#define TESTING_CONCAT(a, b) TESTING_CONCAT_(a, b)
+
+#define TESTING_REGISTER(name, benchmark)                                                      \
+    static void TESTING_CONCAT(testing_body_, __LINE__)();                                     \
+    static testing::Registrar TESTING_CONCAT(testing_registrar_, __LINE__)(                    \
+        name, TESTING_CONCAT(testing_body_, __LINE__), benchmark);                             \
+    static void TESTING_CONCAT(testing_body_, __LINE__)()
+
+#define TEST_CASE(name) TESTING_REGISTER(name, false)
+#define BENCHMARK(name) TESTING_REGISTER(name, true)
+
+#define CHECK(expr)                                                                            \
+    do {                                                                                       \
+        if (!(expr)) {                                                                         \
+            testing::fail(__FILE__, __LINE__, "CHECK(" #expr ") failed");                     \
+        }                                                                                      \
+    } while (0)
+
+/// |a - b| <= tol, both values are printed on failure
+#define CHECK_NEAR(a, b, tol)                                                                  \
+    do {                                                                                       \
+        double testing_a_ = (a), testing_b_ = (b);                                             \
+        if (!(std::abs(testing_a_ - testing_b_) <= (tol))) {                                   \
+            testing::fail(__FILE__, __LINE__,                                                  \
+                          "CHECK_NEAR(" #a ", " #b ") " + std::to_string(testing_a_) + " vs " + \
+                              std::to_string(testing_b_));                                     \
+        }                                                                                      \
+    } while (0)
+
+#endif // TESTING_H
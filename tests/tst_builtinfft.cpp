@@ -0,0 +1,232 @@
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "builtinfft.h"
+#include "testing.h"
+
+#ifdef MRSCAN_WITH_FFTW
+#include <fftw3.h>
+#endif
+
+namespace {
+
+template <typename Real>
+std::vector<std::complex<Real>> randomComplex(size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    std::vector<std::complex<Real>> data(n);
+    for (auto &value : data) {
+        value = {static_cast<Real>(dist(gen)), static_cast<Real>(dist(gen))};
+    }
+    return data;
+}
+
+size_t count(const std::vector<int> &n) {
+    size_t total = 1;
+    for (auto size : n) {
+        total *= size;
+    }
+    return total;
+}
+
+/// Reference DFT in long double, axis by axis like the definition of a separable transform
+template <typename Real>
+std::vector<std::complex<Real>> naiveDft(const std::vector<std::complex<Real>> &in,
+                                         const std::vector<int> &n, int howmany, int sign) {
+    using Long = std::complex<long double>;
+    const long double pi = 3.141592653589793238462643383279502884L;
+    std::vector<Long> data(in.begin(), in.end());
+    const size_t total = count(n) * howmany;
+    size_t stride = count(n);
+    for (auto length : n) {
+        stride /= length;
+        std::vector<Long> twiddles(length);
+        for (int k = 0; k < length; k++) {
+            auto angle = sign * 2 * pi * k / length;
+            twiddles[k] = {std::cos(angle), std::sin(angle)};
+        }
+        std::vector<Long> line(length);
+        for (size_t block = 0; block < total; block += length * stride) {
+            for (size_t s = 0; s < stride; s++) {
+                auto first = block + s;
+                for (int k = 0; k < length; k++) {
+                    Long sum = 0;
+                    for (int j = 0; j < length; j++) {
+                        sum += data[first + j * stride] * twiddles[(static_cast<size_t>(j) * k) % length];
+                    }
+                    line[k] = sum;
+                }
+                for (int k = 0; k < length; k++) {
+                    data[first + k * stride] = line[k];
+                }
+            }
+        }
+    }
+    std::vector<std::complex<Real>> out(data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+        out[i] = {static_cast<Real>(data[i].real()), static_cast<Real>(data[i].imag())};
+    }
+    return out;
+}
+
+/// ||a - b|| / ||b||
+template <typename Real>
+double relativeError(const std::vector<std::complex<Real>> &a, const std::vector<std::complex<Real>> &b) {
+    double error = 0;
+    double norm = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        error += std::norm(std::complex<double>(a[i]) - std::complex<double>(b[i]));
+        norm += std::norm(std::complex<double>(b[i]));
+    }
+    return norm > 0 ? std::sqrt(error / norm) : std::sqrt(error);
+}
+
+template <typename Real>
+constexpr double tolerance() {
+    return sizeof(Real) == sizeof(double) ? 1e-12 : 2e-5;
+}
+
+std::string describe(const std::vector<int> &n, int howmany) {
+    std::string text;
+    for (auto size : n) {
+        text += (text.empty() ? "" : " x ") + std::to_string(size);
+    }
+    return text + " (x" + std::to_string(howmany) + ")";
+}
+
+template <typename Real>
+void checkAgainstNaive(const std::vector<int> &n, int howmany) {
+    for (int sign : {-1, +1}) {
+        auto data = randomComplex<Real>(count(n) * howmany, static_cast<unsigned>(count(n)));
+        auto expected = naiveDft(data, n, howmany, sign);
+        builtin_fft::transform(data.data(), n, howmany, sign);
+        auto error = relativeError(data, expected);
+        if (!(error < tolerance<Real>())) {
+            testing::fail(__FILE__, __LINE__,
+                          "builtin " + std::string(sizeof(Real) == 8 ? "double" : "float") +
+                              " sign " + std::to_string(sign) + " of " + describe(n, howmany) +
+                              " relative error " + std::to_string(error));
+        }
+    }
+}
+
+/// Lengths of every code path: radix-2, and Bluestein for primes, odd and even composites
+const std::vector<int> kLengths = {1,  2,  3,  4,  5,  6,  7,  8,   12,  15,  16,  17,
+                                   31, 64, 96, 100, 127, 128, 255, 256, 257, 384, 1000};
+
+#ifdef MRSCAN_WITH_FFTW
+void fftwTransform(std::complex<double> *data, const std::vector<int> &n, int howmany, int sign) {
+    auto buffer = reinterpret_cast<fftw_complex *>(data);
+    const int dist = static_cast<int>(count(n));
+    auto plan = fftw_plan_many_dft(static_cast<int>(n.size()), n.data(), howmany, buffer, nullptr, 1,
+                                   dist, buffer, nullptr, 1, dist, sign, FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+}
+
+void fftwTransform(std::complex<float> *data, const std::vector<int> &n, int howmany, int sign) {
+    auto buffer = reinterpret_cast<fftwf_complex *>(data);
+    const int dist = static_cast<int>(count(n));
+    auto plan = fftwf_plan_many_dft(static_cast<int>(n.size()), n.data(), howmany, buffer, nullptr, 1,
+                                    dist, buffer, nullptr, 1, dist, sign, FFTW_ESTIMATE);
+    fftwf_execute(plan);
+    fftwf_destroy_plan(plan);
+}
+
+template <typename Real>
+void checkAgainstFftw(const std::vector<int> &n, int howmany) {
+    for (int sign : {-1, +1}) {
+        auto builtin = randomComplex<Real>(count(n) * howmany, 7);
+        auto fftw = builtin;
+        builtin_fft::transform(builtin.data(), n, howmany, sign);
+        fftwTransform(fftw.data(), n, howmany, sign);
+        auto error = relativeError(builtin, fftw);
+        if (!(error < tolerance<Real>())) {
+            testing::fail(__FILE__, __LINE__,
+                          "builtin vs fftw sign " + std::to_string(sign) + " of " +
+                              describe(n, howmany) + " relative error " + std::to_string(error));
+        }
+    }
+}
+#endif
+
+} // namespace
+
+TEST_CASE("builtin_fft 1D lengths match the naive DFT") {
+    for (auto length : kLengths) {
+        checkAgainstNaive<double>({length}, 2);
+        checkAgainstNaive<float>({length}, 1);
+    }
+}
+
+TEST_CASE("builtin_fft multi-dimensional batches match the naive DFT") {
+    checkAgainstNaive<double>({6, 10}, 3);
+    checkAgainstNaive<double>({5, 4, 3}, 2);
+    checkAgainstNaive<double>({16, 1, 12}, 4);
+    checkAgainstNaive<float>({7, 8}, 5);
+    // Large enough to run the lines in parallel
+    checkAgainstNaive<double>({96, 100}, 8);
+}
+
+TEST_CASE("builtin_fft backward undoes forward") {
+    for (auto n : std::vector<std::vector<int>>{{256, 256}, {250, 250}, {17, 33, 9}}) {
+        const auto original = randomComplex<double>(count(n) * 2, 3);
+        auto data = original;
+        builtin_fft::transform(data.data(), n, 2, -1);
+        builtin_fft::transform(data.data(), n, 2, +1);
+        for (auto &value : data) {
+            value /= static_cast<double>(count(n));
+        }
+        CHECK(relativeError(data, original) < 1e-13);
+    }
+}
+
+#ifdef MRSCAN_WITH_FFTW
+TEST_CASE("builtin_fft matches fftw") {
+    for (auto length : kLengths) {
+        checkAgainstFftw<double>({length}, 3);
+        checkAgainstFftw<float>({length}, 3);
+    }
+    for (auto n : std::vector<std::vector<int>>{{256, 256}, {250, 250}, {96, 1, 100}, {64, 48, 40}}) {
+        checkAgainstFftw<double>(n, 2);
+        checkAgainstFftw<float>(n, 2);
+    }
+}
+#endif
+
+BENCHMARK("builtin_fft against fftw") {
+    struct Case {
+        const char *name;
+        std::vector<int> n;
+        int howmany;
+    };
+    const std::vector<Case> cases = {
+        {"2D 16 x 256 x 256", {256, 256}, 16},
+        {"2D 16 x 250 x 250 (Bluestein)", {250, 250}, 16},
+        {"3D 128 x 128 x 128", {128, 128, 128}, 1},
+        {"3D 96 x 96 x 96 (Bluestein)", {96, 96, 96}, 1},
+    };
+    for (const auto &c : cases) {
+        auto data = randomComplex<double>(count(c.n) * c.howmany, 1);
+        auto dataF = randomComplex<float>(count(c.n) * c.howmany, 1);
+        auto builtin = testing::bestOf(3, [&] { builtin_fft::transform(data.data(), c.n, c.howmany, -1); });
+        testing::report(std::string(c.name) + ", builtin double", builtin);
+        testing::report(std::string(c.name) + ", builtin float",
+                        testing::bestOf(3, [&] { builtin_fft::transform(dataF.data(), c.n, c.howmany, -1); }));
+#ifdef MRSCAN_WITH_FFTW
+        // Planned once like fftw_utils::FftwPlanCache does, only execution is timed
+        auto buffer = reinterpret_cast<fftw_complex *>(data.data());
+        const int dist = static_cast<int>(count(c.n));
+        auto plan = fftw_plan_many_dft(static_cast<int>(c.n.size()), c.n.data(), c.howmany, buffer,
+                                       nullptr, 1, dist, buffer, nullptr, 1, dist, FFTW_FORWARD,
+                                       FFTW_MEASURE);
+        auto fftw = testing::bestOf(3, [&] { fftw_execute(plan); });
+        fftw_destroy_plan(plan);
+        testing::report(std::string(c.name) + ", fftw double", fftw);
+        std::printf("  %-48s %10.2f x\n", "builtin / fftw", builtin / fftw);
+#endif
+    }
+}
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "coilutils.h"
+#include "testing.h"
+
+using Complex = std::complex<double>;
+using mrd_utils::Mrd;
+
+namespace {
+
+/// Transformed images of one coil, 2 x 2 pixels
+Mrd coilImages(const std::vector<Complex> &pixels) {
+    Mrd mrd;
+    mrd.experiments = 1;
+    mrd.echoes = 1;
+    mrd.slices = 1;
+    mrd.views = 2;
+    mrd.views2 = 1;
+    mrd.samples = static_cast<int>(pixels.size()) / 2;
+    auto buffer = fftw_utils::createArray<double>(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        buffer[i][0] = pixels[i].real();
+        buffer[i][1] = pixels[i].imag();
+    }
+    mrd.kdata = std::move(buffer);
+    mrd.transformed = true;
+    return mrd;
+}
+
+bool nearPixels(const Mrd &mrd, const std::vector<Complex> &expected) {
+    if (!mrd.kdata || mrd.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (std::abs(Complex(mrd.kdata[i][0], mrd.kdata[i][1]) - expected[i]) > 1e-12) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("coil_utils CoilCombiner combines two known coils") {
+    const Complex i(0, 1);
+    const auto first = coilImages({3, i, 1.0 + i, 0});
+    const auto second = coilImages({4.0 * i, 0, 1.0 - i, 0});
+
+    // sqrt(|x_1|^2 + |x_2|^2)
+    coil_utils::CoilCombiner<double> rss(recon::CoilCombine::Rss);
+    CHECK(!rss.needsSensitivity());
+    CHECK(rss.add(first) && rss.add(second) && rss.coils() == 2);
+    auto combined = rss.take();
+    CHECK(combined.transformed && nearPixels(combined, {5, 1, 2, 0}));
+    // take() resets the combiner
+    CHECK(rss.coils() == 0 && rss.take().kdata == nullptr);
+
+    // sum conj(s_c) x_c / sqrt(sum |s_c|^2), no weight where no coil sees anything
+    const auto firstMap = coilImages({1, 1, 1, 0});
+    const auto secondMap = coilImages({i, 0, 1, 0});
+    coil_utils::CoilCombiner<double> sensitivity(recon::CoilCombine::Sensitivity);
+    CHECK(sensitivity.needsSensitivity());
+    CHECK(!sensitivity.add(first));
+    CHECK(sensitivity.add(first, &firstMap) && sensitivity.add(second, &secondMap));
+    combined = sensitivity.take();
+    CHECK(nearPixels(combined, {7 / std::sqrt(2.0), i, std::sqrt(2.0), 0}));
+}
+
+TEST_CASE("coil_utils CoilCombiner rejects inputs it cannot combine") {
+    const auto coil = coilImages({1, 2, 3, 4});
+    coil_utils::CoilCombiner<double> none(recon::CoilCombine::None);
+    CHECK(!none.add(coil) && none.take().kdata == nullptr);
+
+    coil_utils::CoilCombiner<double> rss(recon::CoilCombine::Rss);
+    auto kspace = coil;
+    kspace.transformed = false;
+    CHECK(!rss.add(kspace));
+    CHECK(rss.add(coil));
+    // Another shape is skipped, the first coil is still combined
+    CHECK(!rss.add(coilImages({1, 2, 3, 4, 5, 6})));
+    CHECK(rss.coils() == 1 && nearPixels(rss.take(), {1, 2, 3, 4}));
+}
@@ -0,0 +1,165 @@
+#include <complex>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fftshift.h"
+#include "testing.h"
+
+namespace {
+
+/// Element i holds (i, -i), every element differs so any misplaced one is caught
+template <typename Real>
+std::vector<std::complex<Real>> indexed(size_t n) {
+    std::vector<std::complex<Real>> data(n);
+    for (size_t i = 0; i < n; i++) {
+        data[i] = {static_cast<Real>(i), -static_cast<Real>(i)};
+    }
+    return data;
+}
+
+template <typename Real>
+Real (*asFftw(std::vector<std::complex<Real>> &data))[2] {
+    return reinterpret_cast<Real(*)[2]>(data.data());
+}
+
+size_t count(const std::vector<int> &shape) {
+    size_t n = 1;
+    for (auto s : shape) {
+        n *= s;
+    }
+    return n;
+}
+
+/// Reference: element at index moves to (index + shift) % n along every selected axis
+template <typename T>
+std::vector<T> naiveShift(const std::vector<T> &in, const std::vector<int> &shape,
+                          const std::vector<int> &axes, bool inverse) {
+    const auto rank = shape.size();
+    std::vector<bool> selected(rank, axes.empty());
+    for (auto axis : axes) {
+        selected[axis] = true;
+    }
+
+    std::vector<T> out(in.size());
+    std::vector<int> index(rank, 0);
+    for (size_t i = 0; i < in.size(); i++) {
+        size_t dst = 0;
+        for (size_t d = 0; d < rank; d++) {
+            const int n = shape[d];
+            const int shift = selected[d] ? (inverse ? n - n / 2 : n / 2) : 0;
+            dst = dst * n + (index[d] + shift) % n;
+        }
+        out[dst] = in[i];
+        for (size_t d = rank; d-- > 0;) {
+            if (++index[d] < shape[d]) {
+                break;
+            }
+            index[d] = 0;
+        }
+    }
+    return out;
+}
+
+std::string describe(const std::vector<int> &values) {
+    std::string text = "{";
+    for (size_t i = 0; i < values.size(); i++) {
+        text += (i ? ", " : "") + std::to_string(values[i]);
+    }
+    return text + "}";
+}
+
+/// fftshift and ifftshift against the reference, and ifftshift undoing fftshift
+template <typename Real>
+void checkShift(const std::vector<int> &shape, const std::vector<int> &axes, int workers) {
+    const auto original = indexed<Real>(count(shape));
+    for (bool inverse : {false, true}) {
+        auto data = original;
+        bool ok = inverse ? fftw_utils::ifftshift(asFftw(data), shape, axes, workers)
+                          : fftw_utils::fftshift(asFftw(data), shape, axes, workers);
+        if (!ok || data != naiveShift(original, shape, axes, inverse)) {
+            testing::fail(__FILE__, __LINE__,
+                          std::string(inverse ? "ifftshift" : "fftshift") + " of shape " +
+                              describe(shape) + " axes " + describe(axes) + " workers " +
+                              std::to_string(workers));
+        }
+    }
+
+    auto data = original;
+    fftw_utils::fftshift(asFftw(data), shape, axes, workers);
+    fftw_utils::ifftshift(asFftw(data), shape, axes, workers);
+    CHECK(data == original);
+}
+
+} // namespace
+
+TEST_CASE("fftw_utils fftshift of every small 1D length") {
+    for (int n = 1; n <= 17; n++) {
+        checkShift<double>({n}, {}, 1);
+        checkShift<float>({n}, {0}, 1);
+    }
+}
+
+TEST_CASE("fftw_utils fftshift of multi-axis shapes") {
+    const std::vector<std::vector<int>> shapes = {
+        {4, 6}, {5, 7}, {4, 7}, {3, 5, 4}, {4, 6, 8}, {2, 3, 5, 7}, {3, 8, 1, 9}, {1, 1, 1}};
+    for (const auto &shape : shapes) {
+        const int rank = static_cast<int>(shape.size());
+        checkShift<double>(shape, {}, 1);
+        for (int axis = 0; axis < rank; axis++) {
+            checkShift<double>(shape, {axis}, 1);
+            checkShift<float>(shape, {axis, rank - 1}, 2);
+        }
+        if (rank == 4) {
+            // What mrd_utils uses: every axis but the blocks
+            checkShift<double>(shape, {1, 2, 3}, 2);
+        }
+    }
+}
+
+TEST_CASE("fftw_utils fftshift of tiled and parallel shapes") {
+    // Rows longer than one tile of the row swaps, even and odd
+    checkShift<double>({2, 7, 3001}, {1, 2}, 1);
+    checkShift<double>({3, 8, 4100}, {1}, 3);
+    // Large enough to run in parallel, the fused last axis included
+    checkShift<float>({3, 257, 1365}, {1, 2}, 4);
+    checkShift<double>({4, 256, 1024}, {0, 1, 2}, 4);
+}
+
+TEST_CASE("fftw_utils fftshift rejects an invalid axis") {
+    const std::vector<int> shape = {4, 5};
+    const auto original = indexed<double>(20);
+    auto data = original;
+    CHECK(!fftw_utils::fftshift(asFftw(data), shape, {0, 2}));
+    CHECK(!fftw_utils::ifftshift(asFftw(data), shape, {-1}));
+    CHECK(data == original);
+}
+
+BENCHMARK("fftw_utils fftshift bandwidth") {
+    struct Case {
+        const char *name;
+        std::vector<int> shape;
+        std::vector<int> axes;
+    };
+    const std::vector<Case> cases = {
+        {"2D multi-slice 16 x 256 x 256", {16, 256, 1, 256}, {1, 2, 3}},
+        {"2D multi-slice 16 x 255 x 255 (odd)", {16, 255, 1, 255}, {1, 2, 3}},
+        {"3D 128 x 128 x 128", {1, 128, 128, 128}, {1, 2, 3}},
+        {"3D 128 x 8 x 4096 (long rows)", {1, 128, 8, 4096}, {1, 2, 3}},
+    };
+    for (const auto &c : cases) {
+        auto data = indexed<double>(count(c.shape));
+        auto copy = data;
+        // Every element is read and written once per pass
+        const double bytes = 2.0 * data.size() * sizeof(data[0]);
+        for (int workers : {1, 0}) {
+            auto seconds = testing::bestOf(5, [&] {
+                fftw_utils::fftshift(asFftw(data), c.shape, c.axes, workers);
+            });
+            testing::report(std::string(c.name) + (workers == 1 ? ", 1 thread" : ", all threads"),
+                            seconds, bytes);
+        }
+        auto seconds = testing::bestOf(3, [&] { copy = naiveShift(data, c.shape, c.axes, false); });
+        testing::report(std::string(c.name) + ", naive copy", seconds, bytes);
+    }
+}
@@ -0,0 +1,66 @@
+#include <thread>
+#include <vector>
+
+#include "fftwplancache.h"
+#include "testing.h"
+#include "utils.h"
+
+TEST_CASE("fftw_utils physicalCores counts at least one core") {
+    const int cores = fftw_utils::physicalCores();
+    CHECK(cores >= 1);
+    // Hyper-threads are not counted
+    const auto logical = std::thread::hardware_concurrency();
+    CHECK(logical == 0 || cores <= static_cast<int>(logical));
+    CHECK(fftw_utils::physicalCores() == cores);
+
+    // <= 0 is every physical core, plans run on one thread unless the fftw threads started
+    const int threads = fftw_utils::fftThreads();
+    CHECK(threads >= 1);
+    fftw_utils::setFftThreads(0);
+    CHECK(fftw_utils::fftThreads() == cores || fftw_utils::fftThreads() == 1);
+    fftw_utils::setFftThreads(3);
+    CHECK(fftw_utils::fftThreads() == 3 || fftw_utils::fftThreads() == 1);
+    fftw_utils::setFftThreads(0);
+}
+
+#ifdef MRSCAN_WITH_FFTW
+TEST_CASE("fftw_utils PlanCache reuses a plan for arrays of the same layout") {
+    auto &cache = fftw_utils::PlanCache<float>::instance();
+    cache.clear();
+    const auto effort = fftw_utils::planEffort();
+    fftw_utils::setPlanEffort(fftw_utils::PlanEffort::Estimate);
+
+    const std::vector<int> n{16, 8};
+    const size_t size = 2 * 16 * 8;
+    auto in = fftw_utils::createArray<float>(size + 1);
+    auto out = fftw_utils::createArray<float>(size + 1);
+    auto otherIn = fftw_utils::createArray<float>(size);
+    auto otherOut = fftw_utils::createArray<float>(size);
+
+    const auto hits = cache.hits();
+    const auto misses = cache.misses();
+    auto plan = cache.get(n, FFTW_FORWARD, in.get(), out.get(), 2);
+    CHECK(plan != nullptr && cache.misses() == misses + 1 && cache.size() == 1);
+    // Only the layout matters, not the addresses
+    CHECK(cache.get(n, FFTW_FORWARD, otherIn.get(), otherOut.get(), 2) == plan);
+    CHECK(cache.hits() == hits + 1 && cache.size() == 1);
+
+    // In place, one complex float off the SIMD alignment, another direction or batch
+    auto inPlace = cache.get(n, FFTW_FORWARD, in.get(), in.get(), 2);
+    auto misaligned = cache.get(n, FFTW_FORWARD, in.get() + 1, out.get(), 2);
+    auto backward = cache.get(n, FFTW_BACKWARD, in.get(), out.get(), 2);
+    auto single = cache.get(n, FFTW_FORWARD, in.get(), out.get(), 1);
+    CHECK(inPlace && misaligned && backward && single);
+    CHECK(inPlace != plan && misaligned != plan && misaligned != inPlace);
+    CHECK(backward != plan && single != plan);
+    CHECK(cache.misses() == misses + 5 && cache.size() == 5);
+    // Each of them is a hit from now on
+    CHECK(cache.get(n, FFTW_FORWARD, otherIn.get(), otherIn.get(), 2) == inPlace);
+    CHECK(cache.get(n, FFTW_FORWARD, otherIn.get() + 1, otherOut.get(), 2) == misaligned);
+    CHECK(cache.hits() == hits + 3 && cache.misses() == misses + 5);
+
+    cache.clear();
+    CHECK(cache.size() == 0);
+    fftw_utils::setPlanEffort(effort);
+}
+#endif // MRSCAN_WITH_FFTW
@@ -0,0 +1,98 @@
+#include <atomic>
+#include <complex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grappa.h"
+#include "mrdfixtures.h"
+#include "testing.h"
+
+namespace {
+
+using Kspace = std::vector<std::vector<std::complex<double>>>;
+
+/// Coils of the phantom acquired with sampling, plus a little noise so the fit is realistic
+QVector<mrd_utils::Mrd> acquire(const Kspace &kspace, int blocks, int views, int samples,
+                                const grappa::Sampling &sampling) {
+    return fixtures::coilMrds(kspace, blocks, views, samples,
+                              [&](int view) { return sampling.isAcquired(view); }, 1e-5);
+}
+
+/// Error of the views sampling skips relative to the fully sampled ones, 1 if zero filled
+double skippedError(const QVector<mrd_utils::Mrd> &mrds, const Kspace &kspace, int views,
+                    int samples, const grappa::Sampling &sampling) {
+    double error = 0;
+    double reference = 0;
+    for (int c = 0; c < mrds.size(); c++) {
+        for (size_t i = 0; i < kspace[c].size(); i++) {
+            if (sampling.isAcquired(static_cast<int>(i / samples % views))) {
+                continue;
+            }
+            error += std::norm(std::complex<double>(mrds[c].kdata[i][0], mrds[c].kdata[i][1]) -
+                               kspace[c][i]);
+            reference += std::norm(kspace[c][i]);
+        }
+    }
+    return std::sqrt(error / reference);
+}
+
+} // namespace
+
+TEST_CASE("grappa estimates approach the fully sampled k-space") {
+    auto kspace = fixtures::coilKspace(8, 2, 64, 64);
+    // Bound of the error of the estimated views, zero filling them is 1
+    const std::pair<int, double> bounds[] = {{2, 0.15}, {3, 0.4}};
+    for (auto [acceleration, bound] : bounds) {
+        grappa::Sampling sampling(64, acceleration, 24);
+        CHECK(sampling.isUndersampled());
+        auto coils = acquire(kspace, 2, 64, 64, sampling);
+        CHECK(skippedError(coils, kspace, 64, 64, sampling) == 1.0);
+        CHECK(grappa::reconstruct(coils, sampling));
+        CHECK(skippedError(coils, kspace, 64, 64, sampling) < bound);
+    }
+}
+
+TEST_CASE("grappa keeps the acquired views") {
+    auto kspace = fixtures::coilKspace(4, 1, 48, 32);
+    grappa::Sampling sampling(48, 2, 16);
+    auto acquired = acquire(kspace, 1, 48, 32, sampling);
+    auto coils = acquired;
+    CHECK(grappa::reconstruct(coils, sampling));
+    bool same = true;
+    for (int c = 0; c < coils.size(); c++) {
+        for (size_t i = 0; i < kspace[c].size(); i++) {
+            if (sampling.isAcquired(static_cast<int>(i / 32 % 48))) {
+                same = same && coils[c].kdata[i][0] == acquired[c].kdata[i][0] &&
+                       coils[c].kdata[i][1] == acquired[c].kdata[i][1];
+            }
+        }
+    }
+    CHECK(same);
+    // Copy on write, the acquired coils still hold zeros in the gaps
+    CHECK(skippedError(acquired, kspace, 48, 32, sampling) == 1.0);
+}
+
+TEST_CASE("grappa stops once cancelled") {
+    auto kspace = fixtures::coilKspace(4, 2, 48, 32);
+    grappa::Sampling sampling(48, 2, 16);
+    auto coils = acquire(kspace, 2, 48, 32, sampling);
+    std::atomic<bool> cancelled(true);
+    CHECK(!grappa::reconstruct(coils, sampling, &cancelled));
+    cancelled = false;
+    CHECK(grappa::reconstruct(coils, sampling, &cancelled));
+}
+
+BENCHMARK("grappa time against coil count") {
+    // 4 slices of 256 x 256 at R = 2 with 24 ACS views
+    for (int coils : {4, 8, 16}) {
+        auto kspace = fixtures::coilKspace(coils, 4, 256, 256);
+        grappa::Sampling sampling(256, 2, 24);
+        auto acquired = acquire(kspace, 4, 256, 256, sampling);
+        auto seconds = testing::bestOf(3, [&] {
+            auto mrds = acquired;
+            grappa::reconstruct(mrds, sampling);
+        });
+        testing::report(std::to_string(coils) + " coils, 4 x 256 x 256, R = 2", seconds);
+    }
+}
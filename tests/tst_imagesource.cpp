@@ -0,0 +1,130 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "imagesource.h"
+#include "testing.h"
+
+namespace {
+
+/// imagesPerBlock small images whose pixel value names the channel and block
+QVector<QImage> blockImages(int channel, int block, int imagesPerBlock) {
+    QVector<QImage> images;
+    for (int i = 0; i < imagesPerBlock; i++) {
+        QImage image(4, 4, QImage::Format_Grayscale8);
+        image.fill(channel * 16 + block);
+        images.push_back(image);
+    }
+    return images;
+}
+
+/// Wait up to a second for count to become non-zero
+bool waitFor(const std::atomic<int> &count) {
+    for (int i = 0; i < 1000 && count == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return count > 0;
+}
+
+} // namespace
+
+TEST_CASE("CachedImageSource loads every channel of a block at once") {
+    const int channels = 3;
+    const int blocks = 4;
+    std::atomic<int> calls(0);
+    CachedImageSource::BlockLoader loader = [&](int block, const std::atomic<bool> &) {
+        calls++;
+        QVector<QVector<QImage>> images;
+        for (int c = 0; c < channels; c++) {
+            images.push_back(blockImages(c, block, 2));
+        }
+        return images;
+    };
+    // No prefetch so the count is only the requested blocks
+    CachedImageSource source(channels, blocks, 2, loader, CachedImageSource::kDefaultCapacity, 0);
+    for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < source.count(); i++) {
+            auto image = source.image(c, i);
+            CHECK(!image.isNull());
+            CHECK(image.constBits()[0] == c * 16 + i / 2);
+        }
+    }
+    CHECK(calls == blocks);
+}
+
+TEST_CASE("CachedImageSource destructor cancels a running prefetch") {
+    std::atomic<int> startedLoads(0);
+    std::atomic<int> cancelledLoads(0);
+    CachedImageSource::Loader loader = [&](int channel, int block, const std::atomic<bool> &cancelled) {
+        if (block == 0) {
+            return blockImages(channel, block, 1);
+        }
+        startedLoads++;
+        // Prefetched neighbours only finish once cancelled, joining would hang otherwise
+        while (!cancelled) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        cancelledLoads++;
+        return QVector<QImage>();
+    };
+    {
+        CachedImageSource source(1, 8, 1, loader);
+        CHECK(!source.image(0, 0).isNull());
+        CHECK(waitFor(startedLoads));
+    }
+    CHECK(cancelledLoads == 1);
+}
+
+TEST_CASE("CachedImageSource cancels a prefetch the user moved away from") {
+    std::atomic<int> startedLoads(0);
+    std::atomic<int> cancelledLoads(0);
+    CachedImageSource::Loader loader = [&](int channel, int block, const std::atomic<bool> &cancelled) {
+        if (block != 1) {
+            return blockImages(channel, block, 1);
+        }
+        startedLoads++;
+        while (!cancelled) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        cancelledLoads++;
+        return QVector<QImage>();
+    };
+    CachedImageSource source(1, 32, 1, loader, CachedImageSource::kDefaultCapacity, 1);
+    CHECK(!source.image(0, 0).isNull());
+    CHECK(waitFor(startedLoads));
+    // Block 1 is still loading in the background, block 20 is far from it
+    CHECK(!source.image(0, 20).isNull());
+    CHECK(waitFor(cancelledLoads));
+    CHECK(startedLoads == 1);
+}
+
+TEST_CASE("CachedImageSource loads a missing image in the background for cachedImage") {
+    const auto caller = std::this_thread::get_id();
+    std::atomic<int> calls(0);
+    std::atomic<int> offCaller(0);
+    CachedImageSource::Loader loader = [&](int channel, int block, const std::atomic<bool> &) {
+        calls++;
+        if (std::this_thread::get_id() != caller) {
+            offCaller++;
+        }
+        return blockImages(channel, block, 2);
+    };
+    CachedImageSource source(2, 8, 2, loader, CachedImageSource::kDefaultCapacity, 1);
+    std::atomic<int> ready(0);
+    source.setReadyHandler([&] { ready++; });
+
+    // Both misses are loaded, neither replaces the other
+    CHECK(source.cachedImage(1, 6).isNull());
+    CHECK(source.cachedImage(0, 13).isNull());
+    for (int i = 0; i < 1000 && (source.cachedImage(1, 6).isNull() || source.cachedImage(0, 13).isNull()); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(waitFor(ready));
+    auto image = source.cachedImage(1, 7);
+    CHECK(!image.isNull() && image.constBits()[0] == 16 + 3);
+    image = source.cachedImage(0, 13);
+    CHECK(!image.isNull() && image.constBits()[0] == 6);
+    // Nothing was reconstructed on the calling thread
+    CHECK(calls > 0 && offCaller == calls);
+    CHECK(source.cachedImage(2, 0).isNull() && source.cachedImage(0, 16).isNull());
+}
@@ -0,0 +1,101 @@
+#include <QImage>
+#include <QList>
+#include <vector>
+
+#include "imageutils.h"
+#include "testing.h"
+
+using image_utils::Window;
+
+namespace {
+
+/// Grayscale16 image of one row holding values
+QImage row16(const std::vector<quint16> &values) {
+    QImage image(static_cast<int>(values.size()), 1, QImage::Format_Grayscale16);
+    auto pixels = reinterpret_cast<quint16 *>(image.scanLine(0));
+    for (size_t i = 0; i < values.size(); i++) {
+        pixels[i] = values[i];
+    }
+    return image;
+}
+
+std::vector<uchar> pixels8(const QImage &frame) {
+    auto row = frame.constScanLine(0);
+    return std::vector<uchar>(row, row + frame.width());
+}
+
+} // namespace
+
+TEST_CASE("image_utils auto window spans the histogram percentiles") {
+    auto histogram = image_utils::emptyHistogram();
+    CHECK(static_cast<int>(histogram.size()) == image_utils::kHistogramBins);
+    CHECK(image_utils::autoWindow(histogram) == Window());
+
+    // 100 dark and 100 bright pixels, dealt over two histograms
+    std::vector<quint16> dark(100, 0x0100);
+    std::vector<quint16> bright(100, 0x8000);
+    auto other = image_utils::emptyHistogram();
+    image_utils::accumulate(histogram, dark.data(), dark.size());
+    image_utils::accumulate(other, bright.data(), bright.size());
+    image_utils::merge(histogram, other);
+    CHECK(histogram[0x0100 >> image_utils::kHistogramShift] == 100);
+    CHECK(histogram[0x8000 >> image_utils::kHistogramShift] == 100);
+
+    // The window runs from the dark bin to the end of the bright one
+    auto window = image_utils::autoWindow(histogram);
+    CHECK(window == Window::fromRange(0x0100, 0x8000 + (1 << image_utils::kHistogramShift)));
+    CHECK(window.lower() == 0x0100 && window.upper() == 0x8010);
+    // Percentiles that only see the dark pixels give a single bin
+    window = image_utils::autoWindow(histogram, 0, 0.25);
+    CHECK(window.lower() == 0x0100 && window.width == 1 << image_utils::kHistogramShift);
+
+    CHECK(Window::fromRange(10, 10).width == 1);
+    CHECK(Window::fromRange(100, 300).lower() == 100 && Window::fromRange(100, 300).upper() == 300);
+}
+
+TEST_CASE("image_utils window is stored in the image and mapped to 8 bits") {
+    auto image = row16({0, 999, 1000, 1510, 2019, 2020, 65535});
+    CHECK(image_utils::window(image) == Window());
+    const auto window = Window::fromRange(1000, 2020);
+    image_utils::setWindow(image, window);
+    auto copy = image;
+    CHECK(image_utils::window(copy) == window);
+
+    // Black below the window, white from its upper end
+    image_utils::WindowLut lut(window);
+    CHECK(lut.window() == window);
+    CHECK(lut[0] == 0 && lut[999] == 0 && lut[1000] == 0 && lut[1510] == 127);
+    CHECK(lut[2019] == 254 && lut[2020] == 255 && lut[65535] == 255);
+    auto frame = lut.apply(image);
+    CHECK(frame.format() == QImage::Format_Grayscale8);
+    CHECK(pixels8(frame) == std::vector<uchar>({0, 0, 0, 127, 254, 255, 255}));
+    CHECK(pixels8(image_utils::toDisplay(image)) == pixels8(frame));
+
+    // Only 16-bit images are windowed
+    QImage rgb(2, 2, QImage::Format_RGB32);
+    CHECK(lut.apply(rgb).format() == QImage::Format_RGB32);
+    CHECK(image_utils::toDisplay(rgb).format() == QImage::Format_RGB32);
+}
+
+TEST_CASE("image_utils toDisplay uses the window of each image unless overridden") {
+    auto a = row16({0, 100, 200});
+    auto b = row16({0, 100, 200});
+    image_utils::setWindow(a, Window::fromRange(0, 200));
+    image_utils::setWindow(b, Window::fromRange(100, 200));
+    QImage rgb(1, 1, QImage::Format_RGB32);
+    const QList<QImage> images = {a, b, rgb, a};
+
+    for (int workers : {1, 0}) {
+        auto frames = image_utils::toDisplay(images, nullptr, workers);
+        CHECK(frames.size() == 4);
+        CHECK(pixels8(frames[0]) == std::vector<uchar>({0, 127, 255}));
+        CHECK(pixels8(frames[1]) == std::vector<uchar>({0, 0, 255}));
+        CHECK(frames[2].format() == QImage::Format_RGB32);
+        CHECK(pixels8(frames[3]) == pixels8(frames[0]));
+
+        const auto override = Window::fromRange(0, 100);
+        frames = image_utils::toDisplay(images, &override, workers);
+        CHECK(pixels8(frames[0]) == std::vector<uchar>({0, 255, 255}));
+        CHECK(pixels8(frames[1]) == pixels8(frames[0]));
+    }
+}
@@ -0,0 +1,180 @@
+#include <QDir>
+#include <QFile>
+#include <cstring>
+#include <string>
+
+#include "mrdarchive.h"
+#include "mrdfileset.h"
+#include "mrdfixtures.h"
+#include "testing.h"
+
+using mrd_utils::MrdArchive;
+using mrd_utils::MrdFileSet;
+using mrd_utils::MrdView;
+
+namespace {
+
+/**
+ * @brief Complex int16 channels of the phantom k-space plus a little noise
+ * @details Compresses like scanner data, the noise keeps the low bits busy
+ */
+QByteArray scanLikeMrd(const mrd_utils::MrdHeader &header, int channels) {
+    auto blocks = header.experiments * header.echoes * header.slices;
+    auto kspace = fixtures::coilKspace(channels, blocks, header.views, header.samples);
+    double peak = 0;
+    for (const auto &coil : kspace) {
+        for (const auto &value : coil) {
+            peak = std::max({peak, std::abs(value.real()), std::abs(value.imag())});
+        }
+    }
+    return fixtures::mrdBytes(header, channels, [&](int channel, char *kdata) {
+        std::mt19937 gen(channel);
+        std::normal_distribution<double> noise(0, 4);
+        auto samples = reinterpret_cast<qint16 *>(kdata);
+        const auto &coil = kspace[channel];
+        for (size_t i = 0; i < coil.size(); i++) {
+            samples[2 * i] = static_cast<qint16>(coil[i].real() / peak * 30000 + noise(gen));
+            samples[2 * i + 1] = static_cast<qint16>(coil[i].imag() / peak * 30000 + noise(gen));
+        }
+    });
+}
+
+/// Archive written to a temporary file, removed with the object
+struct TempArchive {
+    QString path;
+    std::shared_ptr<MrdArchive> archive;
+
+    explicit TempArchive(const QByteArray &bytes, const char *name) {
+        path = QDir(QDir::tempPath()).filePath(QString("mrscan_tests_%1.mrdz").arg(name));
+        if (file_utils::save(path, bytes)) {
+            archive = MrdArchive::open(path);
+        }
+    }
+    ~TempArchive() {
+        archive.reset();
+        QFile::remove(path);
+    }
+};
+
+bool sameSamples(const mrd_utils::CoilKspace &a, const mrd_utils::CoilKspace &b) {
+    return a.view.data && b.view.data && a.view.elements == b.view.elements &&
+           a.view.datatype == b.view.datatype &&
+           std::memcmp(a.view.data, b.view.data, a.view.elements * a.view.stride()) == 0;
+}
+
+} // namespace
+
+TEST_CASE("mrd_utils archive round trip") {
+    auto header = fixtures::header(32, 40, 3);
+    header.echoes = 2;
+    auto bytes = scanLikeMrd(header, 3);
+    auto view = MrdView::fromBytes(bytes);
+    TempArchive temp(MrdArchive::compress(*view), "roundtrip");
+    CHECK(temp.archive);
+    if (!temp.archive) {
+        return;
+    }
+    CHECK(temp.archive->readAll() == bytes);
+
+    // Block reads of the archive match the blocks of the mapped file
+    auto mapped = MrdFileSet::fromView(view);
+    auto archived = MrdFileSet::fromArchive(temp.archive);
+    CHECK(archived && archived->coils() == 3 && archived->blocks() == 6);
+    for (int coil = 0; coil < 3; coil++) {
+        CHECK(sameSamples(archived->read(coil), mapped->read(coil)));
+        for (int block = 0; block < 6; block++) {
+            CHECK(sameSamples(archived->read(coil, block), mapped->read(coil, block)));
+        }
+    }
+    CHECK(!archived->read(3).view.data);
+    CHECK(!archived->read(0, 6).view.data);
+    CHECK(archived->bytes() == bytes);
+}
+
+TEST_CASE("mrd_utils file set loads every coil into one tensor") {
+    auto header = fixtures::header(32, 40, 3);
+    // Two files of two channels each, the coils of the second file follow the first
+    QVector<std::shared_ptr<const MrdView>> views = {MrdView::fromBytes(fixtures::noiseMrd(header, 2, 1)),
+                                                     MrdView::fromBytes(fixtures::noiseMrd(header, 2, 5))};
+    auto files = MrdFileSet::fromViews(views);
+    CHECK(files && files->coils() == 4);
+    if (!files) {
+        return;
+    }
+
+    for (bool centre : {false, true}) {
+        for (int block : {-1, 0, 2}) {
+            auto tensor = files->load<double>(block, centre, 2);
+            CHECK(tensor.kdata && tensor.coils == 4 && tensor.centred == centre);
+            auto coils = tensor.takeCoils();
+            CHECK(coils.size() == 4 && !tensor.kdata);
+            for (int coil = 0; coil < coils.size(); coil++) {
+                auto coilHeader = header;
+                if (block >= 0) {
+                    coilHeader.slices = 1;
+                }
+                auto expected = mrd_utils::Mrd::fromKspace(coilHeader, files->read(coil, block).view,
+                                                           files->ppr(), centre);
+                CHECK(coils[coil].size() == expected.size() && coils[coil].centred == expected.centred);
+                CHECK(std::memcmp(coils[coil].kdata.get(), expected.kdata.get(),
+                                  expected.size() * sizeof(expected.kdata[0])) == 0);
+            }
+
+            // Every coil owns its part of the buffer, writing it does not copy
+            auto data = coils[1].kdata.get();
+            CHECK(coils[1].detach() == data);
+        }
+    }
+}
+
+TEST_CASE("file_utils save keeps the old file on failure") {
+    auto path = QDir(QDir::tempPath()).filePath("mrscan_tests_save.bin");
+    CHECK(file_utils::save(path, QByteArray("first")));
+    CHECK(file_utils::read(path) == QByteArray("first"));
+    CHECK(!file_utils::save(QDir(path).filePath("not_a_directory/file.bin"), QByteArray("x")));
+    CHECK(file_utils::read(path) == QByteArray("first"));
+    QFile::remove(path);
+}
+
+BENCHMARK("mrd_utils archive compression ratio and throughput") {
+    // 8 channels of 16 slices of 256 x 256 complex int16, 64 MiB
+    auto header = fixtures::header(256, 256, 16);
+    const int channels = 8;
+    auto bytes = scanLikeMrd(header, channels);
+    auto view = MrdView::fromBytes(bytes);
+    const double size = bytes.size();
+
+    QByteArray compressed;
+    for (int level : {1, -1}) {
+        auto seconds = testing::bestOf(3, [&] { compressed = MrdArchive::compress(*view, level); });
+        testing::report(QString("compress level %1, ratio %2")
+                            .arg(level)
+                            .arg(size / compressed.size(), 0, 'f', 2)
+                            .toStdString(),
+                        seconds, size);
+    }
+
+    TempArchive temp(compressed, "bench");
+    if (!temp.archive) {
+        return;
+    }
+    testing::report("readAll", testing::bestOf(3, [&] { temp.archive->readAll(); }), size);
+    const double blockBytes = header.channelBytes() / header.slices;
+    testing::report("readSlice, one block",
+                    testing::bestOf(10, [&] { temp.archive->readSlice(channels / 2, header.slices / 2); }),
+                    blockBytes);
+
+    // Opening an exam decodes one block of every coil, from the archive or the mapped file
+    auto archived = MrdFileSet::fromArchive(temp.archive);
+    auto mapped = MrdFileSet::fromView(view);
+    for (auto [name, files] : {std::pair("archive", archived), std::pair("mapped", mapped)}) {
+        auto seconds = testing::bestOf(5, [&] {
+            for (int coil = 0; coil < channels; coil++) {
+                auto kspace = files->read(coil, header.slices / 2);
+                mrd_utils::decode<double>(kspace.view);
+            }
+        });
+        testing::report(std::string("decode one block of every coil, ") + name, seconds,
+                        blockBytes * channels);
+    }
+}
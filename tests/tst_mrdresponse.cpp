@@ -0,0 +1,161 @@
+#include "imageutils.h"
+#include "mrdfixtures.h"
+#include "mrdresponse.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+double meanPixel(const QImage &image) {
+    double sum = 0;
+    for (int y = 0; y < image.height(); y++) {
+        auto row = reinterpret_cast<const quint16 *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            sum += row[x];
+        }
+    }
+    return sum / (static_cast<double>(image.width()) * image.height());
+}
+
+/// Largest difference of two 16-bit images of the same size
+int maxDifference(const QImage &a, const QImage &b) {
+    int difference = 0;
+    for (int y = 0; y < a.height(); y++) {
+        auto rowA = reinterpret_cast<const quint16 *>(a.constScanLine(y));
+        auto rowB = reinterpret_cast<const quint16 *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); x++) {
+            difference = std::max(difference, std::abs(rowA[x] - rowB[x]));
+        }
+    }
+    return difference;
+}
+
+} // namespace
+
+TEST_CASE("MrdResponse lazy and eager blocks share the scale and window of their channel") {
+    const int blocks = 5;
+    auto kspace = fixtures::coilKspace(3, blocks, 64, 64);
+    // Blocks of different brightness, each normalized on its own would all look alike
+    const size_t blockSize = 64 * 64;
+    for (auto &coil : kspace) {
+        for (size_t i = 0; i < coil.size(); i++) {
+            coil[i] *= 0.8 + 0.1 * static_cast<double>(i / blockSize);
+        }
+    }
+    MrdResponse response(fixtures::coilMrd(fixtures::header(64, 64, blocks, 1, fixtures::kComplexFloat), kspace));
+
+    // Accelerated exams load every channel of a block from one GRAPPA fit, or unfold it with
+    // the SENSE maps of the block kept for the exam
+    const std::pair<int, recon::ParallelImaging> accelerations[] = {
+        {1, recon::ParallelImaging::Grappa},
+        {2, recon::ParallelImaging::Grappa},
+        {2, recon::ParallelImaging::Sense}};
+    for (auto [acceleration, parallelImaging] : accelerations) {
+        recon::Options options;
+        options.coilCombine = recon::CoilCombine::Rss;
+        options.acceleration = acceleration;
+        options.acsLines = 16;
+        options.parallelImaging = parallelImaging;
+        auto eager = response.images(options);
+        auto source = response.imageSource(options);
+        CHECK(eager.size() == 4 && source->channels() == 4 && source->count() == blocks);
+        if (eager.size() != source->channels()) {
+            continue;
+        }
+
+        for (int channel = 0; channel < source->channels(); channel++) {
+            const auto window = image_utils::window(source->image(channel, 0));
+            for (int block = 0; block < blocks; block++) {
+                auto image = source->image(channel, block);
+                const auto &expected = eager[channel][block];
+                CHECK(image_utils::window(image) == window);
+                CHECK(image_utils::window(expected) == window);
+                // Both take the scale from the middle block, only rounding differs
+                CHECK(image.width() == expected.width() && image.height() == expected.height());
+                CHECK(maxDifference(image, expected) <= 1);
+            }
+            // The brightest block still fits below the headroom
+            CHECK(meanPixel(eager[channel][blocks - 1]) > meanPixel(eager[channel][0]));
+        }
+    }
+}
+
+namespace {
+
+/// Two coils of two blocks, 40 of 64 views with the k-space centre included
+QByteArray partialFourierMrd(const QByteArray &ppr = ":NO_SAMPLES 0") {
+    const int acquired = 40;
+    auto kspace = fixtures::coilKspace(2, 2, 64, 64);
+    for (auto &coil : kspace) {
+        std::vector<std::complex<double>> views;
+        for (int b = 0; b < 2; b++) {
+            auto begin = coil.begin() + static_cast<size_t>(b) * 64 * 64;
+            views.insert(views.end(), begin, begin + static_cast<size_t>(acquired) * 64);
+        }
+        coil = std::move(views);
+    }
+    return fixtures::coilMrd(fixtures::header(acquired, 64, 2, 1, fixtures::kComplexFloat), kspace, ppr);
+}
+
+} // namespace
+
+TEST_CASE("MrdResponse partial Fourier exams fill every channel") {
+    MrdResponse response(partialFourierMrd());
+
+    for (auto combine : {recon::CoilCombine::Rss, recon::CoilCombine::None}) {
+        recon::Options options;
+        options.coilCombine = combine;
+        options.fullViews = 64;
+        options.partialFourierAcquired = true;
+        auto eager = response.images(options);
+        auto source = response.imageSource(options);
+        const int channels = combine == recon::CoilCombine::None ? 2 : 3;
+        CHECK(eager.size() == channels && source->channels() == channels);
+        for (int channel = 0; channel < eager.size(); channel++) {
+            CHECK(eager[channel].size() == 2);
+            for (int block = 0; block < source->count(); block++) {
+                CHECK(!eager[channel].value(block).isNull());
+                CHECK(!source->image(channel, block).isNull());
+            }
+        }
+    }
+}
+
+TEST_CASE("MrdResponse fills skipped views only for flagged partial Fourier exams") {
+    recon::Options options;
+    options.fullViews = 64;
+    // Fewer views than prescribed without the flag, e.g. a scan stopped early
+    auto images = MrdResponse(partialFourierMrd()).images(options);
+    CHECK(images.size() == 3 && images[0].size() == 2 && images[0][0].height() == 40);
+
+    // The sequence records it in the PPR
+    images = MrdResponse(partialFourierMrd(":VAR partial_fourier, 1\n")).images(options);
+    CHECK(images.size() == 3 && images[0].size() == 2 && images[0][0].height() == 64);
+
+    // Or the exam sets it
+    options = recon::Options::fromParams({{recon::Options::KEY_PARTIAL_FOURIER_ACQUIRED, true}}, options);
+    CHECK(options.partialFourierAcquired);
+    images = MrdResponse(partialFourierMrd()).images(options);
+    CHECK(images.size() == 3 && images[0].size() == 2 && images[0][0].height() == 64);
+}
+
+TEST_CASE("MrdResponse falls back to the aliased coils when SENSE cannot unfold") {
+    // R = 4 of 100 views, the pattern through view 50 misses view 0
+    auto kspace = fixtures::coilKspace(2, 2, 100, 64);
+    MrdResponse response(fixtures::coilMrd(fixtures::header(100, 64, 2, 1, fixtures::kComplexFloat), kspace));
+    recon::Options options;
+    options.acceleration = 4;
+    options.parallelImaging = recon::ParallelImaging::Sense;
+    auto eager = response.images(options);
+    auto source = response.imageSource(options);
+    CHECK(eager.size() == 3 && source->channels() == 3);
+    for (int channel = 0; channel < eager.size(); channel++) {
+        for (int block = 0; block < 2; block++) {
+            CHECK(!eager[channel].value(block).isNull());
+            CHECK(!source->image(channel, block).isNull());
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include <QDir>
+#include <QFile>
+#include <cstring>
+
+#include "mrdfixtures.h"
+#include "mrdstreamparser.h"
+#include "testing.h"
+#include "utils.h"
+
+using mrd_utils::Mrd;
+using mrd_utils::MrdView;
+
+namespace {
+
+/// Channels handed out by the parser, in order
+struct Received {
+    int headers = 0;
+    QVector<std::shared_ptr<Mrd>> channels;
+
+    void connect(MrdStreamParser &parser) {
+        parser.setHeaderHandler([this](const mrd_utils::MrdHeader &) { headers++; });
+        parser.setChannelHandler([this](int index, std::shared_ptr<Mrd> mrd) {
+            CHECK(index == channels.size());
+            channels.push_back(std::move(mrd));
+        });
+    }
+};
+
+bool sameKspace(const Mrd &a, const Mrd &b) {
+    return a.size() == b.size() && a.kdata && b.kdata &&
+           std::memcmp(a.kdata.get(), b.kdata.get(), a.size() * sizeof(a.kdata[0])) == 0;
+}
+
+} // namespace
+
+TEST_CASE("MrdStreamParser decodes chunked input like the whole file") {
+    auto header = fixtures::header(16, 24, 2);
+    const auto bytes = fixtures::mrdBytes(header, 3, [&](int channel, char *kdata) {
+        auto samples = reinterpret_cast<qint16 *>(kdata);
+        for (size_t i = 0; i < 2 * header.elements(); i++) {
+            samples[i] = static_cast<qint16>((i * 7 + channel * 1000) % 30000 - 15000);
+        }
+    }, ":NO_VIEWS 16\n");
+    const auto expected = Mrd::fromBytes(bytes);
+    CHECK(expected.size() == 3);
+
+    // Chunks smaller than the header, not aligned to samples, and larger than a channel
+    for (qint64 chunkSize : {qint64(1), qint64(7), qint64(100), qint64(513), header.channelBytes() + 3,
+                             qint64(bytes.size())}) {
+        MrdStreamParser parser;
+        Received received;
+        received.connect(parser);
+        for (qint64 offset = 0; offset < bytes.size(); offset += chunkSize) {
+            parser.feed(bytes.mid(offset, chunkSize));
+            // A channel is handed out once another channel and the footer block follow it
+            const qint64 fed = std::min<qint64>(offset + chunkSize, bytes.size());
+            const qint64 handedOut = received.channels.size();
+            CHECK(handedOut == 0 || mrd_utils::kHeaderSize + (handedOut + 1) * header.channelBytes() +
+                                            mrd_utils::kFooterBlockSize <= fed);
+        }
+        CHECK(parser.finish());
+        CHECK(received.headers == 1 && parser.hasHeader());
+        CHECK(parser.channels() == 3 && parser.ppr().toInt("NO_VIEWS") == 16);
+        CHECK(received.channels.size() == expected.size());
+        for (int c = 0; c < std::min(received.channels.size(), expected.size()); c++) {
+            CHECK(received.channels[c] && sameKspace(*received.channels[c], expected[c]));
+        }
+        // The stream was not kept
+        CHECK(parser.view() == nullptr);
+    }
+}
+
+TEST_CASE("MrdStreamParser keeps the stream of a device for the reconstruction") {
+    auto header = fixtures::header(8, 16, 2);
+    const auto bytes = fixtures::noiseMrd(header, 2);
+    auto path = QDir(QDir::tempPath()).filePath("mrscan_tests_stream.mrd");
+    CHECK(file_utils::save(path, bytes));
+
+    QFile file(path);
+    CHECK(file.open(QIODevice::ReadOnly));
+    MrdStreamParser parser;
+    parser.setKeepStream(true);
+    CHECK(parser.parse(&file, 1000));
+    auto view = parser.view();
+    CHECK(view && view->channels() == 2 && view->bytes() == bytes);
+    file.close();
+    QFile::remove(path);
+
+    // A truncated stream fails once it ends, a new stream can follow
+    parser.reset();
+    parser.feed(bytes.left(bytes.size() / 2));
+    CHECK(!parser.finish() && parser.hasError() && parser.view() == nullptr);
+    parser.reset();
+    parser.feed(bytes);
+    CHECK(parser.finish() && parser.view() != nullptr);
+}
@@ -0,0 +1,320 @@
+#include <QDir>
+#include <QFile>
+#include <cstring>
+#include <string>
+
+#include "fftshift.h"
+#include "mrdfixtures.h"
+#include "mrdutils.h"
+#include "parallelutils.h"
+#include "testing.h"
+#include "utils.h"
+
+using mrd_utils::Mrd;
+using mrd_utils::MrdView;
+
+namespace {
+
+template <typename Real>
+bool sameKspace(const mrd_utils::BasicMrd<Real> &a, const mrd_utils::BasicMrd<Real> &b) {
+    return a.size() == b.size() && a.kdata && b.kdata &&
+           std::memcmp(a.kdata.get(), b.kdata.get(), a.size() * sizeof(a.kdata[0])) == 0;
+}
+
+} // namespace
+
+TEST_CASE("mrd_utils parallel channel decode matches serial") {
+    auto header = fixtures::header(32, 48, 3);
+    auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 8));
+    CHECK(view && view->channels() == 8);
+    if (!view) {
+        return;
+    }
+
+    auto serial = Mrd::fromView(*view, 1);
+    CHECK(serial.size() == 8);
+    for (int workers : {2, 3, 8, 0}) {
+        auto parallel = Mrd::fromView(*view, workers);
+        CHECK(parallel.size() == serial.size());
+        for (int c = 0; c < std::min(parallel.size(), serial.size()); c++) {
+            CHECK(sameKspace(parallel[c], serial[c]));
+            // fromChannel decodes one channel on the calling thread
+            CHECK(sameKspace(Mrd::fromChannel(*view, c), serial[c]));
+        }
+    }
+}
+
+TEST_CASE("mrd_utils decode converts int16 samples") {
+    auto header = fixtures::header(2, 4);
+    auto bytes = fixtures::mrdBytes(header, 1, [&](int, char *kdata) {
+        auto samples = reinterpret_cast<qint16 *>(kdata);
+        for (int i = 0; i < 16; i++) {
+            samples[i] = static_cast<qint16>(i % 2 ? -i : i * 1000);
+        }
+    });
+    auto channels = Mrd::fromBytes(bytes);
+    CHECK(channels.size() == 1);
+    if (channels.isEmpty()) {
+        return;
+    }
+    for (int i = 0; i < 8; i++) {
+        CHECK(channels[0].kdata[i][0] == 2 * i * 1000);
+        CHECK(channels[0].kdata[i][1] == -(2 * i + 1));
+    }
+}
+
+BENCHMARK("mrd_utils channel decode, 1/8/32 channels") {
+    // One 256 x 256 x 16 slice int16 channel is 8 MiB of samples
+    auto header = fixtures::header(256, 256, 16);
+    for (int channels : {1, 8, 32}) {
+        auto view = MrdView::fromBytes(fixtures::noiseMrd(header, channels));
+        const double bytes = channels * (header.channelBytes() + header.elements() * 16.0);
+        for (int workers : {1, 0}) {
+            auto seconds = testing::bestOf(3, [&] { Mrd::fromView(*view, workers); });
+            auto threads = workers > 0 ? workers : parallel_utils::maxThreads();
+            testing::report(std::to_string(channels) + " channels, " + std::to_string(threads) +
+                                " workers",
+                            seconds, bytes);
+        }
+    }
+}
+
+namespace {
+
+/// Single coil complex float MRD of the phantom, blocks slices of views x samples
+QByteArray phantomMrd(int blocks, int views, int samples) {
+    auto kspace = fixtures::coilKspace(1, blocks, views, samples)[0];
+    auto header = fixtures::header(views, samples, blocks, 1, fixtures::kComplexFloat);
+    return fixtures::mrdBytes(header, 1, [&](int, char *kdata) {
+        auto samples = reinterpret_cast<float *>(kdata);
+        for (size_t i = 0; i < kspace.size(); i++) {
+            samples[2 * i] = static_cast<float>(kspace[i].real());
+            samples[2 * i + 1] = static_cast<float>(kspace[i].imag());
+        }
+    });
+}
+
+/// Largest difference between two lists of Grayscale16 images, -1 if their shapes differ
+int maxPixelDifference(const QVector<QImage> &a, const QVector<QImage> &b) {
+    if (a.size() != b.size()) {
+        return -1;
+    }
+    int difference = 0;
+    for (int i = 0; i < a.size(); i++) {
+        if (a[i].width() != b[i].width() || a[i].height() != b[i].height() || a[i].format() != QImage::Format_Grayscale16) {
+            return -1;
+        }
+        for (int y = 0; y < a[i].height(); y++) {
+            auto rowA = reinterpret_cast<const quint16 *>(a[i].constScanLine(y));
+            auto rowB = reinterpret_cast<const quint16 *>(b[i].constScanLine(y));
+            for (int x = 0; x < a[i].width(); x++) {
+                difference = std::max(difference, std::abs(int(rowA[x]) - int(rowB[x])));
+            }
+        }
+    }
+    return difference;
+}
+
+} // namespace
+
+TEST_CASE("mrd_utils single precision images match double") {
+    auto view = MrdView::fromBytes(phantomMrd(3, 64, 96));
+    auto single = mrd_utils::MrdF::fromView(*view);
+    auto dual = Mrd::fromView(*view);
+    CHECK(single.size() == 1 && dual.size() == 1);
+    if (single.isEmpty() || dual.isEmpty()) {
+        return;
+    }
+    auto singleImages = single[0].images();
+    CHECK(singleImages.size() == 3);
+    auto difference = maxPixelDifference(singleImages, dual[0].images());
+    // 24-bit mantissas against 16-bit pixels, rounding moves a pixel by a level or two
+    CHECK(difference >= 0 && difference <= 2);
+}
+
+BENCHMARK("mrd_utils single vs double precision reconstruction") {
+    // 8 channels of 16 slices of 256 x 256
+    auto header = fixtures::header(256, 256, 16);
+    auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 8));
+    auto run = [&](auto tag, const char *name) {
+        using M = decltype(tag);
+        size_t bytes = 0;
+        auto seconds = testing::bestOf(3, [&] {
+            auto channels = M::fromView(*view);
+            bytes = 0;
+            for (auto &channel : channels) {
+                bytes += channel.size() * sizeof(channel.kdata[0]);
+                channel.takeImages();
+            }
+        });
+        testing::report(std::string(name) + " decode + recon, " + std::to_string(bytes >> 20) +
+                            " MiB k-space",
+                        seconds);
+    };
+    run(Mrd(), "double");
+    run(mrd_utils::MrdF(), "single");
+}
+
+TEST_CASE("mrd_utils shift-free decode matches the fftshift path") {
+    // 2D multi-slice, 3D and a singleton axis, every dimension even or 1
+    for (auto header : {fixtures::header(32, 48, 3), fixtures::header(16, 24, 1, 8),
+                        fixtures::header(1, 64, 2)}) {
+        auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 1));
+        auto shifted = Mrd::fromKspace(view->header(), view->channel(0), view->ppr(), false);
+        auto centred = Mrd::fromKspace(view->header(), view->channel(0), view->ppr(), true);
+        CHECK(!shifted.centred && centred.centred);
+        auto images = centred.images();
+        CHECK(!images.isEmpty());
+        auto difference = maxPixelDifference(images, shifted.images());
+        CHECK(difference >= 0 && difference <= 1);
+    }
+
+    // Odd lengths are not a half period shift, the plain decode is used
+    auto odd = MrdView::fromBytes(fixtures::noiseMrd(fixtures::header(15, 32), 1));
+    CHECK(!Mrd::fromKspace(odd->header(), odd->channel(0), odd->ppr(), true).centred);
+}
+
+BENCHMARK("mrd_utils shift-free vs fftshift reconstruction") {
+    // 64 slices of 256 x 256, one channel
+    auto header = fixtures::header(256, 256, 64);
+    auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 1));
+    for (bool centre : {false, true}) {
+        auto seconds = testing::bestOf(3, [&] {
+            Mrd::fromKspace(view->header(), view->channel(0), view->ppr(), centre).takeImages();
+        });
+        testing::report(centre ? "modulated decode, no shift pass" : "decode + fftshift", seconds);
+    }
+}
+
+TEST_CASE("mrd_utils probe reads the header and footer only") {
+    auto header = fixtures::header(8, 16, 2);
+    // A PPR longer than one chunk of the backwards scan
+    QByteArray ppr(100 * 1024, ' ');
+    ppr.prepend(":NO_VIEWS 8\n");
+    const auto bytes = fixtures::mrdBytes(header, 3, [&](int, char *kdata) {
+        std::memset(kdata, 1, header.channelBytes());
+    }, ppr);
+    auto path = QDir(QDir::tempPath()).filePath("mrscan_tests_probe.mrd");
+    CHECK(file_utils::save(path, bytes));
+
+    auto info = mrd_utils::probe(path);
+    CHECK(info.valid && info.error.isEmpty());
+    CHECK(info.header == header && info.channels == 3 && info.fileSize == bytes.size());
+    CHECK(info.payloadSize == info.expectedPayloadSize() && info.payloadSize == 3 * header.channelBytes());
+    CHECK(info.ppr.toInt("NO_VIEWS") == 8);
+    CHECK(info.decodedSize() == 3 * static_cast<qint64>(header.elements()) * 16);
+    CHECK(info.decodedSize(true) == 3 * static_cast<qint64>(header.elements()) * 8);
+
+    // Shorter than the header, a payload that is not whole channels, a missing file
+    CHECK(file_utils::save(path, bytes.left(100)));
+    info = mrd_utils::probe(path);
+    CHECK(!info.valid && !info.error.isEmpty());
+    CHECK(file_utils::save(path, bytes.left(mrd_utils::kHeaderSize) + QByteArray(1, '\x01') +
+                                     bytes.mid(mrd_utils::kHeaderSize)));
+    CHECK(!mrd_utils::probe(path).valid);
+    QFile::remove(path);
+    info = mrd_utils::probe(path);
+    CHECK(!info.valid && !info.error.isEmpty());
+}
+
+TEST_CASE("mrd_utils transform copies k-space shared with another Mrd") {
+    auto header = fixtures::header(16, 32, 2);
+    auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 1));
+    CHECK(view != nullptr);
+    if (!view) {
+        return;
+    }
+    const auto original = Mrd::fromChannel(*view, 0);
+
+    // A copy shares the buffer until one of them writes
+    auto shared = Mrd::fromChannel(*view, 0);
+    auto copy = shared;
+    CHECK(copy.kdata.get() == shared.kdata.get());
+    CHECK(copy.transform() && copy.transformed);
+    CHECK(copy.kdata.get() != shared.kdata.get());
+    CHECK(!shared.transformed && sameKspace(shared, original));
+
+    // The sole owner transforms its own buffer
+    auto unique = Mrd::fromChannel(*view, 0);
+    const auto *buffer = unique.kdata.get();
+    CHECK(unique.transform() && unique.kdata.get() == buffer);
+    CHECK(sameKspace(unique, copy));
+    // Transforming twice is a no-op
+    CHECK(unique.transform() && unique.kdata.get() == buffer && sameKspace(unique, copy));
+}
+
+TEST_CASE("mrd_utils in-place FFT matches the separate buffer") {
+    // Batched 2D transforms of an odd and an even length
+    const std::vector<int> n{12, 9};
+    const int howmany = 3;
+    const size_t size = 12 * 9 * howmany;
+    auto data = fftw_utils::createArray<double>(size);
+    std::vector<std::complex<double>> original(size);
+    for (size_t i = 0; i < size; i++) {
+        original[i] = {std::sin(0.37 * i), std::cos(0.11 * i * i)};
+        data[i][0] = original[i].real();
+        data[i][1] = original[i].imag();
+    }
+
+    auto expected = fftw_utils::exec_fft<double>(data.get(), n, howmany);
+    CHECK(expected != nullptr);
+    CHECK(fftw_utils::exec_fft_inplace(data.get(), n, howmany));
+    if (expected) {
+        CHECK(fixtures::relativeError(data.get(), expected.get(), size) < 1e-12);
+    }
+    // Backward undoes it up to the size of one transform
+    CHECK(fftw_utils::exec_ifft_inplace(data.get(), n, howmany));
+    for (size_t i = 0; i < size; i++) {
+        data[i][0] /= 12 * 9;
+        data[i][1] /= 12 * 9;
+    }
+    CHECK(fixtures::relativeError(data.get(), original.data(), size) < 1e-12);
+    CHECK(!fftw_utils::exec_fft_inplace(data.get(), {0, 9}));
+
+    // takeImages() transforms the k-space itself and releases it
+    auto channels = Mrd::fromView(*MrdView::fromBytes(phantomMrd(3, 64, 96)));
+    CHECK(channels.size() == 1);
+    if (channels.isEmpty()) {
+        return;
+    }
+    auto images = channels[0].images();
+    CHECK(channels[0].kdata && !channels[0].transformed);
+    CHECK(maxPixelDifference(channels[0].takeImages(), images) == 0);
+    CHECK(channels[0].kdata == nullptr);
+}
+
+TEST_CASE("mrd_utils 2D slices and 3D volumes get their own transforms") {
+    // {views, views2, samples} of one block and the transform expected for it
+    struct Case {
+        int slices;
+        int views2;
+        std::vector<int> transform;
+    };
+    const Case cases[] = {
+        // Multi-slice 2D, every slice on its own
+        {3, 1, {16, 12}},
+        // One 3D volume, the partitions are transformed together
+        {1, 4, {16, 4, 12}},
+    };
+    for (const auto &c : cases) {
+        auto header = fixtures::header(16, 12, c.slices, c.views2);
+        auto view = MrdView::fromBytes(fixtures::noiseMrd(header, 1));
+        auto mrd = Mrd::fromChannel(*view, 0);
+        const auto kspace = mrd;
+        CHECK(mrd.transform());
+        CHECK(mrd.images().size() == c.slices * c.views2);
+
+        const size_t blockSize = static_cast<size_t>(16) * c.views2 * 12;
+        for (int block = 0; block < c.slices; block++) {
+            auto expected = fftw_utils::exec_fft<double>(kspace.kdata.get() + block * blockSize,
+                                                         c.transform);
+            CHECK(expected != nullptr);
+            if (!expected) {
+                continue;
+            }
+            CHECK(fftw_utils::fftshift(expected.get(), {1, 16, c.views2, 12}, {1, 2, 3}));
+            CHECK(fixtures::relativeError(mrd.kdata.get() + block * blockSize, expected.get(),
+                                          blockSize) < 1e-12);
+        }
+    }
+}
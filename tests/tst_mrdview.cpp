@@ -0,0 +1,51 @@
+#include <QDir>
+#include <QFile>
+#include <cstring>
+
+#include "mrdfixtures.h"
+#include "mrdview.h"
+#include "testing.h"
+#include "utils.h"
+
+using mrd_utils::MrdView;
+
+TEST_CASE("mrd_utils MrdView maps a file and points its channels into the mapping") {
+    auto header = fixtures::header(8, 16, 2);
+    const auto bytes = fixtures::noiseMrd(header, 3);
+    auto path = QDir(QDir::tempPath()).filePath("mrscan_tests_view.mrd");
+    CHECK(file_utils::save(path, bytes));
+
+    auto view = MrdView::open(path);
+    CHECK(view != nullptr);
+    if (view) {
+        CHECK(view->header() == header && view->channels() == 3 && view->size() == bytes.size());
+        CHECK(std::memcmp(view->data(), bytes.constData(), bytes.size()) == 0);
+        // Channels are read in place, nothing is decoded or copied until asked for
+        for (int c = 0; c < view->channels(); c++) {
+            auto channel = view->channel(c);
+            CHECK(channel.data == view->data() + mrd_utils::kHeaderSize + c * header.channelBytes());
+            CHECK(channel.elements == header.elements() && channel.datatype == header.datatype);
+        }
+        CHECK(view->channel(3).data == nullptr && view->channel(-1).data == nullptr);
+        // The raw bytes of a mapped file refer to the mapping
+        CHECK(view->bytes().constData() == view->data() && view->bytes() == bytes);
+    }
+    view.reset();
+    QFile::remove(path);
+    CHECK(MrdView::open(path) == nullptr);
+}
+
+TEST_CASE("mrd_utils MrdView shares the bytes it wraps and rejects malformed files") {
+    auto header = fixtures::header(8, 16);
+    const auto bytes = fixtures::noiseMrd(header, 2);
+    auto view = MrdView::fromBytes(bytes);
+    CHECK(view && view->data() == bytes.constData() && view->channels() == 2);
+
+    // Shorter than the header, a payload that is not whole channels, an unknown datatype
+    CHECK(MrdView::fromBytes(bytes.left(mrd_utils::kHeaderSize - 1)) == nullptr);
+    CHECK(MrdView::fromBytes(bytes.left(mrd_utils::kHeaderSize) + QByteArray(1, 'x') +
+                             bytes.mid(mrd_utils::kHeaderSize)) == nullptr);
+    auto unknown = header;
+    unknown.datatype = 0x1f;
+    CHECK(MrdView::fromBytes(fixtures::mrdBytes(unknown, 1, [](int, char *) {})) == nullptr);
+}
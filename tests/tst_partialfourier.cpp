@@ -0,0 +1,173 @@
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "builtinfft.h"
+#include "partialfourier.h"
+#include "testing.h"
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/// Image and centred k-space of an object with a smooth phase, what homodyne and POCS assume
+struct Phantom {
+    int blocks = 0;
+    int views = 0;
+    int samples = 0;
+    std::vector<Complex> image;
+    std::vector<Complex> kspace;
+
+    Phantom(int blocks, int views, int samples)
+        : blocks(blocks), views(views), samples(samples), image(size()), kspace(size()) {
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < views; y++) {
+                for (int x = 0; x < samples; x++) {
+                    const double dy = (y - views / 2) / (views / 2.0);
+                    const double dx = (x - samples / 2) / (samples / 2.0);
+                    double r = std::hypot(dy / 0.6, dx / (0.45 + 0.03 * b));
+                    double magnitude = r < 1 ? 1.0 + 0.3 * std::cos(x * 0.4) : 0.0;
+                    double phase = 0.6 * dy + 0.4 * dx * dx + b;
+                    image[index(b, y, x)] = std::polar(magnitude, phase);
+                }
+            }
+        }
+        // k-space of the centred image is ifftshift, inverse FFT, fftshift, all shifts even
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < views; y++) {
+                for (int x = 0; x < samples; x++) {
+                    kspace[shifted(b, y, x)] = image[index(b, y, x)];
+                }
+            }
+        }
+        builtin_fft::transform(kspace.data(), {views, samples}, blocks, +1);
+        auto unshifted = kspace;
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < views; y++) {
+                for (int x = 0; x < samples; x++) {
+                    kspace[shifted(b, y, x)] = unshifted[index(b, y, x)] / static_cast<double>(views * samples);
+                }
+            }
+        }
+    }
+
+    size_t size() const { return static_cast<size_t>(blocks) * views * samples; }
+    size_t index(int b, int y, int x) const { return (static_cast<size_t>(b) * views + y) * samples + x; }
+    size_t shifted(int b, int y, int x) const {
+        return index(b, (y + views / 2) % views, (x + samples / 2) % samples);
+    }
+
+    /// The acquired views [offset, offset + acquired), modulated like decodeCentredInto if centred
+    mrd_utils::Mrd acquire(int acquired, int offset, bool centred) const {
+        mrd_utils::Mrd mrd;
+        mrd.experiments = 1;
+        mrd.echoes = 1;
+        mrd.slices = blocks;
+        mrd.views = acquired;
+        mrd.views2 = 1;
+        mrd.samples = samples;
+        mrd.centred = centred;
+        auto buffer = fftw_utils::createArray<double>(mrd.size());
+        for (int b = 0; b < blocks; b++) {
+            for (int y = 0; y < acquired; y++) {
+                for (int x = 0; x < samples; x++) {
+                    auto value = kspace[index(b, y + offset, x)];
+                    if (centred && (y + x) % 2) {
+                        value = -value;
+                    }
+                    auto &out = buffer[(static_cast<size_t>(b) * acquired + y) * samples + x];
+                    out[0] = value.real();
+                    out[1] = value.imag();
+                }
+            }
+        }
+        mrd.kdata = std::move(buffer);
+        return mrd;
+    }
+
+    /// |image| error of the reconstruction relative to the phantom
+    double magnitudeError(const mrd_utils::Mrd &mrd) const {
+        double error = 0;
+        double reference = 0;
+        for (size_t i = 0; i < size(); i++) {
+            double magnitude = std::hypot(mrd.kdata[i][0], mrd.kdata[i][1]);
+            error += (magnitude - std::abs(image[i])) * (magnitude - std::abs(image[i]));
+            reference += std::norm(image[i]);
+        }
+        return std::sqrt(error / reference);
+    }
+};
+
+const char *methodName(recon::PartialFourier method) {
+    switch (method) {
+    case recon::PartialFourier::ZeroFill:
+        return "zero fill";
+    case recon::PartialFourier::Homodyne:
+        return "homodyne";
+    case recon::PartialFourier::Pocs:
+        return "POCS";
+    }
+    return "";
+}
+
+} // namespace
+
+TEST_CASE("partial_fourier locate finds the acquired views") {
+    Phantom phantom(2, 64, 48);
+    for (int offset : {0, 24}) {
+        auto coverage = partial_fourier::locate(phantom.acquire(40, offset, false), 64);
+        CHECK(coverage.isPartial());
+        CHECK(coverage.offset == offset);
+        CHECK(coverage.acquired == 40);
+        CHECK(coverage.symmetricViews() >= partial_fourier::kMinSymmetricViews);
+    }
+    CHECK(!partial_fourier::locate(phantom.acquire(64, 0, false), 64).isPartial());
+    // Half or less is no partial Fourier acquisition
+    CHECK(!partial_fourier::locate(phantom.acquire(32, 0, false), 64).isPartial());
+}
+
+TEST_CASE("partial_fourier estimates approach the full k-space") {
+    Phantom phantom(3, 64, 64);
+    for (bool centred : {false, true}) {
+        for (int offset : {0, 24}) {
+            auto acquired = phantom.acquire(40, offset, centred);
+            auto coverage = partial_fourier::locate(acquired, 64);
+            double errors[3] = {};
+            for (auto method : {recon::PartialFourier::ZeroFill, recon::PartialFourier::Homodyne,
+                                recon::PartialFourier::Pocs}) {
+                auto mrd = partial_fourier::zeroFill(acquired, coverage);
+                CHECK(mrd.views == 64);
+                CHECK(partial_fourier::reconstruct(mrd, coverage, method));
+                errors[static_cast<int>(method)] = phantom.magnitudeError(mrd);
+            }
+            // Every method beats the one before it on a smooth phase
+            CHECK(errors[0] < 0.15);
+            CHECK(errors[1] < 0.6 * errors[0]);
+            CHECK(errors[2] < 0.5 * errors[1]);
+            CHECK(errors[2] < 0.02);
+        }
+    }
+}
+
+BENCHMARK("partial_fourier latency per slice") {
+    // 16 slices of 256 x 256 acquired with 5/8 of the views
+    const int blocks = 16;
+    Phantom phantom(blocks, 256, 256);
+    auto acquired = phantom.acquire(160, 0, true);
+    auto coverage = partial_fourier::locate(acquired, 256);
+    auto full = phantom.acquire(256, 0, true);
+
+    auto perSlice = [&](double seconds) { return seconds / blocks; };
+    testing::report("full k-space FFT", perSlice(testing::bestOf(3, [&] {
+        auto mrd = full;
+        mrd.transform();
+    })));
+    for (auto method : {recon::PartialFourier::ZeroFill, recon::PartialFourier::Homodyne,
+                        recon::PartialFourier::Pocs}) {
+        auto seconds = testing::bestOf(3, [&] {
+            auto mrd = partial_fourier::zeroFill(acquired, coverage);
+            partial_fourier::reconstruct(mrd, coverage, method);
+        });
+        testing::report(std::string("5/8 views, ") + methodName(method), perSlice(seconds));
+    }
+}
@@ -0,0 +1,147 @@
+#include <QDir>
+#include <QFile>
+#include <cstring>
+
+#include "utils.h"
+#include "mrdfixtures.h"
+#include "mrdutils.h"
+#include "ppr.h"
+#include "testing.h"
+
+using mrd_utils::Acquisition;
+using mrd_utils::Mrd;
+using mrd_utils::MrdView;
+using mrd_utils::Ppr;
+
+namespace {
+
+/// 64 x 64 single coil phantom, views written in the order of table
+QByteArray tableMrd(const QVector<int> &table) {
+    auto kspace = fixtures::coilKspace(1, 1, 64, 64);
+    auto &coil = kspace[0];
+    auto written = coil;
+    for (int view = 0; view < table.size(); view++) {
+        std::copy_n(coil.begin() + table[view] * 64, 64, written.begin() + view * 64);
+    }
+    coil = written;
+    return fixtures::coilMrd(fixtures::header(64, 64, 1, 1, fixtures::kComplexFloat), kspace);
+}
+
+/// MRD bytes of the fixtures with their PPR replaced
+QByteArray withPpr(const QByteArray &bytes, const QByteArray &ppr) {
+    return bytes.left(bytes.size() - QByteArray(":NO_SAMPLES 0").size()) + ppr;
+}
+
+} // namespace
+
+TEST_CASE("mrd_utils PPR keys, variables and fields") {
+    auto ppr = Ppr::parse(":NO_SAMPLES 256\r\n:NO_VIEWS 192\n\n  :VAR accel_factor, 2\n"
+                          ":FOV_OFFSETS 1.5, -2, 0.25\ncomment line\n:VAR pe1_table, -1, 0, 1\n");
+    CHECK(ppr.toInt("NO_SAMPLES") == 256);
+    CHECK(ppr.toInt(Acquisition::KEY_VIEWS) == 192);
+    CHECK(ppr.toInt(Acquisition::KEY_ACCELERATION) == 2);
+    CHECK(ppr.fields("FOV_OFFSETS") == QStringList({"1.5", "-2", "0.25"}));
+    CHECK_NEAR(ppr.toDouble("FOV_OFFSETS"), 0.25, 1e-12);
+    CHECK(!ppr.contains("comment"));
+    CHECK(ppr.toInt("MISSING", 7) == 7);
+
+    auto acquisition = Acquisition::fromPpr(ppr);
+    CHECK(acquisition.views == 192 && acquisition.acceleration == 2);
+    CHECK(acquisition.viewTable == QVector<int>({-1, 0, 1}));
+    // Offsets -1, 0, 1 of 3 views are already in order, a table of another length is ignored
+    CHECK(acquisition.viewPositions(3).isEmpty());
+    CHECK(acquisition.viewPositions(4).isEmpty());
+    CHECK(acquisition.oversampling == 1 && acquisition.fieldOfViewSamples(256) == 256);
+}
+
+TEST_CASE("mrd_utils truncated PPR keeps its complete lines") {
+    // The transfer stopped inside the last line
+    auto ppr = Ppr::parse(":NO_VIEWS 128\n:VAR read_oversampling, 2\n:VAR accel_fa");
+    auto acquisition = Acquisition::fromPpr(ppr);
+    CHECK(acquisition.views == 128);
+    CHECK(acquisition.oversampling == 2);
+    CHECK(acquisition.acceleration == 0);
+    // A number cut short still parses, a field cut to nothing falls back to the default
+    CHECK(Ppr::parse(":NO_VIEWS 12").toInt("NO_VIEWS") == 12);
+    CHECK(Ppr::parse(":VAR acs_lines,").toInt(Acquisition::KEY_ACS_LINES, 24) == 24);
+    CHECK(Acquisition::fromPpr(Ppr::parse(":VAR pe1_table, 0, 1, ")).viewTable.isEmpty());
+}
+
+TEST_CASE("mrd_utils MRD without a footer within the last MiB is rejected") {
+    auto header = fixtures::header(8, 8);
+    // PPR text longer than the scanned tail, the '\0' before it is out of reach
+    QByteArray ppr(mrd_utils::kMaxFooterScan + 16, ' ');
+    ppr.prepend(":NO_VIEWS 8\n");
+    auto bytes = fixtures::mrdBytes(header, 1, [&](int, char *kdata) {
+        std::memset(kdata, 1, header.channelBytes());
+    }, ppr);
+    CHECK(MrdView::fromBytes(bytes) == nullptr);
+
+    auto path = QDir(QDir::tempPath()).filePath("mrscan_tests_no_footer.mrd");
+    CHECK(file_utils::save(path, bytes));
+    auto info = mrd_utils::probe(path);
+    CHECK(!info.valid && !info.error.isEmpty());
+    QFile::remove(path);
+
+    // Within reach both find it
+    bytes = fixtures::mrdBytes(header, 1, [&](int, char *kdata) {
+        std::memset(kdata, 1, header.channelBytes());
+    }, ":NO_VIEWS 8\n");
+    CHECK(file_utils::save(path, bytes));
+    auto view = MrdView::fromBytes(bytes);
+    CHECK(view && view->ppr().toInt("NO_VIEWS") == 8);
+    info = mrd_utils::probe(path);
+    CHECK(info.valid && info.ppr.toInt("NO_VIEWS") == 8);
+    QFile::remove(path);
+}
+
+TEST_CASE("mrd_utils view table puts the views in k-space order") {
+    // Centre out, as offsets from the k-space centre
+    QVector<int> table;
+    QByteArray ppr = ":VAR pe1_table";
+    for (int i = 0; i < 64; i++) {
+        const int offset = i % 2 ? -(i + 1) / 2 : i / 2;
+        table.push_back(offset + 32);
+        ppr += ", ";
+        ppr += QByteArray::number(offset);
+    }
+    ppr += "\n";
+
+    auto reference = MrdView::fromBytes(tableMrd(QVector<int>()));
+    auto reordered = MrdView::fromBytes(withPpr(tableMrd(table), ppr));
+    CHECK(reference && reordered);
+    if (!reference || !reordered) {
+        return;
+    }
+    CHECK(Acquisition::fromPpr(reordered->ppr()).viewPositions(64) == table);
+
+    for (bool centre : {false, true}) {
+        auto expected = Mrd::fromKspace(reference->header(), reference->channel(0), reference->ppr(), centre);
+        auto mrd = Mrd::fromKspace(reordered->header(), reordered->channel(0), reordered->ppr(), centre);
+        CHECK(mrd.centred == centre && expected.centred == centre);
+        CHECK(mrd.size() == expected.size() &&
+              std::memcmp(mrd.kdata.get(), expected.kdata.get(), mrd.size() * sizeof(mrd.kdata[0])) == 0);
+    }
+    auto channels = Mrd::fromView(*reordered);
+    auto expected = Mrd::fromView(*reference);
+    CHECK(channels.size() == 1 && expected.size() == 1);
+    if (channels.size() == 1 && expected.size() == 1) {
+        CHECK(std::memcmp(channels[0].kdata.get(), expected[0].kdata.get(),
+                          expected[0].size() * sizeof(expected[0].kdata[0])) == 0);
+    }
+}
+
+TEST_CASE("mrd_utils oversampled readout shows the field of view") {
+    auto bytes = withPpr(tableMrd(QVector<int>()), ":VAR read_oversampling, 2\n");
+    auto channels = Mrd::fromBytes(bytes);
+    CHECK(channels.size() == 1);
+    if (channels.isEmpty()) {
+        return;
+    }
+    auto images = channels[0].images();
+    CHECK(images.size() == 1 && images[0].width() == 32 && images[0].height() == 64);
+
+    // Not divisible, every sample is shown
+    channels = Mrd::fromBytes(withPpr(tableMrd(QVector<int>()), ":VAR read_oversampling, 3\n"));
+    CHECK(channels.size() == 1 && channels[0].images().value(0).width() == 64);
+}
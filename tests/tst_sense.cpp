@@ -0,0 +1,171 @@
+#include <complex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mrdfixtures.h"
+#include "sense.h"
+#include "testing.h"
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/// Folded coils and maps of a phantom, and its fully sampled coil images
+struct SenseCase {
+    int blocks = 0;
+    int size = 0;
+    grappa::Sampling sampling;
+    QVector<mrd_utils::Mrd> folded;
+    QVector<mrd_utils::Mrd> maps;
+    QVector<mrd_utils::Mrd> full;
+
+    SenseCase(int coils, int blocks, int size, int acceleration)
+        : blocks(blocks), size(size), sampling(size, acceleration, 24) {
+        auto kspace = fixtures::coilKspace(coils, blocks, size, size);
+        folded = fixtures::coilMrds(kspace, blocks, size, size,
+                                    [&](int view) { return sampling.isAcquired(view); });
+        full = fixtures::coilMrds(kspace, blocks, size, size, [](int) { return true; });
+        maps = sense::sensitivities(folded, sampling);
+        for (auto &coil : folded) {
+            sense::fold(coil, sampling);
+        }
+        for (auto &coil : full) {
+            coil.transform();
+        }
+    }
+
+    size_t pixels() const { return static_cast<size_t>(blocks) * size * size; }
+
+    /// |sum_c conj(s_c) x_c| of the full coil images, what SENSE estimates without aliasing
+    std::vector<double> reference() const {
+        std::vector<double> magnitude(pixels());
+        for (size_t i = 0; i < pixels(); i++) {
+            Complex sum;
+            for (int c = 0; c < full.size(); c++) {
+                sum += std::conj(Complex(maps[c].kdata[i][0], maps[c].kdata[i][1])) *
+                       Complex(full[c].kdata[i][0], full[c].kdata[i][1]);
+            }
+            magnitude[i] = std::abs(sum);
+        }
+        return magnitude;
+    }
+
+    /// RSS of the folded coils, what the combined channel shows if SENSE is not used
+    std::vector<double> aliased() const {
+        std::vector<double> magnitude(pixels());
+        for (size_t i = 0; i < pixels(); i++) {
+            double sum = 0;
+            for (const auto &coil : folded) {
+                sum += std::norm(Complex(coil.kdata[i][0], coil.kdata[i][1]));
+            }
+            magnitude[i] = std::sqrt(sum);
+        }
+        return magnitude;
+    }
+};
+
+/// Relative error of a against b after the least squares scale of a, the images differ by one
+double scaledError(const std::vector<double> &a, const std::vector<double> &b) {
+    double ab = 0;
+    double aa = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        ab += a[i] * b[i];
+        aa += a[i] * a[i];
+    }
+    const double scale = aa > 0 ? ab / aa : 0;
+    double error = 0;
+    double reference = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        error += (scale * a[i] - b[i]) * (scale * a[i] - b[i]);
+        reference += b[i] * b[i];
+    }
+    return std::sqrt(error / reference);
+}
+
+std::vector<double> magnitudes(const mrd_utils::Mrd &mrd) {
+    std::vector<double> magnitude(mrd.size());
+    for (size_t i = 0; i < magnitude.size(); i++) {
+        magnitude[i] = std::hypot(mrd.kdata[i][0], mrd.kdata[i][1]);
+    }
+    return magnitude;
+}
+
+} // namespace
+
+TEST_CASE("sense unfolds close to the fully sampled reconstruction") {
+    // Bound of the error against the fully sampled coils combined by the maps
+    const std::pair<int, double> bounds[] = {{2, 0.05}, {4, 0.15}};
+    for (auto [acceleration, bound] : bounds) {
+        SenseCase senseCase(16, 2, 64, acceleration);
+        CHECK(senseCase.maps.size() == 16);
+        auto unfolded = sense::unfold(senseCase.folded, senseCase.maps, acceleration);
+        CHECK(unfolded.kdata && unfolded.transformed && unfolded.size() == senseCase.pixels());
+        if (!unfolded.kdata) {
+            continue;
+        }
+        const auto reference = senseCase.reference();
+        const double error = scaledError(magnitudes(unfolded), reference);
+        CHECK(error < bound);
+        // Folded coils overlap acceleration copies of the object
+        CHECK(error < 0.25 * scaledError(senseCase.aliased(), reference));
+    }
+}
+
+TEST_CASE("sense rejects an acceleration that does not divide the views") {
+    SenseCase senseCase(4, 1, 48, 2);
+    CHECK(!sense::unfold(senseCase.folded, senseCase.maps, 5).kdata);
+    CHECK(!sense::unfold(senseCase.folded, senseCase.maps, sense::kMaxAcceleration + 2).kdata);
+    senseCase.maps.pop_back();
+    CHECK(!sense::unfold(senseCase.folded, senseCase.maps, 2).kdata);
+}
+
+TEST_CASE("sense rejects a pattern whose replicas differ in phase") {
+    // R = 4 divides 100 views, but the pattern through view 50 misses view 0
+    CHECK(sense::canUnfold(48, 4) && sense::canUnfold(100, 2));
+    CHECK(!sense::canUnfold(100, 4) && !sense::canUnfold(48, 5));
+
+    grappa::Sampling sampling(100, 4, 24);
+    auto kspace = fixtures::coilKspace(2, 1, 100, 64);
+    auto coils = fixtures::coilMrds(kspace, 1, 100, 64, [&](int view) { return sampling.isAcquired(view); });
+    auto maps = sense::sensitivities(coils, sampling);
+    auto data = coils[0].kdata.get();
+    CHECK(!sense::fold(coils[0], sampling));
+    CHECK(!coils[0].transformed && coils[0].kdata.get() == data);
+
+    // Folded anyway, unfold refuses them
+    for (auto &coil : coils) {
+        coil.transform();
+    }
+    CHECK(!sense::unfold(coils, maps, 4).kdata);
+}
+
+BENCHMARK("sense stages against the fully sampled reconstruction") {
+    // 4 slices of 256 x 256, 16 coils, R = 4
+    const int coils = 16;
+    const int acceleration = 4;
+    auto kspace = fixtures::coilKspace(coils, 4, 256, 256);
+    grappa::Sampling sampling(256, acceleration, 24);
+    auto acquired = fixtures::coilMrds(kspace, 4, 256, 256,
+                                       [&](int view) { return sampling.isAcquired(view); });
+    auto full = fixtures::coilMrds(kspace, 4, 256, 256, [](int) { return true; });
+    auto maps = sense::sensitivities(acquired, sampling);
+    auto folded = acquired;
+    for (auto &coil : folded) {
+        sense::fold(coil, sampling);
+    }
+
+    testing::report("fully sampled FFT of every coil", testing::bestOf(3, [&] {
+        for (auto coil : full) {
+            coil.transform();
+        }
+    }));
+    testing::report("sensitivities", testing::bestOf(3, [&] { sense::sensitivities(acquired, sampling); }));
+    testing::report("fold every coil", testing::bestOf(3, [&] {
+        for (auto coil : acquired) {
+            sense::fold(coil, sampling);
+        }
+    }));
+    testing::report("unfold, R = " + std::to_string(acceleration),
+                    testing::bestOf(3, [&] { sense::unfold(folded, maps, acceleration); }));
+}
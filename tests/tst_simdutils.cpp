@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "simdutils.h"
+#include "testing.h"
+
+using simd_utils::Isa;
+
+namespace {
+
+/// Lengths around the 4/8 element vector widths and their tails
+const size_t kLengths[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 33, 1001};
+
+/// Instruction sets above Scalar the running CPU supports
+std::vector<Isa> vectorIsas() {
+    std::vector<Isa> isas;
+    for (auto isa : {Isa::Sse2, Isa::Avx2}) {
+        if (static_cast<int>(isa) <= static_cast<int>(simd_utils::detectedIsa())) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+/// Restores the detected instruction set when a case ends
+struct IsaGuard {
+    ~IsaGuard() { simd_utils::setActiveIsa(simd_utils::detectedIsa()); }
+};
+
+template <typename T>
+std::vector<T> randomSamples(size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<T> values(n);
+    for (auto &value : values) {
+        if constexpr (std::is_floating_point_v<T>) {
+            value = static_cast<T>(std::uniform_real_distribution<double>(-1e4, 1e4)(gen));
+        } else {
+            // Full range of the type, extremes included
+            using Wide = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+            std::uniform_int_distribution<Wide> dist(std::numeric_limits<T>::min(),
+                                                     std::numeric_limits<T>::max());
+            value = static_cast<T>(dist(gen));
+        }
+    }
+    return values;
+}
+
+template <typename Real>
+std::vector<Real> randomComplex(size_t n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-100, 100);
+    std::vector<Real> values(2 * n);
+    for (auto &value : values) {
+        value = static_cast<Real>(dist(gen));
+    }
+    return values;
+}
+
+template <typename Real>
+using ComplexOf = std::conditional_t<std::is_same_v<Real, double>, fftw_complex, fftwf_complex>;
+
+template <typename Real>
+ComplexOf<Real> *asComplex(std::vector<Real> &values) {
+    return reinterpret_cast<ComplexOf<Real> *>(values.data());
+}
+
+template <typename Real>
+const ComplexOf<Real> *asComplex(const std::vector<Real> &values) {
+    return reinterpret_cast<const ComplexOf<Real> *>(values.data());
+}
+
+/// toComplex of every ISA must match the scalar conversion exactly, the tail included
+template <typename T, typename Real>
+void checkToComplex() {
+    IsaGuard guard;
+    for (bool isComplex : {false, true}) {
+        for (auto n : kLengths) {
+            auto src = randomSamples<T>(2 * n + 1, static_cast<unsigned>(n));
+            // One extra element detects writes past n
+            std::vector<Real> expected(2 * n + 2, Real(-1));
+            simd_utils::setActiveIsa(Isa::Scalar);
+            simd_utils::toComplex(src.data(), asComplex(expected), n, isComplex);
+            for (auto isa : vectorIsas()) {
+                simd_utils::setActiveIsa(isa);
+                std::vector<Real> actual(2 * n + 2, Real(-1));
+                simd_utils::toComplex(src.data(), asComplex(actual), n, isComplex);
+                CHECK(actual == expected);
+            }
+        }
+    }
+}
+
+template <typename Real>
+void checkAccumulators() {
+    IsaGuard guard;
+    const double tol = std::is_same_v<Real, double> ? 1e-12 : 1e-5;
+    for (auto n : kLengths) {
+        auto a = randomComplex<Real>(n, 1);
+        auto b = randomComplex<Real>(n, 2);
+
+        simd_utils::setActiveIsa(Isa::Scalar);
+        auto peak = simd_utils::maxNorm(asComplex(a), n);
+        std::vector<std::uint16_t> gray(n);
+        auto scale = static_cast<Real>(peak > 0 ? 65535 / std::sqrt(peak) : 0);
+        simd_utils::magnitudeToGray16(asComplex(a), gray.data(), n, scale);
+        std::vector<Real> norm(n, Real(1));
+        simd_utils::addNorm(asComplex(a), norm.data(), n);
+        std::vector<Real> product(2 * n, Real(1));
+        simd_utils::addConjugateProduct(asComplex(a), asComplex(b), asComplex(product), n);
+
+        for (auto isa : vectorIsas()) {
+            simd_utils::setActiveIsa(isa);
+            CHECK_NEAR(simd_utils::maxNorm(asComplex(a), n), peak, tol * peak);
+
+            std::vector<std::uint16_t> actualGray(n);
+            simd_utils::magnitudeToGray16(asComplex(a), actualGray.data(), n, scale);
+            for (size_t i = 0; i < n; i++) {
+                // Truncation may land on either side of an integer after rounding
+                CHECK(std::abs(int(actualGray[i]) - int(gray[i])) <= 1);
+            }
+
+            std::vector<Real> actualNorm(n, Real(1));
+            simd_utils::addNorm(asComplex(a), actualNorm.data(), n);
+            for (size_t i = 0; i < n; i++) {
+                CHECK_NEAR(actualNorm[i], norm[i], tol * std::abs(norm[i]));
+            }
+
+            std::vector<Real> actualProduct(2 * n, Real(1));
+            simd_utils::addConjugateProduct(asComplex(a), asComplex(b), asComplex(actualProduct), n);
+            for (size_t i = 0; i < 2 * n; i++) {
+                CHECK_NEAR(actualProduct[i], product[i], tol * 2e4);
+            }
+        }
+    }
+}
+
+/// Bytes read plus bytes written per call, timed for every ISA
+template <typename Fn>
+void benchIsas(const std::string &what, double bytes, Fn &&fn) {
+    IsaGuard guard;
+    for (auto isa : {Isa::Scalar, Isa::Sse2, Isa::Avx2}) {
+        if (static_cast<int>(isa) > static_cast<int>(simd_utils::detectedIsa())) {
+            continue;
+        }
+        simd_utils::setActiveIsa(isa);
+        auto seconds = testing::bestOf(10, fn);
+        testing::report(what + " " + simd_utils::isaName(isa), seconds, bytes);
+    }
+}
+
+/// 8M samples, far larger than the last level cache
+constexpr size_t kBenchSamples = size_t(1) << 23;
+
+template <typename T>
+void benchToComplex(const char *type) {
+    auto src = randomSamples<T>(2 * kBenchSamples, 3);
+    std::vector<double> dst(2 * kBenchSamples);
+    benchIsas(std::string("toComplex ") + type + " -> double", 2 * kBenchSamples * (sizeof(T) + 8.0),
+              [&] {
+                  simd_utils::toComplex(src.data(), asComplex(dst), kBenchSamples, true);
+              });
+    std::vector<float> dstf(2 * kBenchSamples);
+    benchIsas(std::string("toComplex ") + type + " -> float", 2 * kBenchSamples * (sizeof(T) + 4.0),
+              [&] {
+                  simd_utils::toComplex(src.data(), asComplex(dstf), kBenchSamples, true);
+              });
+}
+
+} // namespace
+
+TEST_CASE("simd_utils toComplex matches scalar") {
+    checkToComplex<std::uint8_t, double>();
+    checkToComplex<std::int8_t, double>();
+    checkToComplex<std::uint16_t, double>();
+    checkToComplex<std::int16_t, double>();
+    checkToComplex<std::uint32_t, double>();
+    checkToComplex<std::int32_t, double>();
+    checkToComplex<float, double>();
+    checkToComplex<double, double>();
+    checkToComplex<std::uint8_t, float>();
+    checkToComplex<std::int8_t, float>();
+    checkToComplex<std::uint16_t, float>();
+    checkToComplex<std::int16_t, float>();
+    checkToComplex<std::uint32_t, float>();
+    checkToComplex<std::int32_t, float>();
+    checkToComplex<float, float>();
+    checkToComplex<double, float>();
+}
+
+TEST_CASE("simd_utils accumulators match scalar") {
+    checkAccumulators<double>();
+    checkAccumulators<float>();
+}
+
+TEST_CASE("simd_utils magnitudeToGray16 truncates and saturates") {
+    IsaGuard guard;
+    // Magnitudes 5, 0, 2.5, 13 and 1e6 with a tail past the vector widths
+    std::vector<double> samples = {3, 4, 0, 0, 2.5, 0, -5, 12, 0, -1e6};
+    while (samples.size() < 2 * 19) {
+        samples.push_back(3);
+        samples.push_back(-4);
+    }
+    const size_t n = samples.size() / 2;
+    std::vector<float> singleSamples(samples.begin(), samples.end());
+
+    auto isas = vectorIsas();
+    isas.insert(isas.begin(), Isa::Scalar);
+    for (auto isa : isas) {
+        simd_utils::setActiveIsa(isa);
+        CHECK(simd_utils::maxNorm(asComplex(samples), n) == 1e12);
+        CHECK(simd_utils::maxNorm(asComplex(samples), 2) == 25);
+        CHECK(simd_utils::maxNorm(asComplex(samples), 0) == 0);
+
+        std::vector<std::uint16_t> gray(n + 1, 7);
+        simd_utils::magnitudeToGray16(asComplex(samples), gray.data(), n, 1000.0);
+        std::vector<std::uint16_t> singleGray(n + 1, 7);
+        simd_utils::magnitudeToGray16(asComplex(singleSamples), singleGray.data(), n, 1000.0f);
+        for (const auto &values : {gray, singleGray}) {
+            CHECK(values[0] == 5000 && values[1] == 0 && values[2] == 2500 && values[3] == 13000);
+            CHECK(values[4] == 65535);
+            for (size_t i = 5; i < n; i++) {
+                CHECK(values[i] == 5000);
+            }
+            // Nothing is written past n
+            CHECK(values[n] == 7);
+        }
+        // A scale below one truncates towards zero
+        simd_utils::magnitudeToGray16(asComplex(samples), gray.data(), 3, 0.58);
+        CHECK(gray[0] == 2 && gray[1] == 0 && gray[2] == 1);
+    }
+}
+
+TEST_CASE("simd_utils setActiveIsa clamps to detectedIsa") {
+    IsaGuard guard;
+    simd_utils::setActiveIsa(Isa::Avx2);
+    CHECK(static_cast<int>(simd_utils::activeIsa()) <= static_cast<int>(simd_utils::detectedIsa()));
+    simd_utils::setActiveIsa(Isa::Scalar);
+    CHECK(simd_utils::activeIsa() == Isa::Scalar);
+}
+
+BENCHMARK("simd_utils toComplex throughput") {
+    benchToComplex<std::int16_t>("int16");
+    benchToComplex<std::int32_t>("int32");
+    benchToComplex<float>("float");
+}
+
+BENCHMARK("simd_utils image kernels throughput") {
+    auto a = randomComplex<double>(kBenchSamples, 4);
+    auto b = randomComplex<double>(kBenchSamples, 5);
+    std::vector<std::uint16_t> gray(kBenchSamples);
+    std::vector<double> norm(kBenchSamples);
+    std::vector<double> product(2 * kBenchSamples);
+    const double complexBytes = kBenchSamples * 16.0;
+
+    benchIsas("maxNorm double", complexBytes,
+              [&] { volatile auto peak = simd_utils::maxNorm(asComplex(a), kBenchSamples); (void)peak; });
+    benchIsas("magnitudeToGray16 double", complexBytes + kBenchSamples * 2.0, [&] {
+        simd_utils::magnitudeToGray16(asComplex(a), gray.data(), kBenchSamples, 1.0);
+    });
+    benchIsas("addNorm double", complexBytes + kBenchSamples * 16.0,
+              [&] { simd_utils::addNorm(asComplex(a), norm.data(), kBenchSamples); });
+    benchIsas("addConjugateProduct double", 4 * complexBytes, [&] {
+        simd_utils::addConjugateProduct(asComplex(a), asComplex(b), asComplex(product), kBenchSamples);
+    });
+}
@@ -9,8 +9,10 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDebug>
-#include <fftw3.h>
+#include "fftwcompat.h"
+#include "fftshift.h"
 #include <memory>
+#include <vector>
 
 
 // Log levels
@@ -55,34 +57,126 @@ public:
  * @brief Some wrappers for the fftw library, including related structures such as arrays
  * @todo Encapsulation to ensure automatic release of fftw_complex memory
  * @detail The vector here uses the standard library, not QVector for convenience in future non-Qt C++ projects
+ * Every function is available in double (fftw) and single (fftwf) precision, arrays are
+ * passed as Real (*)[2] so that the precision is deduced from fftw_complex/fftwf_complex
  */
 namespace fftw_utils{
+    /// Maps a precision to the matching fftw api, the planner part only exists with MRSCAN_WITH_FFTW
+    template <typename Real>
+    struct Fftw;
+
+    template <>
+    struct Fftw<double> {
+        using Real = double;
+        using complex = fftw_complex;
+#ifdef MRSCAN_WITH_FFTW
+        using plan = fftw_plan;
+#endif
+
+        static void free(void* ptr) { fftw_free(ptr); }
+        static complex* alloc(size_t size) { return fftw_alloc_complex(size); }
+#ifdef MRSCAN_WITH_FFTW
+        static plan plan_dft(int rank, const int* n, complex* in, complex* out, int sign, unsigned flags) {
+            return fftw_plan_dft(rank, n, in, out, sign, flags);
+        }
+        static plan plan_many_dft(int rank, const int* n, int howmany, complex* in, int istride, int idist,
+                                  complex* out, int ostride, int odist, int sign, unsigned flags) {
+            return fftw_plan_many_dft(rank, n, howmany, in, nullptr, istride, idist,
+                                      out, nullptr, ostride, odist, sign, flags);
+        }
+        static void execute(const plan p) { fftw_execute(p); }
+        static void execute_dft(const plan p, complex* in, complex* out) { fftw_execute_dft(p, in, out); }
+        static void destroy_plan(plan p) { fftw_destroy_plan(p); }
+        static int alignment_of(Real* p) { return fftw_alignment_of(p); }
+        static int import_wisdom_from_filename(const char* path) { return fftw_import_wisdom_from_filename(path); }
+        static int export_wisdom_to_filename(const char* path) { return fftw_export_wisdom_to_filename(path); }
+#ifdef MRSCAN_FFTW_THREADS
+        static int init_threads() { return fftw_init_threads(); }
+        static void plan_with_nthreads(int threads) { fftw_plan_with_nthreads(threads); }
+#endif
+#endif // MRSCAN_WITH_FFTW
+    };
+
+    template <>
+    struct Fftw<float> {
+        using Real = float;
+        using complex = fftwf_complex;
+#ifdef MRSCAN_WITH_FFTW
+        using plan = fftwf_plan;
+#endif
+
+        static void free(void* ptr) { fftwf_free(ptr); }
+        static complex* alloc(size_t size) { return fftwf_alloc_complex(size); }
+#ifdef MRSCAN_WITH_FFTW
+        static plan plan_dft(int rank, const int* n, complex* in, complex* out, int sign, unsigned flags) {
+            return fftwf_plan_dft(rank, n, in, out, sign, flags);
+        }
+        static plan plan_many_dft(int rank, const int* n, int howmany, complex* in, int istride, int idist,
+                                  complex* out, int ostride, int odist, int sign, unsigned flags) {
+            return fftwf_plan_many_dft(rank, n, howmany, in, nullptr, istride, idist,
+                                      out, nullptr, ostride, odist, sign, flags);
+        }
+        static void execute(const plan p) { fftwf_execute(p); }
+        static void execute_dft(const plan p, complex* in, complex* out) { fftwf_execute_dft(p, in, out); }
+        static void destroy_plan(plan p) { fftwf_destroy_plan(p); }
+        static int alignment_of(Real* p) { return fftwf_alignment_of(p); }
+        static int import_wisdom_from_filename(const char* path) { return fftwf_import_wisdom_from_filename(path); }
+        static int export_wisdom_to_filename(const char* path) { return fftwf_export_wisdom_to_filename(path); }
+#ifdef MRSCAN_FFTW_THREADS
+        static int init_threads() { return fftwf_init_threads(); }
+        static void plan_with_nthreads(int threads) { fftwf_plan_with_nthreads(threads); }
+#endif
+#endif // MRSCAN_WITH_FFTW
+    };
+
+    template <typename Real>
+    using Complex = typename Fftw<Real>::complex;
+
     // Define a custom deleter for unique_ptr
+    template <typename Real = double>
     struct FFTWDeleter {
-        void operator()(fftw_complex* ptr) const {
+        void operator()(Complex<Real>* ptr) const {
             if (ptr) {
-                fftw_free(ptr);
+                Fftw<Real>::free(ptr);
             }
         }
     };
 
     // Use unique_ptr and custom deleter to manage fftw_complex memory
-    using fftw_complex_ptr = std::unique_ptr<fftw_complex[], FFTWDeleter>;
+    template <typename Real>
+    using complex_ptr = std::unique_ptr<Complex<Real>[], FFTWDeleter<Real>>;
+    using fftw_complex_ptr = complex_ptr<double>;
+    using fftwf_complex_ptr = complex_ptr<float>;
 
-    fftw_complex_ptr createArray(size_t size);
+    template <typename Real = double>
+    complex_ptr<Real> createArray(size_t size);
 
-    std::vector<double> abs(fftw_complex* array, size_t len);
+    template <typename Real>
+    std::vector<Real> abs(Real (*array)[2], size_t len);
 
-    fftw_complex_ptr exec_fft_3d(fftw_complex* in, std::vector<int> n);
+    /**
+     * @brief Out-of-place forward FFT on fftBackend(), in is left untouched
+     * @param n Shape of one transform, of any rank
+     * @param howmany Number of contiguous transforms, executed by a single batched plan
+     */
+    template <typename Real>
+    complex_ptr<Real> exec_fft(const Real (*in)[2], const std::vector<int>& n, int howmany = 1);
+
+    /// In-place forward FFT, needs no memory besides data
+    template <typename Real>
+    bool exec_fft_inplace(Real (*data)[2], const std::vector<int>& n, int howmany = 1);
+
+    /// In-place backward FFT, unnormalized like fftw, exec_fft_inplace then this scales by the size
+    template <typename Real>
+    bool exec_ifft_inplace(Real (*data)[2], const std::vector<int>& n, int howmany = 1);
 
     /**
      * @brief For logically multi-dimensional arrays, but represented using one-dimensional arrays, giving array index based on array shape and indices of each dimension
      * @param shape The shape of the array
      * @param indices The indices of each dimension
+     * @note Prefer nd_utils::NdArray in loops, it needs no vector per access
      */
-    int getIndex(std::vector<int> shape, std::vector<int> indices);
-
-    void fftshift3d(fftw_complex* data, std::vector<int> shape);
+    int getIndex(const std::vector<int>& shape, const std::vector<int>& indices);
 } // namespace FFTW
 
 
@@ -90,7 +184,8 @@ namespace file_utils{
 
 QByteArray read(const QString& fpath);
 
-void save(const QString& fpath, QByteArray content);
+/// @return false if fpath could not be written, an existing file is then left unchanged
+bool save(const QString& fpath, QByteArray content);
 
 }
 